@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 
 namespace geometry {
 
@@ -8,11 +9,21 @@ struct Vector {
     float x, y, z;
 };
 
+struct TexCoord {
+    float u, v;
+};
+
 struct Vertex {
     Vector position;
     Vector normal;
+    TexCoord uv;
 };
 
+// Версия генератора: увеличивается при любом изменении вершин или
+// топологии, которое generate() выдаёт для тех же параметров. Входит
+// в ключ MeshCache, иначе кэш продолжит отдавать старые меши
+constexpr uint32_t cylinder_generator_version = 1;
+
 class Cylinder {
 public:
     std::vector<Vertex> vertices_;
@@ -22,6 +33,7 @@ public:
 
     // Вспомогательные геттеры
     size_t getVerticesSizeInBytes() const { return vertices_.size() * sizeof(Vertex); }
+    uint32_t getVertexCount()       const { return static_cast<uint32_t>(vertices_.size()); }
     const void* getVerticesData()   const { return vertices_.data(); }
     size_t getIndicesSizeInBytes()  const { return indices_.size() * sizeof(uint32_t); }
     const void* getIndicesData()    const { return indices_.data(); }
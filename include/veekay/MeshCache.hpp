@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "veekay/Cylinder.hpp"
+
+namespace geometry {
+
+// Описание одного атрибута вершины в файле меша
+enum class AttributeSemantic : uint32_t {
+    position = 0,
+    normal = 1,
+    uv = 2,
+};
+
+struct VertexAttribute {
+    AttributeSemantic semantic;
+    uint32_t components;  // Количество float-компонент
+    uint32_t offset;      // Смещение внутри вершины в байтах
+};
+
+constexpr uint32_t mesh_file_version = 1;
+constexpr uint32_t mesh_file_max_attributes = 8;
+
+// Заголовок бинарного файла меша. За ним в файле лежат блоки вершин и
+// индексов, оба выровнены по 16 байт, так что после mmap их можно сразу
+// копировать в GPU буфер без разбора
+struct MeshFileHeader {
+    char magic[4];  // "VKMS"
+    uint32_t version;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t vertex_stride;
+    uint32_t attribute_count;
+    VertexAttribute attributes[mesh_file_max_attributes];
+    uint64_t vertex_offset;
+    uint64_t index_offset;
+    uint64_t checksum;  // FNV-1a 64 по блокам вершин и индексов
+};
+
+// Отображённый в память файл меша, владеет отображением
+class MappedMesh {
+public:
+    MappedMesh() = default;
+    ~MappedMesh();
+
+    MappedMesh(MappedMesh&& other) noexcept;
+    MappedMesh& operator=(MappedMesh&& other) noexcept;
+
+    MappedMesh(const MappedMesh&) = delete;
+    MappedMesh& operator=(const MappedMesh&) = delete;
+
+    // Отображает файл и проверяет заголовок, раскладку вершин и контрольную сумму
+    static MappedMesh open(const std::string& path);
+
+    bool valid() const { return data_ != nullptr; }
+
+    const void* getVerticesData()  const;
+    const uint32_t* getIndicesData() const;
+    uint32_t getVertexCount()      const { return header()->vertex_count; }
+    uint32_t getIndexCount()       const { return header()->index_count; }
+
+private:
+    const MeshFileHeader* header() const { return static_cast<const MeshFileHeader*>(data_); }
+    void close();
+
+    void* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+// Дисковый кэш сгенерированных мешей, ключ - параметры генератора
+class MeshCache {
+public:
+    explicit MeshCache(std::string directory);
+
+    // Отображает закэшированный цилиндр, при промахе (или повреждённом
+    // файле) генерирует его и сохраняет на диск
+    MappedMesh cylinder(float radius, float height, uint32_t segments);
+
+    static bool write(const std::string& path,
+                      const Vertex* vertices, uint32_t vertex_count,
+                      const uint32_t* indices, uint32_t index_count);
+
+private:
+    std::string directory_;
+};
+
+}
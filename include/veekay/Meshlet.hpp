@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "veekay/Cylinder.hpp"
+
+namespace geometry {
+
+constexpr uint32_t meshlet_max_vertices = 64;
+constexpr uint32_t meshlet_max_triangles = 124;
+
+// Кластер (meshlet) - небольшой кусок меша, который отсекается целиком.
+// Раскладка совпадает со структурой Meshlet в шейдерах (std430)
+struct Meshlet {
+    float center[3];     // Ограничивающая сфера в пространстве меша
+    float radius;
+    float cone_axis[3];  // Средняя нормаль треугольников кластера
+    float cone_cutoff;   // sin половины раствора конуса нормалей, 1 - не отсекать
+    uint32_t vertex_offset;    // Начало в MeshletData::vertices
+    uint32_t triangle_offset;  // Начало в MeshletData::triangles (байт, по 3 на треугольник)
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+};
+
+struct MeshletData {
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;  // Индексы вершин меша
+    std::vector<uint8_t> triangles;  // Локальные индексы вершин кластера, кратно 4 байтам
+};
+
+// Делит меш на кластеры не больше max_vertices вершин и max_triangles
+// треугольников, жадно идя по индексам: у сгенерированных мешей соседние
+// треугольники и так лежат рядом, поэтому кластеры получаются компактными
+MeshletData buildMeshlets(const Vertex* vertices, uint32_t vertex_count,
+                          const uint32_t* indices, uint32_t index_count,
+                          uint32_t max_vertices = meshlet_max_vertices,
+                          uint32_t max_triangles = meshlet_max_triangles);
+
+// Обычный индексный буфер в порядке кластеров: треугольники кластера m
+// начинаются с индекса meshlets[m].triangle_offset. Для отрисовки
+// отсечённых кластеров без mesh-шейдеров
+std::vector<uint32_t> meshletIndices(const MeshletData& data);
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/memory.hpp>
+
+namespace veekay {
+
+enum class CaptureFormat {
+	ppm,
+	png,
+};
+
+// NOTE: Streams presented frames to disk without stalling the frame loop.
+//       Every captured frame is copied into one of a ring of host visible
+//       readback buffers, the copy is retired when its frame slot's fence
+//       signals, and a writer thread encodes the buffer to an image file.
+//       If the writer falls behind and no readback buffer is free, frame
+//       is dropped rather than waited for
+class FrameCapture {
+public:
+	// NOTE: image_format is the swapchain format, images must have been
+	//       created with TRANSFER_SRC usage
+	bool initialize(VkFormat image_format, uint32_t width, uint32_t height,
+	                uint32_t buffer_count);
+	void destroy();
+
+	// NOTE: Captures every following frame into directory, frame_count of
+	//       zero captures until stop() is called
+	void start(const std::string& directory, CaptureFormat format = CaptureFormat::png,
+	           uint32_t frame_count = 0);
+	void stop();
+
+	bool active() const { return active_; }
+	uint32_t capturedCount() const { return captured_; }
+	uint32_t droppedCount() const { return dropped_; }
+
+	// NOTE: Called once frame slot's fence has signaled, hands the copy
+	//       made by that slot over to the writer thread
+	void retire(uint32_t frame);
+
+	// NOTE: Records copy of the image into a free readback buffer, image
+	//       must be in PRESENT_SRC layout and stays in it. Returns command
+	//       buffer to submit after frame's commands, or VK_NULL_HANDLE if
+	//       nothing is captured this frame
+	VkCommandBuffer record(uint32_t frame, VkImage image);
+
+private:
+	struct Job {
+		uint32_t buffer;
+		CaptureFormat format;
+		std::string path;
+	};
+
+	struct Pending {
+		uint32_t buffer;
+		uint32_t number;
+	};
+
+	static constexpr uint32_t no_buffer = UINT32_MAX;
+
+	void writerLoop();
+	void write(const Job& job);
+
+	uint32_t width_;
+	uint32_t height_;
+	bool swizzle_;
+
+	VkCommandPool command_pool_;
+	std::vector<VkCommandBuffer> command_buffers_;
+
+	std::vector<Buffer> buffers_;
+	std::vector<Pending> pending_;
+
+	bool active_ = false;
+	std::string directory_;
+	CaptureFormat format_;
+	uint32_t frame_limit_;
+	uint32_t captured_ = 0;
+	uint32_t dropped_ = 0;
+
+	// NOTE: Guards everything shared with writer thread below
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::vector<uint32_t> free_buffers_;
+	std::deque<Job> jobs_;
+	bool quit_;
+
+	// NOTE: Touched by writer thread only
+	std::thread writer_;
+	std::vector<uint8_t> rgb_;
+	std::vector<uint8_t> scratch_;
+};
+
+} // namespace veekay
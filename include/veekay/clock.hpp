@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+namespace veekay {
+
+// NOTE: How application time advances from frame to frame
+enum class ClockMode {
+	// Wall clock time, frames render whatever moment they happen at
+	real_time,
+	// Wall clock time is accumulated and consumed in whole fixed steps,
+	// update sees time advance by steps() * step() per frame
+	fixed_step,
+	// Every frame advances time by exactly one step regardless of how
+	// long it took, for offline rendering and benchmarks
+	fixed_frame,
+};
+
+class Clock {
+public:
+	// NOTE: Upper bound of fixed steps per frame, keeps a long stall from
+	//       making the next frame simulate forever
+	static constexpr uint32_t max_steps_per_frame = 8;
+
+	void reset(ClockMode mode, double step, double wall_time);
+
+	// NOTE: Called by run() once per frame before update
+	void advance(double wall_time);
+
+	// NOTE: Replaces state of current frame, used by input playback to
+	//       reproduce timing of the recorded run
+	void set(double time, double delta, uint32_t steps);
+
+	ClockMode mode() const { return mode_; }
+	double step() const { return step_; }
+
+	// NOTE: Application time in seconds, starts at zero
+	double time() const { return time_; }
+	double delta() const { return delta_; }
+
+	// NOTE: Fixed steps to simulate this frame, 1 outside fixed_step mode
+	uint32_t steps() const { return steps_; }
+
+	// NOTE: Fraction of a step left in accumulator, for interpolating
+	//       between last two simulated states in fixed_step mode
+	double alpha() const { return (mode_ == ClockMode::fixed_step) ? accumulator_ / step_ : 0.0; }
+
+private:
+	ClockMode mode_;
+	double step_;
+
+	double start_;
+	double last_wall_;
+	double accumulator_;
+
+	// NOTE: Time of fixed modes is step_count_ * step_, no drift from
+	//       summing deltas
+	uint64_t step_count_;
+
+	double time_;
+	double delta_;
+	uint32_t steps_;
+};
+
+} // namespace veekay
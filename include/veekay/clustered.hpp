@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/memory.hpp>
+
+namespace veekay {
+
+// NOTE: Mirrors PointLight struct in shaders (std430 layout)
+struct PointLight {
+	float position[3];
+
+	// NOTE: Light falls off to zero at this distance
+	float radius;
+
+	float color[3];
+	float intensity;
+};
+
+// NOTE: Clustered forward shading of many point lights. View frustum is
+//       split into a grid of screen tiles times depth slices. A compute
+//       pass (light_cull.comp, loaded by the app) lists lights whose
+//       sphere touches each cluster, fragment shaders find their cluster
+//       and loop only over its list
+//
+//       Set layout, for the compute pass and fragment shaders:
+//         binding 0: readonly buffer Lights { params; PointLight lights[]; }
+//         binding 1: buffer ClusterCounts { uint cluster_counts[]; }
+//         binding 2: buffer ClusterLights { uint cluster_lights[]; }
+class ClusteredLighting {
+public:
+	static constexpr uint32_t tiles_x = 16;
+	static constexpr uint32_t tiles_y = 9;
+	static constexpr uint32_t slices = 24;
+	static constexpr uint32_t cluster_count = tiles_x * tiles_y * slices;
+
+	// NOTE: Lights past this many in one cluster are dropped
+	static constexpr uint32_t max_lights_per_cluster = 256;
+
+	// NOTE: With perspective projections the first slice spans from near
+	//       plane to this view distance, the rest are exponential up to far
+	//       plane. Exponential slices from a tiny near plane would spend
+	//       half of them on the first unit. Orthographic projections get
+	//       linear slices between their planes
+	static constexpr float first_slice_depth = 1.0f;
+
+	bool initialize(VkShaderModule cull_shader, uint32_t max_lights);
+	void destroy();
+
+	// NOTE: World space lights, at most max_lights are kept. Copied into
+	//       buffer of each frame slot when its cull() comes
+	void setLights(const PointLight* lights, uint32_t count);
+
+	// NOTE: Records binning of frame's lights outside render pass, for a
+	//       framebuffer of app.window_width by app.window_height. view and
+	//       projection are column-major like GLSL, view looks down -Z.
+	//       Slices span the depth range projection keeps, taken from its
+	//       inverse. Descriptor set of the frame is allocated here, when
+	//       that fails nothing is recorded, set() is null and false is
+	//       returned
+	bool cull(VkCommandBuffer cmd, const float view[16], const float projection[16]);
+
+	// NOTE: Layout belongs to app.descriptors
+	VkDescriptorSetLayout setLayout() const { return set_layout_; }
+
+	// NOTE: Set of the last cull(), valid for the frame being recorded
+	VkDescriptorSet set() const { return set_; }
+
+	uint32_t lightCount() const { return static_cast<uint32_t>(lights_.size()); }
+	uint32_t maxLights() const { return max_lights_; }
+
+private:
+	// NOTE: Mirrors header of Lights buffer in light_cull.comp and shader.frag
+	struct Params {
+		float view[16];
+		float inverse_projection[16];
+		uint32_t grid[4];
+		float screen[4];
+		float slicing[4];
+	};
+
+	VkDevice device_;
+	uint32_t max_lights_;
+	uint8_t all_frames_mask_;
+
+	VkDescriptorSetLayout set_layout_;
+	VkPipelineLayout layout_;
+	VkPipeline pipeline_;
+	VkDescriptorSet set_;
+
+	// NOTE: Params and lights of every frame slot, host visible
+	std::vector<Buffer> light_buffers_;
+
+	// NOTE: Written by compute pass, read by fragment shaders of the frame
+	Buffer counts_;
+	Buffer indices_;
+
+	std::vector<PointLight> lights_;
+
+	// NOTE: Bit N set means slot N holds outdated lights
+	uint8_t dirty_;
+};
+
+} // namespace veekay
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/veekay.hpp>
+#include <veekay/device.hpp>
+#include <veekay/memory.hpp>
+#include <veekay/clock.hpp>
+#include <veekay/pipeline.hpp>
+#include <veekay/descriptors.hpp>
+#include <veekay/jobs.hpp>
+#include <veekay/loader.hpp>
+#include <veekay/pacing.hpp>
+
+namespace veekay {
+
+// NOTE: Headless instance of the runtime, for batch rendering many scenes
+//       or camera paths in one process. Unlike run(), which owns the one
+//       window of the process, any number of contexts may exist, each run
+//       on its own thread. A context either creates its own instance and
+//       device, or renders with the device of another one on a queue of
+//       its own. Contexts render through tiled rendering (veekay/tiled.hpp)
+//       into ApplicationConfig::tiled_output, there is no surface, UI or
+//       sampled depth (vk_depth_image is null, occlusion culling is off).
+//       Apps that stop in init(), e.g. tests, need no tiled_output
+class Context {
+public:
+	// NOTE: Picks device by config the way run() does. queue_count graphics
+	//       queues are created, this context takes the first and contexts
+	//       sharing its device the rest. Fewer if the device has fewer
+	bool initialize(const ApplicationConfig& config, uint32_t queue_count = 1);
+
+	// NOTE: Shares device of owner, fails once every queue of it is taken.
+	//       owner must be destroyed after every context sharing its device
+	bool initialize(const ApplicationConfig& config, Context& owner);
+
+	void destroy();
+
+	// NOTE: Binds context to calling thread (veekay::app) and runs app:
+	//       init(), config.tiled_frames images, shutdown(). Callbacks run
+	//       on calling thread, with several contexts running app state has
+	//       to be kept per context, e.g. thread_local. update() is called
+	//       on the same thread, simulation_thread is ignored. Returns exit
+	//       code like run()
+	int run(const ApplicationInfo& app_info, const ApplicationConfig& config);
+
+	Application& application() { return app_; }
+
+	uint32_t queueCount() const { return queue_count_; }
+
+private:
+	bool createDevice(const ApplicationConfig& config, uint32_t queue_count);
+	bool createRenderPass();
+
+	Application app_;
+
+	// NOTE: Null in contexts sharing another one's device, they count
+	//       allocations in owner's memory tracker
+	Device device_;
+	MemoryTracker memory_;
+	bool owns_device_;
+
+	// NOTE: Queues of owned device, next_queue_ goes to the next context
+	//       created from this one
+	uint32_t queue_count_;
+	std::atomic<uint32_t> next_queue_;
+
+	VkRenderPass render_pass_;
+
+	Clock clock_;
+	FrameStats frame_stats_;
+	PipelineRegistry pipelines_;
+	DescriptorAllocator descriptors_;
+	JobSystem jobs_;
+	ResourceLoader loader_;
+};
+
+} // namespace veekay
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay {
+
+constexpr uint32_t max_descriptor_bindings = 16;
+
+// NOTE: Bindings of a descriptor set layout, the key of layout cache.
+//       Immutable samplers are not supported
+struct DescriptorLayoutDescription {
+	uint32_t binding_count;
+	VkDescriptorSetLayoutBinding bindings[max_descriptor_bindings];
+};
+
+bool operator==(const DescriptorLayoutDescription& a, const DescriptorLayoutDescription& b);
+
+struct DescriptorLayoutDescriptionHash {
+	size_t operator()(const DescriptorLayoutDescription& description) const;
+};
+
+// NOTE: Hands out descriptor sets without per-set frees. Transient sets
+//       come from pools of the current frame in flight, which are reset
+//       as a whole once the frame's fence has signaled, so a transient
+//       set lives until its slot comes round again. Static sets come from
+//       a pool that lives as long as the allocator. Pools of both kinds
+//       grow by adding another, twice as large, when the last one is full.
+//       Layouts are created on request and shared by equal descriptions
+class DescriptorAllocator {
+public:
+	bool initialize(VkDevice device, uint32_t frames_in_flight);
+	void destroy();
+
+	// NOTE: Returns existing layout for equal description or creates one,
+	//       VK_NULL_HANDLE on failure. Layouts stay alive until allocator
+	//       is destroyed, don't destroy them
+	VkDescriptorSetLayout layout(const DescriptorLayoutDescription& description);
+
+	// NOTE: Set valid for the frame being recorded (app.frame_index), so
+	//       allocate from render(), the slot is recycled before it
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+	// NOTE: Transient set with buffers bound whole to storage buffer
+	//       bindings 0 to count - 1, up to max_descriptor_bindings. Passes
+	//       allocating a fresh set every frame this way never free it, it
+	//       is recycled with the frame slot. VK_NULL_HANDLE on failure
+	VkDescriptorSet allocateStorageBuffers(VkDescriptorSetLayout layout, const VkBuffer* buffers,
+	                                       uint32_t count);
+
+	// NOTE: Set valid until allocator is destroyed
+	VkDescriptorSet allocateStatic(VkDescriptorSetLayout layout);
+
+	// NOTE: Called once frame slot's fence has signaled, recycles every
+	//       transient set allocated for that slot
+	void reset(uint32_t frame);
+
+	size_t layoutCount() const { return layouts_.size(); }
+
+private:
+	// NOTE: Pools of one lifetime, current is the first one not known to
+	//       be full. Pools before it are full until reset
+	struct PoolChain {
+		std::vector<VkDescriptorPool> pools;
+		uint32_t current = 0;
+	};
+
+	VkDescriptorSet allocate(PoolChain& chain, VkDescriptorSetLayout layout);
+	VkDescriptorPool createPool(uint32_t set_count);
+
+	VkDevice device_;
+
+	std::mutex mutex_;
+	std::vector<PoolChain> frames_;
+	PoolChain static_;
+	std::unordered_map<DescriptorLayoutDescription, VkDescriptorSetLayout,
+	                   DescriptorLayoutDescriptionHash> layouts_;
+};
+
+} // namespace veekay
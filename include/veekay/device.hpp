@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/veekay.hpp>
+
+namespace veekay {
+
+// NOTE: Instance and device the way run() and contexts set them up, so
+//       apps render the same way in a window and headless
+struct Device {
+	VkInstance instance;
+	VkDebugUtilsMessengerEXT debug_messenger;
+
+	// NOTE: Null for headless devices
+	VkSurfaceKHR surface;
+
+	VkPhysicalDevice physical_device;
+	VkDevice device;
+
+	// NOTE: queue_count queues of this family were created, it presents
+	//       to surface when there is one
+	uint32_t graphics_queue_family;
+	uint32_t queue_count;
+
+	// NOTE: Optional extensions that got enabled
+	bool memory_budget;
+	bool draw_indirect_count;
+	bool mesh_shader;
+	bool present_wait;
+};
+
+// NOTE: Creates surface of a window for the instance, reports its own errors
+typedef bool (*CreateSurfaceFunc)(VkInstance instance, VkSurfaceKHR* surface);
+
+// NOTE: Device is picked by config among those meeting requirements:
+//       Vulkan 1.2 with descriptor indexing and multi draw indirect.
+//       Without create_surface instance is headless. Up to queue_count
+//       graphics queues are created, fewer if the family has fewer. On
+//       failure whatever got created stays in device for destroyDevice()
+bool createDevice(const ApplicationConfig& config, CreateSurfaceFunc create_surface,
+                  uint32_t queue_count, Device& device);
+void destroyDevice(const Device& device);
+
+// NOTE: config.depth_format when device supports it, otherwise first
+//       supported of D32, D32S8, D24S8. sampled also requires shaders to
+//       be able to sample it. VK_FORMAT_UNDEFINED when none is supported
+VkFormat pickDepthFormat(VkPhysicalDevice physical_device, const ApplicationConfig& config,
+                         bool sampled);
+
+// NOTE: Single subpass pass of color and depth attachment. Color ends up
+//       in color_layout, e.g. PRESENT_SRC for swapchain images. With load
+//       both attachments are loaded instead of cleared and come in their
+//       final layouts, such pass is compatible with the one without load
+//       and continues it. Returns VK_NULL_HANDLE on failure
+VkRenderPass createRenderPass(VkDevice device, VkFormat color_format, VkImageLayout color_layout,
+                              VkFormat depth_format, bool store_depth, bool load = false);
+
+} // namespace veekay
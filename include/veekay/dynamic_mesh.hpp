@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/memory.hpp>
+#include <veekay/geometry_pool.hpp>
+
+namespace veekay {
+
+// NOTE: Mesh whose contents change at runtime. Every frame in flight has
+//       its own vertex and index buffers, rewritten in place when frame's
+//       slot comes up, so earlier frames keep drawing older contents and
+//       nothing waits for the GPU. Buffers grow geometrically, outgrown
+//       ones are released with destroyBufferDeferred()
+class DynamicMesh {
+public:
+	void initialize(uint32_t vertex_stride);
+	void destroy();
+
+	// NOTE: Copies new contents, frames pick them up in bind()
+	void update(const void* vertices, uint32_t vertex_count,
+	            const uint32_t* indices, uint32_t index_count);
+
+	// NOTE: Brings frame slot's buffers up to date, then binds vertex buffer
+	//       to binding 0 and index buffer. Returns false if buffers couldn't
+	//       be grown, nothing is bound then
+	bool bind(VkCommandBuffer cmd, uint32_t frame);
+
+	// NOTE: Range of the latest contents, for indexed draws after bind()
+	MeshRange mesh() const;
+
+private:
+	struct Slot {
+		Buffer vertex_buffer;
+		Buffer index_buffer;
+		uint32_t vertex_capacity;
+		uint32_t index_capacity;
+		uint64_t version;
+	};
+
+	bool reserve(Slot& slot);
+
+	uint32_t vertex_stride_;
+	uint32_t vertex_count_;
+	uint32_t index_count_;
+	uint64_t version_;
+
+	std::vector<char> vertices_;
+	std::vector<uint32_t> indices_;
+
+	std::vector<Slot> slots_;
+};
+
+} // namespace veekay
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/memory.hpp>
+
+namespace veekay {
+
+// NOTE: Location of a mesh inside pool's shared buffers
+struct MeshRange {
+	uint32_t first_index;
+	uint32_t index_count;
+	int32_t vertex_offset;
+	uint32_t vertex_count;
+};
+
+// NOTE: Sub-allocates meshes of one vertex layout into a single vertex
+//       buffer and a single index buffer. Indices stay mesh-relative,
+//       vertex_offset rebases them at draw time
+class GeometryPool {
+public:
+	static constexpr uint32_t invalid_mesh = UINT32_MAX;
+
+	bool initialize(uint32_t vertex_stride, uint32_t max_vertices, uint32_t max_indices);
+	void destroy();
+
+	// NOTE: Returns mesh ID or invalid_mesh when pool is full
+	uint32_t add(const void* vertices, uint32_t vertex_count,
+	             const uint32_t* indices, uint32_t index_count);
+
+	const MeshRange& mesh(uint32_t id) const { return meshes_[id]; }
+	uint32_t meshCount() const { return static_cast<uint32_t>(meshes_.size()); }
+
+	// NOTE: Binds vertex buffer to binding 0 and index buffer
+	void bind(VkCommandBuffer cmd) const;
+
+	VkBuffer vertexBuffer() const { return vertex_buffer_.buffer; }
+	VkBuffer indexBuffer() const { return index_buffer_.buffer; }
+
+private:
+	uint32_t vertex_stride_;
+	uint32_t max_vertices_;
+	uint32_t max_indices_;
+	uint32_t vertex_count_;
+	uint32_t index_count_;
+
+	Buffer vertex_buffer_;
+	Buffer index_buffer_;
+
+	std::vector<MeshRange> meshes_;
+};
+
+// NOTE: Per-frame list of VkDrawIndexedIndirectCommand, one per
+//       mesh/instance batch, submitted with one indirect draw call
+class DrawList {
+public:
+	bool initialize(uint32_t max_draws);
+	void destroy();
+
+	// NOTE: Starts filling frame slot's buffer, call once frame's fence
+	//       has signaled
+	void reset(uint32_t frame);
+	void add(const MeshRange& mesh, uint32_t first_instance, uint32_t instance_count);
+
+	uint32_t size() const { return count_; }
+
+	void draw(VkCommandBuffer cmd) const;
+
+private:
+	uint32_t max_draws_;
+	uint32_t frame_;
+	uint32_t count_;
+
+	std::vector<Buffer> buffers_;
+};
+
+} // namespace veekay
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/memory.hpp>
+#include <veekay/geometry_pool.hpp>
+
+namespace veekay {
+
+// NOTE: Cylinder generated by a compute shader (cylinder.comp, loaded by
+//       the app) straight into device local vertex and index buffers, so
+//       parameters can change every frame without CPU work or uploads.
+//       Vertex layout and topology match geometry::Cylinder exactly
+class GpuCylinder {
+public:
+	static constexpr uint32_t vertexCount(uint32_t segments) { return 4 * segments + 2; }
+	static constexpr uint32_t indexCount(uint32_t segments) { return 12 * segments; }
+
+	bool initialize(VkShaderModule shader, uint32_t max_segments);
+	void destroy();
+
+	// NOTE: Records generation outside render pass, nothing is recorded
+	//       when parameters didn't change. Segments are clamped to
+	//       [3, max_segments]
+	void generate(VkCommandBuffer cmd, float radius, float height, uint32_t segments);
+
+	// NOTE: Binds vertex buffer to binding 0 and index buffer, like
+	//       GeometryPool::bind()
+	void bind(VkCommandBuffer cmd) const;
+
+	// NOTE: Range of the last generated mesh, for indexed draws
+	MeshRange mesh() const;
+
+	uint32_t maxSegments() const { return max_segments_; }
+
+	// NOTE: Generates on GPU, reads result back and compares it with
+	//       geometry::Cylinder of same parameters. Waits for the queue,
+	//       call between frames. Mismatches are reported to std::cerr
+	bool validate(float radius, float height, uint32_t segments);
+
+private:
+	void record(VkCommandBuffer cmd, float radius, float height, uint32_t segments);
+
+	VkDevice device_;
+	uint32_t max_segments_;
+
+	VkDescriptorSetLayout set_layout_;
+	VkPipelineLayout layout_;
+	VkPipeline pipeline_;
+	VkDescriptorPool pool_;
+	VkDescriptorSet set_;
+
+	Buffer vertex_buffer_;
+	Buffer index_buffer_;
+
+	// NOTE: Parameters buffers hold, segments of zero means nothing yet
+	float radius_;
+	float height_;
+	uint32_t segments_;
+};
+
+} // namespace veekay
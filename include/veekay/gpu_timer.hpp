@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay {
+
+struct GpuTiming {
+	const char* name;
+	double milliseconds;
+};
+
+// NOTE: GPU time of passes within a frame, from timestamp queries. Every
+//       frame slot has its own queries, read back when the slot comes
+//       round again, so timings are frames_in_flight frames old. Does
+//       nothing when graphics queue doesn't support timestamps
+class GpuTimer {
+public:
+	static constexpr uint32_t max_passes = 16;
+
+	bool initialize();
+	void destroy();
+
+	// NOTE: Start of frame's command buffer (app.frame_index), outside render
+	//       pass. Collects timings this slot recorded last time and resets
+	//       its queries
+	void beginFrame(VkCommandBuffer cmd);
+
+	// NOTE: Around a pass, inside or outside render pass. Passes don't nest,
+	//       name must outlive the timer, i.e. be a string literal
+	void begin(VkCommandBuffer cmd, const char* name);
+	void end(VkCommandBuffer cmd);
+
+	// NOTE: Passes of the latest frame read back, in recording order
+	const std::vector<GpuTiming>& timings() const { return timings_; }
+
+	bool supported() const { return pool_ != VK_NULL_HANDLE; }
+
+private:
+	struct Slot {
+		uint32_t pass_count;
+		const char* names[max_passes];
+	};
+
+	VkDevice device_;
+	VkQueryPool pool_;
+
+	// NOTE: Nanoseconds per tick and bits of timestamps that are valid
+	double period_;
+	uint64_t valid_mask_;
+
+	std::vector<Slot> slots_;
+	uint32_t frame_;
+	bool open_;
+
+	std::vector<GpuTiming> timings_;
+};
+
+} // namespace veekay
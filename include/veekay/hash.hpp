@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace veekay {
+
+// NOTE: 64-bit FNV-1a, fed field by field so struct padding never matters.
+//       Shared by hashes of cache keys (pipelines, set layouts, variants)
+struct Hasher {
+	uint64_t value = 14695981039346656037ull;
+
+	template <typename T>
+	void add(const T& field) {
+		const auto* bytes = reinterpret_cast<const unsigned char*>(&field);
+		for (size_t i = 0; i < sizeof(T); ++i) {
+			value ^= bytes[i];
+			value *= 1099511628211ull;
+		}
+	}
+};
+
+} // namespace veekay
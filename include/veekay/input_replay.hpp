@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <veekay/clock.hpp>
+
+namespace veekay {
+
+// NOTE: Records ImGui input events and clock state of every frame to a
+//       file, or feeds a recorded file back in place of live input. Play
+//       back with the same window size to reproduce the recorded run
+//       frame by frame
+class InputReplay {
+public:
+	~InputReplay() { stop(); }
+
+	bool startRecording(const char* path);
+	bool startPlayback(const char* path);
+	void stop();
+
+	bool recording() const { return file_ && !playing_; }
+	bool playing() const { return file_ && playing_; }
+
+	// NOTE: Called by run() between backend and ImGui::NewFrame. Recording
+	//       writes events queued this frame; playback replaces them and
+	//       clock state with the recorded ones. Returns false once playback
+	//       runs out of frames
+	bool frame(Clock& clock);
+
+private:
+	struct FrameHeader {
+		double time;
+		double delta;
+		float imgui_delta;
+		uint32_t steps;
+		uint32_t event_count;
+	};
+
+	// NOTE: Type-specific payload of one ImGuiInputEvent
+	struct Event {
+		uint32_t type;
+		int32_t value;
+		float x;
+		float y;
+	};
+
+	void record(Clock& clock);
+	bool play(Clock& clock);
+
+	FILE* file_ = nullptr;
+	bool playing_ = false;
+
+	// NOTE: Events with IDs below this were queued in earlier frames and
+	//       left in queue by input trickling, they are already handled
+	uint32_t next_event_id_;
+
+	std::vector<Event> events_;
+};
+
+} // namespace veekay
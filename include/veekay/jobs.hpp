@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace veekay {
+
+struct Application;
+
+// NOTE: Counts unfinished jobs of a group. Jobs started with a counter
+//       increment it, finishing decrements it; continuations attached
+//       with JobSystem::then() are scheduled once it drops to zero
+class JobCounter {
+public:
+	bool done() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> pending_{0};
+
+	std::mutex mutex_;
+	std::vector<std::function<void()>> continuations_;
+};
+
+// NOTE: Fixed pool of worker threads. Every worker owns a deque, it pushes
+//       and pops its own jobs at the back (LIFO, cache-warm) while idle
+//       workers steal from the front of others. The thread that created
+//       the system has a deque too and runs jobs while waiting
+class JobSystem {
+public:
+	using Job = std::function<void()>;
+
+	// NOTE: worker_count of zero uses one worker per hardware thread
+	//       besides the calling one
+	bool initialize(uint32_t worker_count = 0);
+	void destroy();
+
+	uint32_t workerCount() const { return static_cast<uint32_t>(workers_.size()); }
+
+	// NOTE: Queues job, counter (if any) is incremented right away
+	void run(Job job, JobCounter* counter = nullptr);
+
+	// NOTE: Queues continuation once counter reaches zero (immediately if
+	//       it already has), next counts continuation itself
+	void then(JobCounter& counter, Job continuation, JobCounter* next = nullptr);
+
+	// NOTE: Executes queued jobs on calling thread until counter is zero
+	void wait(JobCounter& counter);
+
+	// NOTE: Calls function(begin, end) over [0, count) split into chunks
+	//       of grain elements, calling thread takes a share, returns when
+	//       every chunk is done
+	template <typename Function>
+	void parallelFor(uint32_t count, uint32_t grain, Function&& function);
+
+private:
+	struct Task {
+		Job job;
+		JobCounter* counter;
+	};
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void push(Task task);
+	bool pop(uint32_t queue, Task& task);
+	bool steal(uint32_t thief, Task& task);
+	bool tryExecute(uint32_t queue);
+	void execute(Task& task);
+	void finish(JobCounter& counter);
+	void workerLoop(uint32_t queue, Application* app);
+
+	// NOTE: Queue 0 belongs to the creating thread, 1..N to workers
+	std::vector<std::unique_ptr<Queue>> queues_;
+	std::vector<std::thread> workers_;
+
+	std::atomic<uint32_t> queued_{0};
+	std::atomic<uint32_t> next_queue_{0};
+
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_;
+	bool quit_;
+};
+
+template <typename Function>
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, Function&& function) {
+	if (count == 0) {
+		return;
+	}
+
+	if (grain == 0) {
+		grain = 1;
+	}
+
+	if (count <= grain || workers_.empty()) {
+		function(0u, count);
+		return;
+	}
+
+	JobCounter counter;
+
+	for (uint32_t begin = grain; begin < count; begin += grain) {
+		const uint32_t end = (count - begin > grain) ? begin + grain : count;
+		run([&function, begin, end] { function(begin, end); }, &counter);
+	}
+
+	function(0u, grain);
+
+	wait(counter);
+}
+
+} // namespace veekay
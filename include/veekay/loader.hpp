@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/memory.hpp>
+
+namespace veekay {
+
+struct Application;
+
+// NOTE: Staged copies of one load, filled on loader thread. Every region
+//       gets its own host visible staging buffer, freed once the copy
+//       has retired
+class Upload {
+public:
+	// NOTE: Staging memory for size bytes to be written by caller, copied
+	//       to dst at offset on GPU. Null on allocation failure
+	void* stage(VkBuffer dst, VkDeviceSize offset, VkDeviceSize size);
+
+	// NOTE: Same as stage() followed by memcpy of data
+	bool copy(VkBuffer dst, VkDeviceSize offset, const void* data, VkDeviceSize size);
+
+	VkDeviceSize size() const { return size_; }
+
+private:
+	friend class ResourceLoader;
+
+	struct Region {
+		Buffer staging;
+		VkBuffer dst;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	void release();
+
+	std::vector<Region> regions_;
+	VkDeviceSize size_ = 0;
+};
+
+// NOTE: Loads resources without blocking frames. Loads are queued from
+//       any thread and run one by one on a loader thread, where they do
+//       their CPU work (file reads, generation) and create buffers and
+//       fill staging memory through Upload. The main thread records and
+//       submits staged copies in poll(), and once their fence signals
+//       resolves the future and calls the callback, so apps draw
+//       placeholders until then
+class ResourceLoader {
+public:
+	// NOTE: Runs on loader thread, false discards staged data and fails
+	//       the load. Resources created by a failed load are its own to
+	//       clean up
+	using Load = std::function<bool(Upload& upload)>;
+
+	// NOTE: Runs on main thread inside poll(), after GPU copies retired
+	using Callback = std::function<void(bool success)>;
+
+	bool initialize();
+
+	// NOTE: Device must be idle, loads not finished yet are dropped
+	//       without calling their callbacks
+	void destroy();
+
+	// NOTE: Thread-safe. Future resolves on main thread in poll(), so
+	//       main thread should test it rather than wait on it
+	std::shared_future<bool> load(Load load, Callback done = {});
+
+	// NOTE: Main thread, once per frame before ui() (the framework does
+	//       it). Submits everything staged since last call on graphics
+	//       queue and completes loads whose copies have retired
+	void poll();
+
+	// NOTE: Main thread, blocks until every load queued so far completed
+	void flush();
+
+	// NOTE: Loads queued but not yet completed
+	uint32_t pendingCount() const { return pending_.load(std::memory_order_acquire); }
+
+private:
+	struct Request {
+		Load load;
+		Callback done;
+		std::promise<bool> promise;
+	};
+
+	struct Staged {
+		Upload upload;
+		bool success;
+		Callback done;
+		std::promise<bool> promise;
+	};
+
+	struct Batch {
+		VkCommandBuffer cmd;
+		VkFence fence;
+		std::vector<Staged> loads;
+	};
+
+	void loaderLoop(Application* app);
+	void complete(Staged& staged);
+	bool submit(std::vector<Staged>& loads);
+
+	VkDevice device_;
+	VkCommandPool command_pool_;
+
+	// NOTE: Main thread only. Submitted batches in submission order and
+	//       retired ones whose command buffer and fence can be reused
+	std::deque<Batch> in_flight_;
+	std::vector<Batch> free_batches_;
+
+	std::atomic<uint32_t> pending_{0};
+
+	// NOTE: Guards everything shared with loader thread below
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable staged_wake_;
+	std::deque<Request> requests_;
+	std::vector<Staged> staged_;
+	bool quit_;
+
+	std::thread loader_;
+};
+
+} // namespace veekay
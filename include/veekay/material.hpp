@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/memory.hpp>
+
+namespace veekay {
+
+// NOTE: Mirrors Material struct in shaders (std430 layout)
+struct Material {
+	float base_color[4];
+	float ambient;
+	float diffuse;
+	uint32_t texture_index;
+	uint32_t flags;
+};
+
+// NOTE: Bindless material storage. Every material lives in one storage
+//       buffer, every texture in one descriptor-indexed array, shaders
+//       index both by per-instance material ID. Single descriptor set is
+//       bound once per frame regardless of how many materials are drawn
+//
+//       Set layout:
+//         binding 0: readonly buffer Materials { Material materials[]; }
+//         binding 1: sampler2D textures[] (partially bound, variable count)
+class MaterialSystem {
+public:
+	static constexpr uint32_t no_texture = UINT32_MAX;
+
+	bool initialize(uint32_t max_materials, uint32_t max_textures);
+	void destroy();
+
+	uint32_t create(const Material& material);
+	void update(uint32_t id, const Material& material);
+	const Material& get(uint32_t id) const { return materials_[id]; }
+
+	// NOTE: Places view into texture array, returns its index there
+	uint32_t addTexture(VkImageView view);
+
+	// NOTE: Creates RGBA8 texture owned by material system and adds it,
+	//       blocks until upload is finished, meant for init time
+	uint32_t createTexture(uint32_t width, uint32_t height, const void* pixels);
+
+	// NOTE: Copies materials changed since last flush of this frame slot
+	//       into its storage buffer, call once frame's fence has signaled
+	void flush(uint32_t frame);
+
+	VkDescriptorSetLayout layout() const { return set_layout_; }
+	VkDescriptorSet set(uint32_t frame) const { return sets_[frame]; }
+
+private:
+	struct Texture {
+		VkImage image;
+		VkDeviceMemory memory;
+		VkImageView view;
+	};
+
+	void markDirty(uint32_t id);
+
+	uint32_t max_materials_;
+	uint32_t max_textures_;
+	uint32_t texture_count_;
+	uint8_t all_frames_mask_;
+
+	VkSampler sampler_;
+	VkDescriptorSetLayout set_layout_;
+	VkDescriptorPool pool_;
+
+	std::vector<Buffer> buffers_;
+	std::vector<VkDescriptorSet> sets_;
+	std::vector<Texture> textures_;
+
+	std::vector<Material> materials_;
+	std::vector<uint8_t> dirty_;
+	std::vector<uint32_t> dirty_list_;
+};
+
+} // namespace veekay
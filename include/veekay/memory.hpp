@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay {
+
+// NOTE: Host visible buffer, stays mapped for its whole lifetime.
+//       Device local ones from createDeviceBuffer() have mapped null
+struct Buffer {
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	VkDeviceSize size;
+	void* mapped;
+};
+
+// NOTE: What an allocation is used for, buffers are categorized by
+//       their usage flags
+enum class MemoryCategory {
+	vertex,
+	index,
+	uniform,
+	storage,
+	indirect,
+	image,
+	staging,
+	readback,
+	count,
+};
+
+const char* memoryCategoryName(MemoryCategory category);
+
+// NOTE: What happens to an allocation that exceeds configured budget
+enum class MemoryBudgetPolicy {
+	warn,
+	fail,
+};
+
+struct MemoryUsage {
+	VkDeviceSize current;
+	VkDeviceSize peak;
+	uint32_t allocations;
+};
+
+struct HeapUsage {
+	VkDeviceSize size;
+	bool device_local;
+
+	// NOTE: Allocations made through allocateMemory()
+	MemoryUsage tracked;
+
+	// NOTE: From VK_EXT_memory_budget as of last updateMemoryBudget(),
+	//       budget is heap size and process_usage zero without it
+	VkDeviceSize budget;
+	VkDeviceSize process_usage;
+};
+
+// NOTE: Statistics and budgets of memory allocated through the framework
+//       on one device. run() and every context with a device of its own
+//       keep one (Application::memory), contexts sharing a device share
+//       its owner's. Functions below go through the calling thread's app
+class MemoryTracker {
+public:
+	// NOTE: Called by run() and contexts once device exists. budget of
+	//       zero disables the device-wide limit, heap budgets still apply
+	//       under policy
+	void initialize(VkPhysicalDevice physical_device, VkDevice device, bool budget_extension,
+	                VkDeviceSize budget, MemoryBudgetPolicy policy);
+
+	// NOTE: Re-queries heap budgets and driver-reported usage
+	void updateBudget();
+
+	uint32_t findType(uint32_t type_bits, VkMemoryPropertyFlags flags) const;
+
+	VkDeviceMemory allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags flags,
+	                        MemoryCategory category, VkMemoryPropertyFlags preferred);
+	void free(VkDeviceMemory memory);
+
+	MemoryUsage usage(MemoryCategory category);
+	MemoryUsage usageTotal();
+
+	uint32_t heapCount() const { return properties_.memoryHeapCount; }
+	HeapUsage heapUsage(uint32_t heap);
+
+	VkDeviceSize budget() const { return budget_; }
+	MemoryBudgetPolicy budgetPolicy() const { return budget_policy_; }
+	bool budgetExtension() const { return budget_extension_; }
+
+private:
+	struct Allocation {
+		VkDeviceSize size;
+		uint32_t heap;
+		MemoryCategory category;
+	};
+
+	// NOTE: Expects mutex_ to be held
+	bool checkBudget(VkDeviceSize size, uint32_t heap);
+
+	VkPhysicalDevice physical_device_;
+	VkDevice device_;
+	VkPhysicalDeviceMemoryProperties properties_;
+
+	bool budget_extension_;
+	VkDeviceSize budget_;
+	MemoryBudgetPolicy budget_policy_;
+
+	// NOTE: Allocations may come from loader and job threads
+	std::mutex mutex_;
+
+	bool budget_warned_;
+	bool heap_warned_[VK_MAX_MEMORY_HEAPS];
+
+	MemoryUsage category_usage_[static_cast<uint32_t>(MemoryCategory::count)];
+	MemoryUsage total_usage_;
+	HeapUsage heap_usage_[VK_MAX_MEMORY_HEAPS];
+
+	std::unordered_map<VkDeviceMemory, Allocation> allocations_;
+};
+
+void updateMemoryBudget();
+
+// NOTE: Returns UINT32_MAX if no memory type satisfies both requirements
+uint32_t findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags flags);
+
+// NOTE: Tracked vkAllocateMemory, memory with preferred flags is picked
+//       when there is one. Returns VK_NULL_HANDLE on failure or when
+//       budget is exceeded under MemoryBudgetPolicy::fail
+VkDeviceMemory allocateMemory(const VkMemoryRequirements& requirements,
+                              VkMemoryPropertyFlags flags, MemoryCategory category,
+                              VkMemoryPropertyFlags preferred = 0);
+void freeMemory(VkDeviceMemory memory);
+
+MemoryUsage memoryUsage(MemoryCategory category);
+MemoryUsage memoryUsageTotal();
+
+uint32_t memoryHeapCount();
+HeapUsage memoryHeapUsage(uint32_t heap);
+
+// NOTE: ImGui window with per category and per heap usage, call from
+//       ui()
+void showMemoryWindow(bool* open = nullptr);
+
+// NOTE: Creates host visible, coherent buffer and copies data into it
+//       if data is not null. Memory with preferred flags is picked when
+//       there is one (e.g. HOST_CACHED for buffers CPU reads back from).
+//       Returns zeroed Buffer on failure
+Buffer createBuffer(VkDeviceSize size, const void* data, VkBufferUsageFlags usage,
+                    VkMemoryPropertyFlags preferred = 0);
+
+// NOTE: Creates device local buffer the CPU never touches, filled by
+//       GPU commands (transfers, compute). Returns zeroed Buffer on failure
+Buffer createDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage);
+
+void destroyBuffer(const Buffer& buffer);
+
+// NOTE: Destroys buffer once every frame in flight that may still use it
+//       has retired, for buffers replaced while earlier frames draw from
+//       them
+void destroyBufferDeferred(const Buffer& buffer);
+
+// NOTE: Called by run() once per frame after waiting for its fence, and
+//       with all set once device is idle at exit
+void collectDeferredBuffers(bool all = false);
+
+} // namespace veekay
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/memory.hpp>
+#include <veekay/geometry_pool.hpp>
+#include <veekay/Meshlet.hpp>
+
+namespace veekay {
+
+// NOTE: Mirrors push constants of meshlet_cull.comp and meshlet.mesh
+struct MeshletConstants {
+	float view_projection[16];
+
+	// NOTE: Camera position with w of 1, or view direction with w of 0 for
+	//       orthographic projection
+	float camera[4];
+
+	uint32_t instance;
+	uint32_t meshlet_count;
+	int32_t vertex_base;
+	uint32_t compact;
+};
+
+// NOTE: Cluster-level culling of one mesh instance. A compute pass
+//       (meshlet_cull.comp) rejects meshlets outside the frustum or facing
+//       away from the camera by their normal cone, and writes the rest
+//       both as a list of mesh shader workgroups and as indexed indirect
+//       draws. With VK_EXT_mesh_shader meshlet.mesh draws the list,
+//       otherwise draws go through the regular vertex pipeline over
+//       meshlet-ordered indices
+class MeshletRenderer {
+public:
+	// NOTE: mesh is where the vertices live in vertex_buffer (e.g. a
+	//       GeometryPool), data comes from geometry::buildMeshlets() of
+	//       the same mesh
+	bool initialize(VkShaderModule cull_shader, const geometry::MeshletData& data,
+	                const MeshRange& mesh, VkBuffer vertex_buffer);
+	void destroy();
+
+	// NOTE: Set 1 of mesh shader pipelines, set 0 is left to the app.
+	//       Push constants are MeshletConstants for VK_SHADER_STAGE_MESH_BIT_EXT.
+	//       Layout belongs to app.descriptors
+	VkDescriptorSetLayout setLayout() const { return set_layout_; }
+
+	// NOTE: Records culling of instance from frame's InstanceData buffer,
+	//       outside render pass. view_projection is column-major like GLSL.
+	//       Descriptor set of the frame is allocated here, when that fails
+	//       nothing is recorded and false is returned. Draws then have no
+	//       culling results of this frame to draw
+	bool cull(VkCommandBuffer cmd, VkBuffer instances, uint32_t instance,
+	          const float view_projection[16], const float camera[4]);
+
+	// NOTE: Vertex pipeline path, inside render pass with mesh's vertex
+	//       buffer and instance buffer bound. Binds its own index buffer
+	void draw(VkCommandBuffer cmd) const;
+
+	// NOTE: Mesh shader path, with a pipeline of layout bound. Binds set 1
+	//       and pushes constants of the last cull()
+	void drawMeshTasks(VkCommandBuffer cmd, VkPipelineLayout layout) const;
+
+	uint32_t meshletCount() const { return meshlet_count_; }
+
+	// NOTE: Whether draw count comes from GPU (VK_KHR_draw_indirect_count),
+	//       otherwise culled meshlets are drawn with zero instance count
+	bool compacting() const { return draw_indexed_indirect_count_ != nullptr; }
+
+private:
+	VkDevice device_;
+	PFN_vkCmdDrawIndexedIndirectCount draw_indexed_indirect_count_;
+	PFN_vkCmdDrawMeshTasksIndirectEXT draw_mesh_tasks_indirect_;
+
+	uint32_t meshlet_count_;
+	MeshRange mesh_;
+	MeshletConstants constants_;
+
+	VkDescriptorSetLayout set_layout_;
+	VkPipelineLayout cull_layout_;
+	VkPipeline cull_pipeline_;
+
+	// NOTE: Transient set of the frame being recorded
+	VkBuffer vertex_buffer_;
+	VkDescriptorSet set_;
+
+	Buffer meshlets_;
+	Buffer meshlet_vertices_;
+	Buffer meshlet_triangles_;
+	Buffer index_buffer_;
+
+	// NOTE: Visible meshlet IDs, indexed draws and mesh tasks command
+	//       whose x is the number of visible meshlets (and draw count)
+	Buffer visible_;
+	Buffer draws_;
+	Buffer tasks_;
+};
+
+} // namespace veekay
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/memory.hpp>
+#include <veekay/geometry_pool.hpp>
+
+namespace veekay {
+
+// NOTE: Which instances a cull pass writes draws for
+enum class CullPhase {
+	// Every instance is tested against pyramid of the previous frame's
+	// depth. Cheapest, but objects coming into view can pop in a frame late
+	single,
+	// Instances visible last frame, tested against frustum only
+	early,
+	// Every instance is tested against pyramid of the early pass depth,
+	// newly visible ones are drawn and visibility is kept for next frame
+	late,
+};
+
+// NOTE: GPU occlusion culling against a hierarchical depth (Hi-Z)
+//       pyramid. A compute pass reduces depth attachment into a mip chain
+//       of farthest depths, another one tests instance bounding spheres
+//       against it and writes one indirect draw per visible instance.
+//       Needs ApplicationConfig::depth_sampled. Shaders are pyramid.comp
+//       and cull.comp, loaded by the app
+class OcclusionCuller {
+public:
+	static constexpr uint32_t max_pyramid_levels = 16;
+
+	bool initialize(VkShaderModule pyramid_shader, VkShaderModule cull_shader,
+	                uint32_t max_instances, uint32_t max_meshes);
+	void destroy();
+
+	// NOTE: Mesh IDs match GeometryPool's, bounding sphere in mesh space
+	void setMesh(uint32_t mesh, const MeshRange& range, const float center[3], float radius);
+	void setInstanceMesh(uint32_t instance, uint32_t mesh);
+
+	// NOTE: Records culling of frame's InstanceData buffer, outside render
+	//       pass. view_projection is column-major like GLSL mat4
+	void cull(VkCommandBuffer cmd, CullPhase phase, VkBuffer instances, uint32_t instance_count,
+	          const float view_projection[16]);
+
+	// NOTE: Draws what cull() of the phase let through, inside render pass
+	//       with geometry pool and instance buffer bound
+	void draw(VkCommandBuffer cmd, CullPhase phase) const;
+
+	// NOTE: Reduces depth into pyramid, outside render pass after depth has
+	//       been written. Leaves depth ready for vk_render_pass_load, so the
+	//       frame can continue right after
+	void buildPyramid(VkCommandBuffer cmd);
+
+	// NOTE: Drops pyramid and visibility, e.g. after culling was off or the
+	//       camera jumped, so stale depth doesn't hide anything
+	void reset();
+
+	// NOTE: Whether draw count comes from GPU (VK_KHR_draw_indirect_count),
+	//       otherwise culled instances are drawn with zero instance count
+	bool compacting() const { return draw_indexed_indirect_count_ != nullptr; }
+
+private:
+	// NOTE: Mirrors Mesh struct in cull.comp (std430 layout)
+	struct GpuMesh {
+		float sphere[4];
+		uint32_t index_count;
+		uint32_t first_index;
+		int32_t vertex_offset;
+		uint32_t reserved;
+	};
+
+	VkDevice device_;
+	PFN_vkCmdDrawIndexedIndirectCount draw_indexed_indirect_count_;
+
+	uint32_t max_instances_;
+	uint32_t max_meshes_;
+
+	VkSampler sampler_;
+
+	VkDescriptorSetLayout pyramid_set_layout_;
+	VkPipelineLayout pyramid_layout_;
+	VkPipeline pyramid_pipeline_;
+
+	VkDescriptorSetLayout cull_set_layout_;
+	VkPipelineLayout cull_layout_;
+	VkPipeline cull_pipeline_;
+
+	VkDescriptorPool pool_;
+	std::vector<VkDescriptorSet> pyramid_sets_;
+	std::vector<VkDescriptorSet> cull_sets_;
+	std::vector<VkBuffer> cull_instances_;
+
+	// NOTE: Mip i is half of mip i - 1 rounded up, mip 0 is half of depth
+	VkImage pyramid_;
+	VkDeviceMemory pyramid_memory_;
+	VkImageView pyramid_view_;
+	VkImageView depth_view_;
+	VkImageView level_views_[max_pyramid_levels];
+	uint32_t pyramid_width_;
+	uint32_t pyramid_height_;
+	uint32_t pyramid_levels_;
+
+	// NOTE: Pyramid holds depth of an earlier pass, visibility was cleared
+	bool pyramid_valid_;
+	bool pyramid_ready_;
+	bool visibility_ready_;
+
+	Buffer meshes_;
+	Buffer instance_meshes_;
+	Buffer visibility_;
+
+	// NOTE: Draws of early (or single) phase, then of late phase, each
+	//       max_instances long. Counts hold one number per phase
+	Buffer draws_;
+	Buffer counts_;
+	uint32_t draw_counts_[2];
+};
+
+} // namespace veekay
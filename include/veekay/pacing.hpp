@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay {
+
+// NOTE: Smoothed over recent frames, in milliseconds
+struct FrameStats {
+	double frame_time;
+
+	// NOTE: From polling input to queueing the frame for presentation
+	double input_to_submit;
+
+	// NOTE: From queueing to the frame actually reaching the display, zero
+	//       unless VK_KHR_present_wait is supported
+	double submit_to_present;
+	bool present_wait;
+};
+
+// NOTE: Frame limiter and latency meter of the frame loop. Limiter sleeps
+//       before input is sampled, for as long as it predicts the frame can
+//       still make its slot, so frames aren't queued up ahead of display.
+//       With VK_KHR_present_wait a waiter thread timestamps completion of
+//       each present
+class FramePacer {
+public:
+	// NOTE: frame_limit in frames per second, zero disables limiter.
+	//       wait_for_present is vkWaitForPresentKHR or null
+	void initialize(VkDevice device, VkSwapchainKHR swapchain, double frame_limit,
+	                PFN_vkWaitForPresentKHR wait_for_present);
+	void destroy();
+
+	// NOTE: Called right before input is polled
+	void limit();
+	void inputSampled();
+
+	// NOTE: Called right before vkQueuePresentKHR, returns present ID to
+	//       pass in VkPresentIdKHR or zero when presents aren't waited on
+	uint64_t presentSubmitted();
+
+	const FrameStats& stats() const { return stats_; }
+
+private:
+	struct Pending {
+		uint64_t id;
+		uint64_t submitted;
+	};
+
+	void waiterLoop();
+
+	VkDevice device_;
+	VkSwapchainKHR swapchain_;
+	PFN_vkWaitForPresentKHR wait_for_present_;
+
+	uint64_t period_;
+	uint64_t predicted_work_;
+
+	uint64_t input_sampled_;
+	uint64_t last_submit_;
+	uint64_t last_frame_;
+	uint64_t next_present_id_;
+
+	FrameStats stats_;
+
+	std::thread waiter_;
+	std::mutex mutex_;
+	std::condition_variable pending_cv_;
+	std::deque<Pending> pending_;
+	bool quit_;
+
+	// NOTE: Latest submit to present latency in nanoseconds from waiter
+	std::atomic<uint64_t> present_latency_;
+};
+
+} // namespace veekay
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay {
+
+constexpr uint32_t max_vertex_bindings = 4;
+constexpr uint32_t max_vertex_attributes = 16;
+constexpr uint32_t max_specialization_constants = 8;
+
+// NOTE: Complete description of a graphics pipeline state. Viewport and
+//       scissor are not part of it, pipelines are created with them as
+//       dynamic state, so apps must call vkCmdSetViewport/vkCmdSetScissor
+struct PipelineDescription {
+	VkShaderModule vertex_shader;
+	VkShaderModule fragment_shader;
+
+	// NOTE: VK_EXT_mesh_shader stage replacing vertex_shader, vertex input
+	//       and topology are ignored when set
+	VkShaderModule mesh_shader = VK_NULL_HANDLE;
+
+	uint32_t binding_count;
+	VkVertexInputBindingDescription bindings[max_vertex_bindings];
+	uint32_t attribute_count;
+	VkVertexInputAttributeDescription attributes[max_vertex_attributes];
+
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPolygonMode polygon_mode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cull_mode = VK_CULL_MODE_NONE;
+	VkFrontFace front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	bool depth_test = true;
+	bool depth_write = true;
+	VkCompareOp depth_compare = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	// NOTE: Standard "over" alpha blending on the single color attachment
+	bool blend = false;
+
+	// NOTE: Values of specialization constants with IDs from zero up to
+	//       specialization_count, passed to every stage. 32 bits each,
+	//       VkBool32, int, uint or float bits
+	uint32_t specialization_count = 0;
+	uint32_t specialization[max_specialization_constants] = {};
+
+	VkPipelineLayout layout;
+	VkRenderPass render_pass;
+	uint32_t subpass;
+};
+
+bool operator==(const PipelineDescription& a, const PipelineDescription& b);
+
+struct PipelineDescriptionHash {
+	size_t operator()(const PipelineDescription& description) const;
+};
+
+// NOTE: Creates pipelines on request and deduplicates identical ones,
+//       pipelines stay alive until registry is destroyed
+class PipelineRegistry {
+public:
+	bool initialize(VkDevice device);
+	void destroy();
+
+	// NOTE: Returns existing pipeline for equal description or creates one,
+	//       VK_NULL_HANDLE on failure. Threads creating different pipelines
+	//       don't wait for each other
+	VkPipeline request(const PipelineDescription& description);
+
+	size_t size() const { return pipelines_.size(); }
+
+private:
+	VkPipeline create(const PipelineDescription& description);
+
+	VkDevice device_;
+	VkPipelineCache cache_;
+
+	std::mutex mutex_;
+	std::unordered_map<PipelineDescription, VkPipeline, PipelineDescriptionHash> pipelines_;
+};
+
+} // namespace veekay
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// NOTE: Zones are compiled in only with VEEKAY_PROFILER defined (CMake
+//       option of the same name). Otherwise the macros expand to nothing
+//       and instrumented code costs nothing
+#if defined(VEEKAY_PROFILER)
+#define VEEKAY_PROFILE_CONCAT_(a, b) a##b
+#define VEEKAY_PROFILE_CONCAT(a, b) VEEKAY_PROFILE_CONCAT_(a, b)
+
+// NOTE: name must outlive the profiler, i.e. be a string literal
+#define VEEKAY_PROFILE_SCOPE(name) \
+	::veekay::ProfileScope VEEKAY_PROFILE_CONCAT(veekay_profile_scope_, __LINE__)(name)
+#define VEEKAY_PROFILE_FUNCTION() VEEKAY_PROFILE_SCOPE(__func__)
+
+// NOTE: Names calling thread in exported trace, name is copied
+#define VEEKAY_PROFILE_THREAD(name) ::veekay::setProfilerThreadName(name)
+#else
+#define VEEKAY_PROFILE_SCOPE(name) ((void)0)
+#define VEEKAY_PROFILE_FUNCTION() ((void)0)
+#define VEEKAY_PROFILE_THREAD(name) ((void)0)
+#endif
+
+namespace veekay {
+
+// NOTE: Events are recorded while enabled. Each thread writes into its own
+//       lock-free ring, oldest events get overwritten when it's full
+void setProfilerEnabled(bool enabled);
+bool profilerEnabled();
+
+// NOTE: Use VEEKAY_PROFILE_THREAD() instead, it is compiled out along
+//       with zones
+void setProfilerThreadName(const char* name);
+
+// NOTE: Writes every event still held in thread rings as Chrome trace
+//       JSON, loadable by chrome://tracing and Perfetto
+bool writeProfilerTrace(const char* path);
+
+inline uint64_t profilerTimestamp() {
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void recordProfileZone(const char* name, uint64_t start, uint64_t end);
+
+class ProfileScope {
+public:
+	explicit ProfileScope(const char* name)
+		: name_(name), start_(profilerEnabled() ? profilerTimestamp() : 0) {}
+
+	~ProfileScope() {
+		if (start_ != 0) {
+			recordProfileZone(name_, start_, profilerTimestamp());
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* name_;
+	uint64_t start_;
+};
+
+} // namespace veekay
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace veekay {
+
+class JobSystem;
+
+// NOTE: Per-instance record as it lays out in GPU instance buffer,
+//       model matrix is column-major to match GLSL mat4
+struct InstanceData {
+	float model[16];
+	uint32_t material;
+	uint32_t reserved[3];
+};
+
+// NOTE: Transform storage for scene objects. Components are kept as
+//       separate arrays (SoA), so batched matrix computation walks
+//       contiguous memory. Each object tracks which frames in flight still
+//       have stale copies of its instance data, only those get rewritten
+class Scene {
+public:
+	static constexpr uint32_t max_frames = 8;
+
+	explicit Scene(uint32_t frame_count);
+
+	uint32_t create();
+
+	void setPosition(uint32_t id, float x, float y, float z);
+	void setRotation(uint32_t id, float axis_x, float axis_y, float axis_z, float angle);
+	void setScale(uint32_t id, float x, float y, float z);
+	void setMaterial(uint32_t id, uint32_t material);
+
+	uint32_t size() const { return static_cast<uint32_t>(position_x_.size()); }
+	size_t dirtyCount() const { return dirty_list_.size(); }
+
+	// NOTE: Writes instance data of objects changed since the last flush of
+	//       this frame slot, instances points to frame's mapped GPU memory.
+	//       Returns number of records written
+	uint32_t flush(uint32_t frame, InstanceData* instances);
+
+	// NOTE: Same, matrix batches are computed on job system workers
+	uint32_t flush(uint32_t frame, InstanceData* instances, JobSystem& jobs);
+
+private:
+	void markDirty(uint32_t id);
+	void computeBatch(const uint32_t* ids, uint32_t count, InstanceData* instances) const;
+
+	uint8_t all_frames_mask_;
+
+	std::vector<float> position_x_, position_y_, position_z_;
+	std::vector<float> rotation_x_, rotation_y_, rotation_z_, rotation_w_;
+	std::vector<float> scale_x_, scale_y_, scale_z_;
+	std::vector<uint32_t> material_;
+
+	// NOTE: Bit N set means frame slot N holds outdated instance data
+	std::vector<uint8_t> dirty_;
+	std::vector<uint32_t> dirty_list_;
+
+	// NOTE: Objects gathered for parallel flush, kept to avoid reallocation
+	std::vector<uint32_t> flush_ids_;
+};
+
+} // namespace veekay
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/veekay.hpp>
+#include <veekay/memory.hpp>
+
+namespace veekay {
+
+// NOTE: Narrows column-major projection (GLSL layout) in place to the
+//       sub-frustum of app.tile, so the tile's part of the image fills
+//       the viewport. Does nothing unless a tile is being rendered
+void tileProjection(float projection[16]);
+
+// NOTE: What run() does with ApplicationConfig::tiled_output, for the app
+//       bound to calling thread: renders tiled_frames images, every one
+//       after the first at app.clock advanced to now(). A run of # in
+//       tiled_output becomes frame number, padded to its length. Fails
+//       when tiled_output is empty
+bool renderTiledFrames(const ApplicationInfo& app_info, const ApplicationConfig& config,
+                       VkFormat color_format, VkFormat depth_format, VkRenderPass render_pass,
+                       VkImageLayout color_layout, double (*now)());
+
+// NOTE: Renders an image larger than a device could hold in a single
+//       render target (or larger than maxImageDimension2D) tile by tile.
+//       Each tile is rendered by the app's render() into one of a small
+//       ring of offscreen targets compatible with vk_render_pass, copied
+//       into a readback buffer and written into its place in a binary PPM
+//       file by a writer thread, so at most ring size tiles are in memory
+class TiledRenderer {
+public:
+	// NOTE: slot_count is at most frames_in_flight, tiles reuse the app's
+	//       frame slots (app.frame_index) for their per-frame resources.
+	//       color_layout is the final layout of render_pass color
+	bool initialize(VkFormat color_format, VkFormat depth_format, VkRenderPass render_pass,
+	                VkImageLayout color_layout, uint32_t tile_size, uint32_t slot_count);
+	void destroy();
+
+	// NOTE: Blocks until every tile is on disk. While a tile is recorded
+	//       app.tile describes it and app.window_width/window_height are
+	//       the tile size, both are restored afterwards
+	bool render(const std::string& path, uint32_t width, uint32_t height, RenderFunc render);
+
+private:
+	struct Slot {
+		VkImage color;
+		VkDeviceMemory color_memory;
+		VkImageView color_view;
+
+		VkImage depth;
+		VkDeviceMemory depth_memory;
+		VkImageView depth_view;
+
+		VkFramebuffer framebuffer;
+		VkCommandBuffer cmd;
+		VkCommandBuffer copy_cmd;
+		VkFence fence;
+		Buffer readback;
+
+		// NOTE: Submitted is main thread only, writing is guarded by mutex_
+		bool submitted;
+		bool writing;
+		TileInfo tile;
+	};
+
+	bool createImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+	                 VkImage& image, VkDeviceMemory& memory, VkImageView& view);
+	void recordCopy(Slot& slot);
+	void retire(uint32_t slot);
+	void writerLoop();
+	void write(uint32_t slot);
+
+	VkDevice device_;
+	uint32_t tile_size_;
+	bool swizzle_;
+	VkImageLayout color_layout_;
+
+	VkCommandPool command_pool_;
+	std::vector<Slot> slots_;
+
+	FILE* file_;
+	uint32_t image_width_;
+	bool write_failed_;
+
+	// NOTE: Guards everything shared with writer thread below
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable written_;
+	std::deque<uint32_t> jobs_;
+	bool quit_;
+
+	// NOTE: Touched by writer thread only
+	std::thread writer_;
+	std::vector<uint8_t> row_;
+};
+
+} // namespace veekay
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace veekay {
+
+// NOTE: Lock-free single producer, single consumer handoff of the latest
+//       value. Writer fills back() and publishes it, reader fetches the
+//       newest published value, neither ever waits for the other.
+//       Published values may be skipped, reader only sees the latest one
+template <typename T>
+class TripleBuffer {
+public:
+	// NOTE: Writer side. back() holds an older value, not the last
+	//       published one, so it has to be written in full every time
+	T& back() { return buffers_[back_]; }
+
+	void publish() {
+		const uint8_t previous = state_.exchange(back_ | fresh_bit, std::memory_order_acq_rel);
+		back_ = previous & index_mask;
+	}
+
+	// NOTE: Reader side. Returns true if front() changed to a newer value
+	bool fetch() {
+		if (!(state_.load(std::memory_order_relaxed) & fresh_bit)) {
+			return false;
+		}
+
+		const uint8_t previous = state_.exchange(front_, std::memory_order_acq_rel);
+		front_ = previous & index_mask;
+		return true;
+	}
+
+	const T& front() const { return buffers_[front_]; }
+
+private:
+	static constexpr uint8_t index_mask = 0x3;
+	static constexpr uint8_t fresh_bit = 0x4;
+
+	T buffers_[3]{};
+
+	// NOTE: Index of the middle buffer plus fresh bit set by publish().
+	//       Sides are kept on separate cache lines
+	alignas(64) std::atomic<uint8_t> state_{1};
+	alignas(64) uint8_t back_ = 0;
+	alignas(64) uint8_t front_ = 2;
+};
+
+} // namespace veekay
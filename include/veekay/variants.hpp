@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/pipeline.hpp>
+
+namespace veekay {
+
+// NOTE: Values of specialization constants 0..count-1 selecting one
+//       variant of a pipeline, see PipelineDescription::specialization
+struct ShaderVariant {
+	uint32_t count;
+	uint32_t constants[max_specialization_constants];
+};
+
+bool operator==(const ShaderVariant& a, const ShaderVariant& b);
+
+struct ShaderVariantHash {
+	size_t operator()(const ShaderVariant& variant) const;
+};
+
+// NOTE: Variants of one pipeline differing only in specialization constants,
+//       built on first request. Driver removes branches on constants, so
+//       every variant only contains code it actually uses. Pipelines belong
+//       to app.pipelines, cache only remembers them. Not thread-safe, use
+//       from one thread at a time, background builds complete on main thread
+class VariantCache {
+public:
+	// NOTE: Specialization of base is replaced by the one of each variant
+	void initialize(const PipelineDescription& base);
+
+	// NOTE: Completions of background builds refer to the cache, so none
+	//       may be queued, i.e. loader flushed or destroyed (loader is
+	//       destroyed before app's shutdown())
+	void destroy();
+
+	// NOTE: Builds missing variant on calling thread, VK_NULL_HANDLE on failure
+	VkPipeline request(const ShaderVariant& variant);
+
+	// NOTE: Main thread. Queues missing variant to be built on loader thread
+	//       and returns VK_NULL_HANDLE until it's ready (or failed), so apps
+	//       keep drawing with the variant they had. Never blocks on compile
+	VkPipeline requestAsync(const ShaderVariant& variant);
+
+	// NOTE: Variants built so far and ones being built in background
+	size_t size() const { return variants_.size() - pending_; }
+	uint32_t pendingCount() const { return pending_; }
+
+private:
+	struct Entry {
+		VkPipeline pipeline;
+		bool pending;
+	};
+
+	PipelineDescription describe(const ShaderVariant& variant) const;
+
+	PipelineDescription base_;
+
+	// NOTE: Failed variants stay with null pipeline and are not retried
+	std::unordered_map<ShaderVariant, Entry, ShaderVariantHash> variants_;
+	uint32_t pending_ = 0;
+};
+
+} // namespace veekay
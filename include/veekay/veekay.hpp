@@ -1,14 +1,44 @@
 #pragma once
 
+#include <string>
+
 #include <vulkan/vulkan_core.h>
 
+#include <veekay/clock.hpp>
+#include <veekay/memory.hpp>
+
 namespace veekay {
 
+class PipelineRegistry;
+class DescriptorAllocator;
+class FrameCapture;
+class JobSystem;
+class ResourceLoader;
+struct FrameStats;
+
 typedef void (*InitFunc)();
 typedef void (*ShutdownFunc)();
 typedef void (*UpdateFunc)(double time);
+typedef void (*UiFunc)();
 typedef void (*RenderFunc)(VkCommandBuffer, VkFramebuffer);
 
+// NOTE: Part of a larger image rendered tile by tile (veekay/tiled.hpp).
+//       Clip space xy of the whole image maps to scale * xy + offset * w
+//       of the tile, tileProjection() applies this to a projection
+struct TileInfo {
+	bool active;
+	uint32_t image_width;
+	uint32_t image_height;
+
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+
+	float scale[2];
+	float offset[2];
+};
+
 struct Application {
 	uint32_t window_width;
 	uint32_t window_height;
@@ -17,18 +47,202 @@ struct Application {
 	VkPhysicalDevice vk_physical_device;
 	VkRenderPass vk_render_pass;
 
+	// NOTE: Exist only with ApplicationConfig::depth_sampled. Depth image
+	//       is left in DEPTH_STENCIL_ATTACHMENT_OPTIMAL after render pass.
+	//       vk_render_pass_load is compatible with vk_render_pass and uses
+	//       the same framebuffers, but loads color and depth instead of
+	//       clearing, for splitting a frame into several passes
+	VkImage vk_depth_image;
+	VkFormat vk_depth_format;
+	VkRenderPass vk_render_pass_load;
+
+	VkQueue vk_graphics_queue;
+	uint32_t vk_graphics_queue_family;
+
+	// NOTE: VK_KHR_draw_indirect_count is enabled
+	bool draw_indirect_count;
+
+	// NOTE: VK_EXT_mesh_shader is enabled, with ApplicationConfig::mesh_shader
+	bool mesh_shader;
+
+	// NOTE: Statistics and budgets of this app's device, allocations
+	//       through veekay/memory.hpp functions are counted here
+	MemoryTracker* memory;
+
+	// NOTE: Shared pipeline cache, request pipelines by description
+	//       instead of creating them directly
+	PipelineRegistry* pipelines;
+
+	// NOTE: Descriptor set layouts and sets, per frame sets are recycled
+	//       when the frame slot comes round again
+	DescriptorAllocator* descriptors;
+
+	// NOTE: Streams presented frames to disk, null when swapchain images
+	//       can't be used as transfer source on this surface
+	FrameCapture* capture;
+
+	// NOTE: Source of time passed to update(), also holds fixed step
+	//       count and interpolation factor in fixed_step mode
+	Clock* clock;
+
+	// NOTE: Worker thread pool for CPU work split into jobs, update() and
+	//       render() may fan out through it and wait before returning
+	JobSystem* jobs;
+
+	// NOTE: Loader thread for resources streamed in while frames go on,
+	//       see veekay/loader.hpp. Completions arrive before ui()
+	ResourceLoader* loader;
+
+	// NOTE: Frame in flight slot being recorded, resources written by CPU
+	//       every frame should be duplicated frames_in_flight times
+	uint32_t frame_index;
+	uint32_t frames_in_flight;
+
+	// NOTE: update() runs on its own thread concurrently with ui() and
+	//       render(), it must hand state over through TripleBuffer
+	//       (veekay/triple_buffer.hpp) and can't call ImGui
+	bool simulation_threaded;
+
+	// NOTE: Frame time and input to display latency, see veekay/pacing.hpp
+	const FrameStats* frame_stats;
+
+	// NOTE: Tile being recorded in tiled rendering, window_width and
+	//       window_height are the tile size then. Inactive otherwise
+	TileInfo tile;
+
 	bool running;
 };
 
+// NOTE: Where ImGui overlay gets drawn
+enum class OverlayMode {
+	// Separate render pass recorded by the library after app's commands,
+	// reloads swapchain image contents
+	separate_pass,
+	// App calls renderOverlay() at the tail of its own render pass,
+	// no extra render pass, no color reload
+	app_pass,
+};
+
 struct ApplicationInfo {
 	InitFunc init;
 	ShutdownFunc shutdown;
 	UpdateFunc update;
 	RenderFunc render;
+
+	// NOTE: Optional, ImGui widgets go here. Always called on main thread
+	//       between input polling and render(), right before update() when
+	//       simulation isn't threaded
+	UiFunc ui;
+
+	OverlayMode overlay_mode;
+};
+
+enum class DeviceType {
+	any,
+	discrete,
+	integrated,
+	virtual_gpu,
+	cpu,
 };
 
-extern Application app;
+// NOTE: Startup knobs of run(), filled in code or by parseConfig() from
+//       VEEKAY_* environment variables and command line flags
+struct ApplicationConfig {
+	uint32_t window_width = 1280;
+	uint32_t window_height = 720;
+
+	// NOTE: Clamped to [1, 8], frame slot masks are 8 bits wide
+	uint32_t frames_in_flight = 2;
+
+	// NOTE: Falls back to FIFO when surface doesn't support it
+	VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
+
+	// NOTE: low_latency waits for the frame slot before polling input
+	//       rather than before acquiring an image, so the frame shows the
+	//       newest input. frame_limit caps frames per second (zero is off)
+	//       by sleeping before input is polled
+	bool low_latency = false;
+	double frame_limit = 0.0;
+
+#if defined(NDEBUG)
+	bool validation = false;
+#else
+	bool validation = true;
+#endif
+
+	// NOTE: Preferred GPU, device_name matches any part of device name.
+	//       Devices meeting requirements are used if none matches
+	std::string device_name;
+	DeviceType device_type = DeviceType::any;
+
+	// NOTE: VK_FORMAT_UNDEFINED picks first supported of D32, D32S8, D24S8
+	VkFormat depth_format = VK_FORMAT_UNDEFINED;
+
+	// NOTE: Stores depth after render pass and lets shaders sample it, e.g.
+	//       for occlusion culling (veekay/occlusion.hpp). Otherwise depth is
+	//       a transient attachment that may never leave tile memory
+	bool depth_sampled = false;
+
+	// NOTE: Enables VK_EXT_mesh_shader when device supports it, see
+	//       Application::mesh_shader for the outcome
+	bool mesh_shader = true;
+
+	// NOTE: Limit in bytes on memory allocated through the framework,
+	//       zero means no limit
+	VkDeviceSize memory_budget = 0;
+	MemoryBudgetPolicy memory_budget_policy = MemoryBudgetPolicy::warn;
+
+	// NOTE: Job system worker count, zero means one per hardware thread
+	//       besides the main one
+	uint32_t worker_threads = 0;
+
+	// NOTE: clock_step is the step in seconds for fixed clock modes
+	ClockMode clock_mode = ClockMode::real_time;
+	double clock_step = 1.0 / 60.0;
+
+	// NOTE: Runs update() on a separate simulation thread at
+	//       simulation_rate updates per second (zero means unthrottled)
+	//       instead of once per frame before render()
+	bool simulation_thread = false;
+	double simulation_rate = 120.0;
+
+	// NOTE: Optional paths, ImGui input and clock state of every frame is
+	//       recorded to record_input or replayed from playback_input, app
+	//       stops when playback reaches the end of recording
+	std::string record_input;
+	std::string playback_input;
+
+	// NOTE: Enables CPU profiler for the whole run and writes Chrome trace
+	//       JSON here on exit, needs library built with VEEKAY_PROFILER
+	std::string profile_output;
+
+	// NOTE: Renders tiled_frames tiled_width x tiled_height images into
+	//       binary PPM tiled_output instead of showing frames, then exits.
+	//       Window stays hidden, tiles of tile_size go through frame slots
+	//       and are written as they finish. Zero dimensions take the window
+	//       size, #### in tiled_output is replaced with frame number
+	std::string tiled_output;
+	uint32_t tiled_width = 0;
+	uint32_t tiled_height = 0;
+	uint32_t tile_size = 2048;
+	uint32_t tiled_frames = 1;
+};
+
+// NOTE: Application of the context the calling thread belongs to. run()
+//       points it at its own on the main thread, Context::run() at the
+//       context's (veekay/context.hpp). Threads started by either, like
+//       job workers and the loader, inherit it; null on foreign threads
+extern thread_local Application* app;
+
+int run(const ApplicationInfo& app_info, const ApplicationConfig& config = {});
+
+// NOTE: Applies VEEKAY_* environment variables, then --flags from argv
+//       on top of config. Prints usage and returns false on bad input,
+//       see source/config.cpp for the full list
+bool parseConfig(int argc, char** argv, ApplicationConfig& config);
 
-int run(const ApplicationInfo& app_info);
+// NOTE: Records ImGui draw commands into the currently recorded subpass of
+//       vk_render_pass, does nothing unless overlay_mode is app_pass
+void renderOverlay(VkCommandBuffer cmd);
 
 } // namespace veekay
@@ -1,22 +1,143 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec3 frag_normal;
-layout (location = 1) in vec3 frag_color;
+layout (location = 1) in vec2 frag_uv;
+layout (location = 2) flat in uint frag_material;
+layout (location = 3) in vec3 frag_position;
 
 layout (location = 0) out vec4 final_color;
 
-layout (push_constant, std430) uniform ShaderConstants {
-	mat4 projection;
-	mat4 view;
-	mat4 transform;
+// NOTE: Specialization constants, each pipeline variant is compiled with
+//       its own values and branches on them are removed by the driver
+layout (constant_id = 0) const uint lighting_model = 1; // 0 unlit, 1 Lambert, 2 half-Lambert
+layout (constant_id = 1) const uint light_count = 1;
+layout (constant_id = 2) const bool textured = true;
+layout (constant_id = 3) const bool hemisphere_ambient = false;
+layout (constant_id = 4) const bool clustered_lights = false;
+
+const uint no_texture = 0xFFFFFFFFu;
+
+const uint max_lights = 4;
+
+// NOTE: Mirrors ClusteredLighting::max_lights_per_cluster
+const uint max_lights_per_cluster = 256;
+
+const vec3 light_directions[max_lights] = vec3[](
+	normalize(vec3(1.0, 1.0, 1.0)),
+	normalize(vec3(-1.0, 0.5, -0.5)),
+	normalize(vec3(0.0, -1.0, 0.25)),
+	normalize(vec3(0.5, 0.25, -1.0))
+);
+
+const vec3 light_colors[max_lights] = vec3[](
+	vec3(1.0, 1.0, 1.0),
+	vec3(0.35, 0.4, 0.55),
+	vec3(0.25, 0.2, 0.15),
+	vec3(0.3, 0.25, 0.2)
+);
+
+struct Material {
+	vec4 base_color;
+	float ambient;
+	float diffuse;
+	uint texture_index;
+	uint flags;
+};
+
+// NOTE: Bindless material data, indexed by per-instance material ID
+layout (set = 0, binding = 0, std430) readonly buffer Materials {
+	Material materials[];
+};
+
+layout (set = 0, binding = 1) uniform sampler2D textures[];
+
+// NOTE: Mirrors veekay::PointLight
+struct PointLight {
+	vec3 position;
+	float radius;
 	vec3 color;
+	float intensity;
+};
+
+// NOTE: Point lights binned into clusters by light_cull.comp, set 1 is
+//       left for meshlet.mesh
+layout (set = 2, binding = 0, std430) readonly buffer Lights {
+	mat4 view;
+	mat4 inverse_projection;
+	uvec4 grid;   // Tiles x, tiles y, slices, light count
+	vec4 screen;  // Width, height, near, far
+	vec4 slicing; // End of first slice, 1 for linear slices
+	PointLight lights[];
 };
 
+layout (set = 2, binding = 1, std430) readonly buffer ClusterCounts { uint cluster_counts[]; };
+layout (set = 2, binding = 2, std430) readonly buffer ClusterLights { uint cluster_lights[]; };
+
+float diffuse(float n_dot_l) {
+	return lighting_model == 2 ? pow(n_dot_l * 0.5 + 0.5, 2.0) : max(n_dot_l, 0.0);
+}
+
+// NOTE: Same slices as sliceDepth() of light_cull.comp
+uint clusterIndex(float depth) {
+	uint slice = 0;
+	if (slicing.y != 0.0f) {
+		slice = uint(max(depth - screen.z, 0.0f) / (screen.w - screen.z) * float(grid.z));
+	} else if (depth > slicing.x) {
+		slice = 1 + uint(log(depth / slicing.x) / log(screen.w / slicing.x) * float(grid.z - 1));
+	}
+
+	uvec3 cluster = uvec3(gl_FragCoord.xy / screen.xy * vec2(grid.xy), slice);
+	cluster = min(cluster, grid.xyz - 1);
+
+	return (cluster.z * grid.y + cluster.y) * grid.x + cluster.x;
+}
+
 void main() {
-	// Simple diffuse lighting
-	vec3 light_dir = normalize(vec3(1.0, 1.0, 1.0));
-	float diff = max(dot(normalize(frag_normal), light_dir), 0.0);
-	vec3 shaded_color = frag_color * (0.3 + 0.7 * diff);
+	Material material = materials[frag_material];
+
+	vec3 color = material.base_color.rgb;
+	if (textured && material.texture_index != no_texture) {
+		color *= texture(textures[nonuniformEXT(material.texture_index)], frag_uv).rgb;
+	}
+
+	if (lighting_model == 0) {
+		final_color = vec4(color, material.base_color.a);
+		return;
+	}
+
+	vec3 normal = normalize(frag_normal);
+
+	// NOTE: Sky above, ground below, instead of flat ambient term
+	vec3 ambient = vec3(material.ambient);
+	if (hemisphere_ambient) {
+		ambient *= mix(vec3(0.5, 0.45, 0.4), vec3(1.1, 1.15, 1.25), normal.y * 0.5 + 0.5);
+	}
+
+	vec3 lighting = vec3(0.0);
+	for (uint i = 0; i < light_count && i < max_lights; ++i) {
+		lighting += light_colors[i] * diffuse(dot(normal, light_directions[i]));
+	}
+
+	// NOTE: Only lights of the fragment's cluster, smooth falloff to zero
+	//       at light radius
+	if (clustered_lights) {
+		uint cluster = clusterIndex(-(view * vec4(frag_position, 1.0)).z);
+		uint count = cluster_counts[cluster];
+
+		for (uint i = 0; i < count; ++i) {
+			PointLight light = lights[cluster_lights[cluster * max_lights_per_cluster + i]];
+
+			vec3 to_light = light.position - frag_position;
+			float light_distance = length(to_light);
+			float falloff = clamp(1.0 - light_distance / light.radius, 0.0, 1.0);
+
+			float diff = diffuse(dot(normal, to_light / max(light_distance, 1e-4)));
+			lighting += light.color * (light.intensity * falloff * falloff * diff);
+		}
+	}
+
+	vec3 shaded_color = color * (ambient + material.diffuse * lighting);
 
-	final_color = vec4(shaded_color, 1.0f);
+	final_color = vec4(shaded_color, material.base_color.a);
 }
\ No newline at end of file
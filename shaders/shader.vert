@@ -2,25 +2,32 @@
 
 layout (location = 0) in vec3 v_position;
 layout (location = 1) in vec3 v_normal;
+layout (location = 2) in vec2 v_uv;
+
+// NOTE: Per-instance attributes, model matrix takes 4 locations
+layout (location = 3) in mat4 i_model;
+layout (location = 7) in uint i_material;
 
 layout (push_constant, std430) uniform ShaderConstants {
 	mat4 projection;
 	mat4 view;
-	mat4 transform;
-	vec3 color;
 };
 
 layout (location = 0) out vec3 frag_normal;
-layout (location = 1) out vec3 frag_color;
+layout (location = 1) out vec2 frag_uv;
+layout (location = 2) flat out uint frag_material;
+layout (location = 3) out vec3 frag_position;
 
 void main() {
 	vec4 point = vec4(v_position, 1.0f);
-	vec4 transformed = transform * point;
+	vec4 transformed = i_model * point;
 	vec4 viewed = view * transformed;
 	vec4 projected = projection * viewed;
 
 	gl_Position = projected;
 
-	frag_normal = mat3(transform) * v_normal; // Transform normal
-	frag_color = color;
+	frag_normal = mat3(i_model) * v_normal; // Transform normal
+	frag_uv = v_uv;
+	frag_material = i_material;
+	frag_position = transformed.xyz;
 }
\ No newline at end of file
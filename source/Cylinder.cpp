@@ -1,4 +1,5 @@
 #include "veekay/Cylinder.hpp"
+#include "veekay/profiler.hpp"
 #include <cmath>
 
 namespace geometry {
@@ -8,6 +9,8 @@ Cylinder::Cylinder(float radius, float height, uint32_t segments) {
 }
 
 void Cylinder::generate(float radius, float height, uint32_t segments) {
+    VEEKAY_PROFILE_FUNCTION();
+
     vertices_.clear();
     indices_.clear();
 
@@ -16,6 +19,9 @@ void Cylinder::generate(float radius, float height, uint32_t segments) {
         float angle = 2.0f * M_PI * i / segments;
         float next_angle = 2.0f * M_PI * (i + 1) / segments;
 
+        float u1 = float(i) / segments;
+        float u2 = float(i + 1) / segments;
+
         float x1 = radius * cosf(angle);
         float z1 = radius * sinf(angle);
         float x2 = radius * cosf(next_angle);
@@ -25,22 +31,26 @@ void Cylinder::generate(float radius, float height, uint32_t segments) {
         Vertex bottom1;
         bottom1.position = {x1, 0.0f, z1};
         bottom1.normal = {x1 / radius, 0.0f, z1 / radius};
+        bottom1.uv = {u1, 1.0f};
         vertices_.push_back(bottom1);
 
         Vertex bottom2;
         bottom2.position = {x2, 0.0f, z2};
         bottom2.normal = {x2 / radius, 0.0f, z2 / radius};
+        bottom2.uv = {u2, 1.0f};
         vertices_.push_back(bottom2);
 
         // Top
         Vertex top1;
         top1.position = {x1, height, z1};
         top1.normal = {x1 / radius, 0.0f, z1 / radius};
+        top1.uv = {u1, 0.0f};
         vertices_.push_back(top1);
 
         Vertex top2;
         top2.position = {x2, height, z2};
         top2.normal = {x2 / radius, 0.0f, z2 / radius};
+        top2.uv = {u2, 0.0f};
         vertices_.push_back(top2);
 
         // Indices for side quad
@@ -58,6 +68,7 @@ void Cylinder::generate(float radius, float height, uint32_t segments) {
     Vertex top_center;
     top_center.position = {0.0f, height, 0.0f};
     top_center.normal = {0.0f, 1.0f, 0.0f};
+    top_center.uv = {0.5f, 0.5f};
     vertices_.push_back(top_center);
 
     for (uint32_t i = 0; i < segments; ++i) {
@@ -73,6 +84,7 @@ void Cylinder::generate(float radius, float height, uint32_t segments) {
     Vertex bottom_center;
     bottom_center.position = {0.0f, 0.0f, 0.0f};
     bottom_center.normal = {0.0f, -1.0f, 0.0f};
+    bottom_center.uv = {0.5f, 0.5f};
     vertices_.push_back(bottom_center);
 
     for (uint32_t i = 0; i < segments; ++i) {
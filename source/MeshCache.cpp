@@ -0,0 +1,301 @@
+#include "veekay/MeshCache.hpp"
+#include "veekay/profiler.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace geometry {
+
+namespace {
+
+constexpr char mesh_file_magic[4] = {'V', 'K', 'M', 'S'};
+constexpr uint64_t blob_alignment = 16;
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// FNV-1a 64, продолжает хэш с переданного значения
+uint64_t checksum(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Раскладка geometry::Vertex, файлы с другой раскладкой считаются устаревшими
+constexpr VertexAttribute vertex_layout[] = {
+    {AttributeSemantic::position, 3, offsetof(Vertex, position)},
+    {AttributeSemantic::normal, 3, offsetof(Vertex, normal)},
+    {AttributeSemantic::uv, 2, offsetof(Vertex, uv)},
+};
+
+constexpr uint32_t vertex_layout_count = sizeof(vertex_layout) / sizeof(vertex_layout[0]);
+
+bool validate(const void* data, size_t size) {
+    if (size < sizeof(MeshFileHeader)) {
+        return false;
+    }
+
+    const auto* header = static_cast<const MeshFileHeader*>(data);
+
+    if (memcmp(header->magic, mesh_file_magic, sizeof(mesh_file_magic)) != 0 ||
+        header->version != mesh_file_version ||
+        header->vertex_stride != sizeof(Vertex) ||
+        header->attribute_count != vertex_layout_count) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < vertex_layout_count; ++i) {
+        const VertexAttribute& a = header->attributes[i];
+        const VertexAttribute& b = vertex_layout[i];
+        if (a.semantic != b.semantic || a.components != b.components || a.offset != b.offset) {
+            return false;
+        }
+    }
+
+    const uint64_t vertex_bytes = uint64_t(header->vertex_count) * header->vertex_stride;
+    const uint64_t index_bytes = uint64_t(header->index_count) * sizeof(uint32_t);
+
+    // Смещения из файла не складываются с размерами: на повреждённом
+    // файле сумма может переполниться и пропустить чтение за отображением
+    if (header->vertex_offset > size || vertex_bytes > size - header->vertex_offset ||
+        header->index_offset > size || index_bytes > size - header->index_offset) {
+        return false;
+    }
+
+    // Вершины и индексы читаются как float и uint32_t прямо из отображения
+    if (header->vertex_offset % alignof(float) != 0 ||
+        header->index_offset % alignof(uint32_t) != 0) {
+        return false;
+    }
+
+    const auto* bytes = static_cast<const char*>(data);
+    uint64_t hash = checksum(bytes + header->vertex_offset, vertex_bytes);
+    hash = checksum(bytes + header->index_offset, index_bytes, hash);
+
+    return hash == header->checksum;
+}
+
+// Ключ кэша: версия генератора и точные битовые представления его параметров
+std::string cylinderFileName(float radius, float height, uint32_t segments) {
+    uint32_t radius_bits, height_bits;
+    memcpy(&radius_bits, &radius, sizeof(radius_bits));
+    memcpy(&height_bits, &height, sizeof(height_bits));
+
+    char name[96];
+    snprintf(name, sizeof(name), "cylinder_v%u_%08x_%08x_%u.vkmesh",
+             cylinder_generator_version, radius_bits, height_bits, segments);
+    return name;
+}
+
+} // namespace
+
+MappedMesh::~MappedMesh() {
+    close();
+}
+
+MappedMesh::MappedMesh(MappedMesh&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedMesh& MappedMesh::operator=(MappedMesh&& other) noexcept {
+    if (this != &other) {
+        close();
+
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+#if defined(_WIN32)
+        file_ = other.file_;
+        mapping_ = other.mapping_;
+        other.file_ = nullptr;
+        other.mapping_ = nullptr;
+#endif
+    }
+    return *this;
+}
+
+const void* MappedMesh::getVerticesData() const {
+    return static_cast<const char*>(data_) + header()->vertex_offset;
+}
+
+const uint32_t* MappedMesh::getIndicesData() const {
+    return reinterpret_cast<const uint32_t*>(static_cast<const char*>(data_) + header()->index_offset);
+}
+
+void MappedMesh::close() {
+    if (!data_) {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = nullptr;
+#else
+    munmap(data_, size_);
+#endif
+
+    data_ = nullptr;
+    size_ = 0;
+}
+
+MappedMesh MappedMesh::open(const std::string& path) {
+    MappedMesh result;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return result;
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return result;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return result;
+    }
+
+    result.file_ = file;
+    result.mapping_ = mapping;
+    result.data_ = data;
+    result.size_ = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return result;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return result;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // Отображение остаётся валидным после закрытия дескриптора
+
+    if (data == MAP_FAILED) {
+        return result;
+    }
+
+    // Данные будут прочитаны целиком и последовательно
+    madvise(data, st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    result.data_ = data;
+    result.size_ = static_cast<size_t>(st.st_size);
+#endif
+
+    if (!validate(result.data_, result.size_)) {
+        std::cerr << "Mesh cache file " << path << " is invalid or outdated\n";
+        result.close();
+    }
+
+    return result;
+}
+
+MeshCache::MeshCache(std::string directory) : directory_(std::move(directory)) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+}
+
+MappedMesh MeshCache::cylinder(float radius, float height, uint32_t segments) {
+    VEEKAY_PROFILE_FUNCTION();
+
+    const std::string path = directory_ + "/" + cylinderFileName(radius, height, segments);
+
+    MappedMesh mesh = MappedMesh::open(path);
+    if (mesh.valid()) {
+        return mesh;
+    }
+
+    Cylinder generated(radius, height, segments);
+    if (!write(path, generated.vertices_.data(), generated.getVertexCount(),
+               generated.indices_.data(), generated.getIndexCount())) {
+        std::cerr << "Failed to write mesh cache file " << path << '\n';
+        return mesh;
+    }
+
+    return MappedMesh::open(path);
+}
+
+bool MeshCache::write(const std::string& path,
+                      const Vertex* vertices, uint32_t vertex_count,
+                      const uint32_t* indices, uint32_t index_count) {
+    const uint64_t vertex_bytes = uint64_t(vertex_count) * sizeof(Vertex);
+    const uint64_t index_bytes = uint64_t(index_count) * sizeof(uint32_t);
+
+    MeshFileHeader header{};
+    memcpy(header.magic, mesh_file_magic, sizeof(mesh_file_magic));
+    header.version = mesh_file_version;
+    header.vertex_count = vertex_count;
+    header.index_count = index_count;
+    header.vertex_stride = sizeof(Vertex);
+    header.attribute_count = vertex_layout_count;
+    for (uint32_t i = 0; i < vertex_layout_count; ++i) {
+        header.attributes[i] = vertex_layout[i];
+    }
+    header.vertex_offset = alignUp(sizeof(MeshFileHeader), blob_alignment);
+    header.index_offset = alignUp(header.vertex_offset + vertex_bytes, blob_alignment);
+    header.checksum = checksum(indices, index_bytes, checksum(vertices, vertex_bytes));
+
+    // Пишем во временный файл и переименовываем, чтобы другой процесс
+    // никогда не увидел файл наполовину
+    const std::string temporary = path + ".tmp";
+
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    const char padding[blob_alignment] = {};
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(padding, 1, header.vertex_offset - sizeof(header), file) ==
+               header.vertex_offset - sizeof(header);
+    ok = ok && fwrite(vertices, 1, vertex_bytes, file) == vertex_bytes;
+    ok = ok && fwrite(padding, 1, header.index_offset - header.vertex_offset - vertex_bytes, file) ==
+               header.index_offset - header.vertex_offset - vertex_bytes;
+    ok = ok && fwrite(indices, 1, index_bytes, file) == index_bytes;
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+}
@@ -0,0 +1,179 @@
+#include "veekay/Meshlet.hpp"
+#include "veekay/profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace geometry {
+
+namespace {
+
+constexpr uint8_t no_local_index = 0xFF;
+
+Vector subtract(const Vector& a, const Vector& b) {
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+Vector cross(const Vector& a, const Vector& b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+float dot(const Vector& a, const Vector& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Сфера: центр габаритного прямоугольника и самая дальняя вершина.
+// Конус: средняя нормаль и наименьший косинус угла с нормалями
+// треугольников, как в meshoptimizer (тест по сфере, без вершины конуса)
+void computeBounds(Meshlet& meshlet, const MeshletData& data, const Vertex* vertices) {
+    const uint32_t* local = &data.vertices[meshlet.vertex_offset];
+
+    Vector min = vertices[local[0]].position;
+    Vector max = min;
+    for (uint32_t i = 1; i < meshlet.vertex_count; ++i) {
+        const Vector& p = vertices[local[i]].position;
+        min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+        max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+    }
+
+    const Vector center = {(min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f};
+
+    float radius_squared = 0.0f;
+    for (uint32_t i = 0; i < meshlet.vertex_count; ++i) {
+        const Vector d = subtract(vertices[local[i]].position, center);
+        radius_squared = std::max(radius_squared, dot(d, d));
+    }
+
+    meshlet.center[0] = center.x;
+    meshlet.center[1] = center.y;
+    meshlet.center[2] = center.z;
+    meshlet.radius = sqrtf(radius_squared);
+
+    // Единичные нормали треугольников, вырожденные пропускаются
+    std::vector<Vector> normals;
+    normals.reserve(meshlet.triangle_count);
+
+    Vector axis = {0.0f, 0.0f, 0.0f};
+    for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+        const uint8_t* triangle = &data.triangles[meshlet.triangle_offset + t * 3];
+        const Vector& a = vertices[local[triangle[0]]].position;
+        const Vector& b = vertices[local[triangle[1]]].position;
+        const Vector& c = vertices[local[triangle[2]]].position;
+
+        Vector n = cross(subtract(b, a), subtract(c, a));
+        const float length = sqrtf(dot(n, n));
+        if (length == 0.0f) {
+            continue;
+        }
+
+        n = {n.x / length, n.y / length, n.z / length};
+        normals.push_back(n);
+        axis = {axis.x + n.x, axis.y + n.y, axis.z + n.z};
+    }
+
+    const float axis_length = sqrtf(dot(axis, axis));
+
+    float min_dot = 1.0f;
+    if (axis_length > 0.0f) {
+        axis = {axis.x / axis_length, axis.y / axis_length, axis.z / axis_length};
+        for (const Vector& n : normals) {
+            min_dot = std::min(min_dot, dot(n, axis));
+        }
+    }
+
+    meshlet.cone_axis[0] = axis.x;
+    meshlet.cone_axis[1] = axis.y;
+    meshlet.cone_axis[2] = axis.z;
+
+    // Конус шире полусферы (или нормалей нет) - кластер видно отовсюду
+    meshlet.cone_cutoff = (axis_length == 0.0f || min_dot <= 0.0f) ? 1.0f
+                                                                    : sqrtf(1.0f - min_dot * min_dot);
+}
+
+}
+
+MeshletData buildMeshlets(const Vertex* vertices, uint32_t vertex_count,
+                          const uint32_t* indices, uint32_t index_count,
+                          uint32_t max_vertices, uint32_t max_triangles) {
+    VEEKAY_PROFILE_FUNCTION();
+
+    // Локальные индексы хранятся в байтах
+    max_vertices = std::min(max_vertices, uint32_t(no_local_index));
+
+    MeshletData data;
+
+    // Локальный индекс вершины меша в текущем кластере
+    std::vector<uint8_t> local(vertex_count, no_local_index);
+
+    Meshlet current{};
+
+    auto finish = [&] {
+        if (current.triangle_count == 0) {
+            return;
+        }
+
+        computeBounds(current, data, vertices);
+        data.meshlets.push_back(current);
+
+        for (uint32_t i = 0; i < current.vertex_count; ++i) {
+            local[data.vertices[current.vertex_offset + i]] = no_local_index;
+        }
+
+        current = Meshlet{};
+        current.vertex_offset = static_cast<uint32_t>(data.vertices.size());
+        current.triangle_offset = static_cast<uint32_t>(data.triangles.size());
+    };
+
+    for (uint32_t i = 0; i + 2 < index_count; i += 3) {
+        const uint32_t triangle[3] = {indices[i], indices[i + 1], indices[i + 2]};
+
+        uint32_t added = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            const bool repeated = (k > 0 && triangle[k] == triangle[0]) ||
+                                  (k > 1 && triangle[k] == triangle[1]);
+            if (local[triangle[k]] == no_local_index && !repeated) {
+                ++added;
+            }
+        }
+
+        if (current.vertex_count + added > max_vertices ||
+            current.triangle_count + 1 > max_triangles) {
+            finish();
+        }
+
+        for (uint32_t k = 0; k < 3; ++k) {
+            if (local[triangle[k]] == no_local_index) {
+                local[triangle[k]] = static_cast<uint8_t>(current.vertex_count++);
+                data.vertices.push_back(triangle[k]);
+            }
+
+            data.triangles.push_back(local[triangle[k]]);
+        }
+
+        ++current.triangle_count;
+    }
+
+    finish();
+
+    // Шейдеры читают треугольники словами по 4 байта
+    data.triangles.resize((data.triangles.size() + 3) & ~size_t(3), 0);
+
+    return data;
+}
+
+std::vector<uint32_t> meshletIndices(const MeshletData& data) {
+    std::vector<uint32_t> indices(data.triangles.size(), 0);
+
+    for (const Meshlet& meshlet : data.meshlets) {
+        const uint32_t* local = &data.vertices[meshlet.vertex_offset];
+
+        for (uint32_t i = 0; i < meshlet.triangle_count * 3; ++i) {
+            const uint32_t offset = meshlet.triangle_offset + i;
+            indices[offset] = local[data.triangles[offset]];
+        }
+    }
+
+    return indices;
+}
+
+}
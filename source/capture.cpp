@@ -0,0 +1,452 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/capture.hpp>
+#include <veekay/profiler.hpp>
+
+namespace {
+
+uint32_t crc_table[256];
+
+void initCrcTable() {
+	for (uint32_t i = 0; i < 256; ++i) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k) {
+			c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+		}
+		crc_table[i] = c;
+	}
+}
+
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i) {
+		crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+void putBigEndian(uint8_t* out, uint32_t value) {
+	out[0] = uint8_t(value >> 24);
+	out[1] = uint8_t(value >> 16);
+	out[2] = uint8_t(value >> 8);
+	out[3] = uint8_t(value);
+}
+
+bool writeChunk(FILE* file, const char type[4], const uint8_t* data, uint32_t size) {
+	uint8_t header[8];
+	putBigEndian(header, size);
+	memcpy(header + 4, type, 4);
+
+	uint32_t crc = crc32(0, header + 4, 4);
+	crc = crc32(crc, data, size);
+
+	uint8_t footer[4];
+	putBigEndian(footer, crc);
+
+	return fwrite(header, 1, 8, file) == 8 &&
+	       fwrite(data, 1, size, file) == size &&
+	       fwrite(footer, 1, 4, file) == 4;
+}
+
+// NOTE: Encodes RGB rows as PNG with stored (uncompressed) deflate blocks.
+//       Files are bigger than a real deflate encoder would produce, but
+//       encoding costs about as much as a memcpy and needs no dependency
+bool writePng(FILE* file, const uint8_t* rgb, uint32_t width, uint32_t height,
+              std::vector<uint8_t>& scratch) {
+	static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	if (fwrite(signature, 1, sizeof(signature), file) != sizeof(signature)) {
+		return false;
+	}
+
+	uint8_t ihdr[13];
+	putBigEndian(ihdr, width);
+	putBigEndian(ihdr + 4, height);
+	ihdr[8] = 8;   // NOTE: Bit depth
+	ihdr[9] = 2;   // NOTE: Truecolor
+	ihdr[10] = 0;  // NOTE: Deflate
+	ihdr[11] = 0;  // NOTE: Adaptive filtering
+	ihdr[12] = 0;  // NOTE: No interlace
+
+	if (!writeChunk(file, "IHDR", ihdr, sizeof(ihdr))) {
+		return false;
+	}
+
+	// NOTE: Filter byte (0, none) in front of every row
+	const size_t row_size = size_t(width) * 3;
+	const size_t raw_size = (row_size + 1) * height;
+
+	constexpr size_t max_block = 65535;
+	const size_t block_count = (raw_size + max_block - 1) / max_block;
+
+	scratch.resize(2 + raw_size + block_count * 5 + 4);
+	uint8_t* out = scratch.data();
+
+	*out++ = 0x78;  // NOTE: zlib header, 32K window, no compression
+	*out++ = 0x01;
+
+	uint32_t adler_a = 1, adler_b = 0;
+	size_t row = 0, column = 0;
+
+	for (size_t remaining = raw_size; remaining > 0;) {
+		const size_t block = (remaining < max_block) ? remaining : max_block;
+		remaining -= block;
+
+		*out++ = (remaining == 0) ? 1 : 0;
+		*out++ = uint8_t(block);
+		*out++ = uint8_t(block >> 8);
+		*out++ = uint8_t(~block);
+		*out++ = uint8_t(~block >> 8);
+
+		for (size_t i = 0; i < block; ++i) {
+			uint8_t byte;
+			if (column == 0) {
+				byte = 0;
+			} else {
+				byte = rgb[row * row_size + column - 1];
+			}
+
+			if (++column == row_size + 1) {
+				column = 0;
+				++row;
+			}
+
+			*out++ = byte;
+			adler_a = (adler_a + byte) % 65521;
+			adler_b = (adler_b + adler_a) % 65521;
+		}
+	}
+
+	putBigEndian(out, (adler_b << 16) | adler_a);
+	out += 4;
+
+	const uint32_t size = static_cast<uint32_t>(out - scratch.data());
+
+	return writeChunk(file, "IDAT", scratch.data(), size) &&
+	       writeChunk(file, "IEND", nullptr, 0);
+}
+
+} // namespace
+
+bool veekay::FrameCapture::initialize(VkFormat image_format, uint32_t width, uint32_t height,
+                                      uint32_t buffer_count) {
+	VkDevice device = veekay::app->vk_device;
+	const uint32_t frames = veekay::app->frames_in_flight;
+
+	switch (image_format) {
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		swizzle_ = true;
+		break;
+
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		swizzle_ = false;
+		break;
+
+	default:
+		std::cerr << "Frame capture does not support swapchain format " << image_format << '\n';
+		return false;
+	}
+
+	width_ = width;
+	height_ = height;
+
+	{
+		VkCommandPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = veekay::app->vk_graphics_queue_family,
+		};
+
+		if (vkCreateCommandPool(device, &info, nullptr, &command_pool_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan command pool for frame capture\n";
+			return false;
+		}
+	}
+
+	{
+		command_buffers_.resize(frames);
+
+		VkCommandBufferAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = command_pool_,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = frames,
+		};
+
+		if (vkAllocateCommandBuffers(device, &info, command_buffers_.data()) != VK_SUCCESS) {
+			std::cerr << "Failed to allocate Vulkan command buffers for frame capture\n";
+			return false;
+		}
+	}
+
+	// NOTE: Cached memory makes CPU reads from readback buffers fast
+	buffers_.resize(buffer_count);
+	for (uint32_t i = 0; i < buffer_count; ++i) {
+		buffers_[i] = createBuffer(VkDeviceSize(width) * height * 4, nullptr,
+		                           VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                           VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+		if (!buffers_[i].buffer) {
+			return false;
+		}
+
+		free_buffers_.push_back(i);
+	}
+
+	pending_.assign(frames, Pending{no_buffer, 0});
+
+	initCrcTable();
+
+	quit_ = false;
+	writer_ = std::thread(&FrameCapture::writerLoop, this);
+
+	return true;
+}
+
+void veekay::FrameCapture::destroy() {
+	// NOTE: Device is idle here, every recorded copy has finished
+	for (uint32_t i = 0; i < pending_.size(); ++i) {
+		retire(i);
+	}
+
+	if (writer_.joinable()) {
+		{
+			std::lock_guard lock(mutex_);
+			quit_ = true;
+		}
+
+		wake_.notify_one();
+		writer_.join();
+	}
+
+	for (const Buffer& buffer : buffers_) {
+		destroyBuffer(buffer);
+	}
+
+	buffers_.clear();
+
+	vkDestroyCommandPool(veekay::app->vk_device, command_pool_, nullptr);
+}
+
+void veekay::FrameCapture::start(const std::string& directory, CaptureFormat format,
+                                 uint32_t frame_count) {
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		std::cerr << "Failed to create frame capture directory " << directory << '\n';
+		return;
+	}
+
+	directory_ = directory;
+	format_ = format;
+	frame_limit_ = frame_count;
+	captured_ = 0;
+	dropped_ = 0;
+	active_ = true;
+}
+
+void veekay::FrameCapture::stop() {
+	active_ = false;
+}
+
+void veekay::FrameCapture::retire(uint32_t frame) {
+	Pending& pending = pending_[frame];
+	if (pending.buffer == no_buffer) {
+		return;
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "/frame_%06u.%s", pending.number,
+	         (format_ == CaptureFormat::png) ? "png" : "ppm");
+
+	{
+		std::lock_guard lock(mutex_);
+		jobs_.push_back(Job{pending.buffer, format_, directory_ + name});
+	}
+
+	wake_.notify_one();
+
+	pending.buffer = no_buffer;
+}
+
+VkCommandBuffer veekay::FrameCapture::record(uint32_t frame, VkImage image) {
+	if (!active_) {
+		return VK_NULL_HANDLE;
+	}
+
+	VEEKAY_PROFILE_SCOPE("Capture record");
+
+	uint32_t index;
+	{
+		std::lock_guard lock(mutex_);
+
+		if (free_buffers_.empty()) {
+			++dropped_;
+			return VK_NULL_HANDLE;
+		}
+
+		index = free_buffers_.back();
+		free_buffers_.pop_back();
+	}
+
+	pending_[frame] = Pending{index, captured_++};
+
+	if (frame_limit_ != 0 && captured_ == frame_limit_) {
+		active_ = false;
+	}
+
+	VkCommandBuffer cmd = command_buffers_[frame];
+
+	vkResetCommandBuffer(cmd, 0);
+
+	{
+		VkCommandBufferBeginInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		};
+
+		vkBeginCommandBuffer(cmd, &info);
+	}
+
+	const VkImageSubresourceRange range{
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.levelCount = 1,
+		.layerCount = 1,
+	};
+
+	{ // NOTE: Wait for color writes of the frame, make image copyable
+		VkImageMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = image,
+			.subresourceRange = range,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		                     0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	{
+		VkBufferImageCopy region{
+			.bufferOffset = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.layerCount = 1,
+			},
+			.imageExtent = {width_, height_, 1},
+		};
+
+		vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		                       buffers_[index].buffer, 1, &region);
+	}
+
+	{ // NOTE: Hand image back to presentation, make copy visible to host
+		VkImageMemoryBarrier image_barrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+			.dstAccessMask = 0,
+			.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = image,
+			.subresourceRange = range,
+		};
+
+		VkBufferMemoryBarrier buffer_barrier{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.buffer = buffers_[index].buffer,
+			.offset = 0,
+			.size = VK_WHOLE_SIZE,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+		                     0, nullptr, 1, &buffer_barrier, 1, &image_barrier);
+	}
+
+	vkEndCommandBuffer(cmd);
+
+	return cmd;
+}
+
+void veekay::FrameCapture::writerLoop() {
+	VEEKAY_PROFILE_THREAD("Capture writer");
+
+	for (;;) {
+		Job job;
+
+		{
+			std::unique_lock lock(mutex_);
+			wake_.wait(lock, [this] { return quit_ || !jobs_.empty(); });
+
+			// NOTE: Queue is drained before quitting, no frame is lost
+			if (jobs_.empty()) {
+				return;
+			}
+
+			job = std::move(jobs_.front());
+			jobs_.pop_front();
+		}
+
+		write(job);
+	}
+}
+
+void veekay::FrameCapture::write(const Job& job) {
+	VEEKAY_PROFILE_SCOPE("Encode frame");
+
+	const auto* pixels = static_cast<const uint8_t*>(buffers_[job.buffer].mapped);
+	const size_t pixel_count = size_t(width_) * height_;
+
+	// NOTE: Convert 4-byte BGRA/RGBA pixels into tightly packed RGB,
+	//       readback buffer is released as soon as this is done
+	std::vector<uint8_t>& rgb = rgb_;
+	rgb.resize(pixel_count * 3);
+
+	const int r = swizzle_ ? 2 : 0;
+	const int b = swizzle_ ? 0 : 2;
+
+	for (size_t i = 0; i < pixel_count; ++i) {
+		rgb[i * 3 + 0] = pixels[i * 4 + r];
+		rgb[i * 3 + 1] = pixels[i * 4 + 1];
+		rgb[i * 3 + 2] = pixels[i * 4 + b];
+	}
+
+	{
+		std::lock_guard lock(mutex_);
+		free_buffers_.push_back(job.buffer);
+	}
+
+	FILE* file = fopen(job.path.c_str(), "wb");
+	if (!file) {
+		std::cerr << "Failed to open " << job.path << " for frame capture\n";
+		return;
+	}
+
+	bool ok;
+	if (job.format == CaptureFormat::png) {
+		ok = writePng(file, rgb.data(), width_, height_, scratch_);
+	} else {
+		ok = fprintf(file, "P6\n%u %u\n255\n", width_, height_) > 0 &&
+		     fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+	}
+
+	if (fclose(file) != 0 || !ok) {
+		std::cerr << "Failed to write captured frame " << job.path << '\n';
+	}
+}
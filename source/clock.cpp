@@ -0,0 +1,65 @@
+#include <veekay/clock.hpp>
+
+void veekay::Clock::reset(ClockMode mode, double step, double wall_time) {
+	mode_ = mode;
+	step_ = (step > 0.0) ? step : 1.0 / 60.0;
+
+	start_ = wall_time;
+	last_wall_ = wall_time;
+	accumulator_ = 0.0;
+	step_count_ = 0;
+
+	time_ = 0.0;
+	delta_ = 0.0;
+	steps_ = 0;
+}
+
+void veekay::Clock::advance(double wall_time) {
+	switch (mode_) {
+	case ClockMode::real_time: {
+		const double time = wall_time - start_;
+
+		delta_ = time - time_;
+		time_ = time;
+		steps_ = 1;
+		break;
+	}
+
+	case ClockMode::fixed_step: {
+		accumulator_ += wall_time - last_wall_;
+
+		steps_ = 0;
+		while (accumulator_ >= step_ && steps_ < max_steps_per_frame) {
+			accumulator_ -= step_;
+			++steps_;
+		}
+
+		// NOTE: Drop time that could not be simulated in this frame
+		if (steps_ == max_steps_per_frame && accumulator_ >= step_) {
+			accumulator_ = 0.0;
+		}
+
+		step_count_ += steps_;
+
+		delta_ = steps_ * step_;
+		time_ = step_count_ * step_;
+		break;
+	}
+
+	case ClockMode::fixed_frame:
+		++step_count_;
+
+		delta_ = step_;
+		time_ = step_count_ * step_;
+		steps_ = 1;
+		break;
+	}
+
+	last_wall_ = wall_time;
+}
+
+void veekay::Clock::set(double time, double delta, uint32_t steps) {
+	time_ = time;
+	delta_ = delta;
+	steps_ = steps;
+}
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/clustered.hpp>
+#include <veekay/descriptors.hpp>
+#include <veekay/profiler.hpp>
+
+namespace {
+
+// NOTE: Lights buffer, cluster counts, cluster light lists
+constexpr uint32_t binding_count = 3;
+
+// NOTE: Inverse of column-major 4x4 matrix by cofactors, false when it
+//       is singular
+bool invert(const float m[16], float result[16]) {
+	float inv[16];
+
+	inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] +
+	         m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+	inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] -
+	         m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+	inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] +
+	         m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+	inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] -
+	          m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+	inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] -
+	         m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+	inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] +
+	         m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+	inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] -
+	         m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+	inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] +
+	          m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+	inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] +
+	         m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+	inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] -
+	         m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+	inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] +
+	          m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+	inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] -
+	          m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+	inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] -
+	         m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+	inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] +
+	         m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+	inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] -
+	          m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+	inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] +
+	          m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+	const float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+	if (det == 0.0f) {
+		return false;
+	}
+
+	for (int i = 0; i < 16; ++i) {
+		result[i] = inv[i] / det;
+	}
+
+	return true;
+}
+
+// NOTE: View distance (-z in view space) NDC depth z unprojects to
+float viewDepth(const float inverse_projection[16], float z) {
+	const float view_z = inverse_projection[10] * z + inverse_projection[14];
+	const float w = inverse_projection[11] * z + inverse_projection[15];
+	return -view_z / w;
+}
+
+} // namespace
+
+bool veekay::ClusteredLighting::initialize(VkShaderModule cull_shader, uint32_t max_lights) {
+	device_ = veekay::app->vk_device;
+	max_lights_ = max_lights;
+	set_ = VK_NULL_HANDLE;
+
+	const uint32_t frames = veekay::app->frames_in_flight;
+	all_frames_mask_ = static_cast<uint8_t>((1u << frames) - 1u);
+	dirty_ = all_frames_mask_;
+
+	lights_.reserve(max_lights_);
+
+	{
+		DescriptorLayoutDescription description{.binding_count = binding_count};
+		for (uint32_t i = 0; i < binding_count; ++i) {
+			description.bindings[i] = {
+				.binding = i,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			};
+		}
+
+		set_layout_ = veekay::app->descriptors->layout(description);
+		if (!set_layout_) {
+			return false;
+		}
+	}
+
+	{
+		VkPipelineLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &set_layout_,
+		};
+
+		if (vkCreatePipelineLayout(device_, &info, nullptr, &layout_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan pipeline layout for light binning\n";
+			return false;
+		}
+	}
+
+	{
+		VkComputePipelineCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = cull_shader,
+				.pName = "main",
+			},
+			.layout = layout_,
+		};
+
+		if (vkCreateComputePipelines(device_, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan compute pipeline for light binning\n";
+			return false;
+		}
+	}
+
+	{
+		const VkDeviceSize lights_size = sizeof(Params) + VkDeviceSize(max_lights_) * sizeof(PointLight);
+
+		light_buffers_.resize(frames);
+		for (uint32_t i = 0; i < frames; ++i) {
+			light_buffers_[i] = createBuffer(lights_size, nullptr, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+			if (!light_buffers_[i].buffer) {
+				return false;
+			}
+		}
+
+		counts_ = createDeviceBuffer(VkDeviceSize(cluster_count) * sizeof(uint32_t),
+		                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		indices_ = createDeviceBuffer(VkDeviceSize(cluster_count) * max_lights_per_cluster * sizeof(uint32_t),
+		                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+		if (!counts_.buffer || !indices_.buffer) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void veekay::ClusteredLighting::destroy() {
+	destroyBuffer(indices_);
+	destroyBuffer(counts_);
+
+	for (const Buffer& buffer : light_buffers_) {
+		destroyBuffer(buffer);
+	}
+
+	light_buffers_.clear();
+
+	vkDestroyPipeline(device_, pipeline_, nullptr);
+	vkDestroyPipelineLayout(device_, layout_, nullptr);
+}
+
+void veekay::ClusteredLighting::setLights(const PointLight* lights, uint32_t count) {
+	count = std::min(count, max_lights_);
+
+	lights_.assign(lights, lights + count);
+	dirty_ = all_frames_mask_;
+}
+
+bool veekay::ClusteredLighting::cull(VkCommandBuffer cmd, const float view[16], const float projection[16]) {
+	VEEKAY_PROFILE_FUNCTION();
+
+	const uint32_t frame = veekay::app->frame_index;
+	const Buffer& lights = light_buffers_[frame];
+
+	{ // NOTE: Slot's previous frame has retired, its buffer is free to rewrite
+		Params params{
+			.grid = {tiles_x, tiles_y, slices, lightCount()},
+		};
+
+		memcpy(params.view, view, sizeof(params.view));
+		if (!invert(projection, params.inverse_projection)) {
+			std::cerr << "Projection matrix for light binning is singular\n";
+			params.grid[3] = 0;
+		}
+
+		// NOTE: Depth range is whatever projection keeps, in either order
+		//       and behind the camera too for orthographic ones
+		const float depth_a = viewDepth(params.inverse_projection, 0.0f);
+		const float depth_b = viewDepth(params.inverse_projection, 1.0f);
+		const float near = std::min(depth_a, depth_b);
+		const float far = std::max(depth_a, depth_b);
+
+		// NOTE: Orthographic projections don't divide by depth
+		const bool linear = projection[11] == 0.0f;
+
+		float first_slice = far;
+		if (!linear) {
+			const float exponential = near * std::pow(far / near, 1.0f / float(slices));
+			first_slice = std::clamp(std::max(first_slice_depth, exponential), near, far);
+		}
+
+		params.screen[0] = static_cast<float>(veekay::app->window_width);
+		params.screen[1] = static_cast<float>(veekay::app->window_height);
+		params.screen[2] = near;
+		params.screen[3] = far;
+
+		params.slicing[0] = first_slice;
+		params.slicing[1] = linear ? 1.0f : 0.0f;
+
+		memcpy(lights.mapped, &params, sizeof(params));
+
+		const uint8_t bit = static_cast<uint8_t>(1u << frame);
+		if (dirty_ & bit) {
+			memcpy(static_cast<char*>(lights.mapped) + sizeof(Params), lights_.data(),
+			       lights_.size() * sizeof(PointLight));
+			dirty_ &= ~bit;
+		}
+	}
+
+	{
+		const VkBuffer buffers[binding_count] = {lights.buffer, counts_.buffer, indices_.buffer};
+
+		set_ = veekay::app->descriptors->allocateStorageBuffers(set_layout_, buffers, binding_count);
+		if (!set_) {
+			std::cerr << "Failed to allocate descriptor set for light binning\n";
+			return false;
+		}
+	}
+
+	{ // NOTE: Earlier frames are done shading with the lists before rewrite
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+			.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout_,
+	                        0, 1, &set_, 0, nullptr);
+
+	// NOTE: One workgroup per cluster
+	vkCmdDispatch(cmd, tiles_x, tiles_y, slices);
+
+	{
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	return true;
+}
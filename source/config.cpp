@@ -0,0 +1,242 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+
+namespace {
+
+bool parseUint(const char* text, uint32_t& result) {
+	char* end;
+	unsigned long value = strtoul(text, &end, 10);
+	if (end == text || *end != '\0' || value > UINT32_MAX) {
+		return false;
+	}
+
+	result = static_cast<uint32_t>(value);
+	return true;
+}
+
+bool parseDouble(const char* text, double& result) {
+	char* end;
+	double value = strtod(text, &end);
+	if (end == text || *end != '\0') {
+		return false;
+	}
+
+	result = value;
+	return true;
+}
+
+bool parseBool(const char* text, bool& result) {
+	if (!strcmp(text, "1") || !strcmp(text, "on") || !strcmp(text, "true")) {
+		result = true;
+		return true;
+	}
+
+	if (!strcmp(text, "0") || !strcmp(text, "off") || !strcmp(text, "false")) {
+		result = false;
+		return true;
+	}
+
+	return false;
+}
+
+template <typename T>
+struct Name {
+	const char* name;
+	T value;
+};
+
+template <typename T, size_t N>
+bool parseName(const char* text, const Name<T> (&names)[N], T& result) {
+	for (const Name<T>& n : names) {
+		if (!strcmp(text, n.name)) {
+			result = n.value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const Name<VkPresentModeKHR> present_modes[] = {
+	{"fifo", VK_PRESENT_MODE_FIFO_KHR},
+	{"fifo_relaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR},
+	{"mailbox", VK_PRESENT_MODE_MAILBOX_KHR},
+	{"immediate", VK_PRESENT_MODE_IMMEDIATE_KHR},
+};
+
+const Name<veekay::DeviceType> device_types[] = {
+	{"any", veekay::DeviceType::any},
+	{"discrete", veekay::DeviceType::discrete},
+	{"integrated", veekay::DeviceType::integrated},
+	{"virtual", veekay::DeviceType::virtual_gpu},
+	{"cpu", veekay::DeviceType::cpu},
+};
+
+const Name<VkFormat> depth_formats[] = {
+	{"auto", VK_FORMAT_UNDEFINED},
+	{"d16", VK_FORMAT_D16_UNORM},
+	{"d24s8", VK_FORMAT_D24_UNORM_S8_UINT},
+	{"d32", VK_FORMAT_D32_SFLOAT},
+	{"d32s8", VK_FORMAT_D32_SFLOAT_S8_UINT},
+};
+
+const Name<veekay::MemoryBudgetPolicy> budget_policies[] = {
+	{"warn", veekay::MemoryBudgetPolicy::warn},
+	{"fail", veekay::MemoryBudgetPolicy::fail},
+};
+
+const Name<veekay::ClockMode> clock_modes[] = {
+	{"real", veekay::ClockMode::real_time},
+	{"step", veekay::ClockMode::fixed_step},
+	{"frame", veekay::ClockMode::fixed_frame},
+};
+
+struct Option {
+	const char* flag;
+	const char* env;
+	const char* help;
+	bool (*apply)(veekay::ApplicationConfig& config, const char* value);
+};
+
+const Option options[] = {
+	{"width", "VEEKAY_WIDTH", "<pixels>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseUint(v, c.window_width); }},
+	{"height", "VEEKAY_HEIGHT", "<pixels>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseUint(v, c.window_height); }},
+	{"frames-in-flight", "VEEKAY_FRAMES_IN_FLIGHT", "<1..8>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseUint(v, c.frames_in_flight); }},
+	{"present-mode", "VEEKAY_PRESENT_MODE", "fifo|fifo_relaxed|mailbox|immediate",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseName(v, present_modes, c.present_mode); }},
+	{"low-latency", "VEEKAY_LOW_LATENCY", "on|off",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseBool(v, c.low_latency); }},
+	{"frame-limit", "VEEKAY_FRAME_LIMIT", "<frames per second, 0 = off>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseDouble(v, c.frame_limit) && c.frame_limit >= 0.0; }},
+	{"validation", "VEEKAY_VALIDATION", "on|off",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseBool(v, c.validation); }},
+	{"device", "VEEKAY_DEVICE", "<part of device name>",
+	 [](veekay::ApplicationConfig& c, const char* v) { c.device_name = v; return true; }},
+	{"device-type", "VEEKAY_DEVICE_TYPE", "any|discrete|integrated|virtual|cpu",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseName(v, device_types, c.device_type); }},
+	{"depth-format", "VEEKAY_DEPTH_FORMAT", "auto|d16|d24s8|d32|d32s8",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseName(v, depth_formats, c.depth_format); }},
+	{"depth-sampled", "VEEKAY_DEPTH_SAMPLED", "on|off",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseBool(v, c.depth_sampled); }},
+	{"mesh-shader", "VEEKAY_MESH_SHADER", "on|off",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseBool(v, c.mesh_shader); }},
+	{"memory-budget", "VEEKAY_MEMORY_BUDGET", "<MiB>",
+	 [](veekay::ApplicationConfig& c, const char* v) {
+		uint32_t mib;
+		if (!parseUint(v, mib)) {
+			return false;
+		}
+		c.memory_budget = VkDeviceSize(mib) * 1024 * 1024;
+		return true;
+	 }},
+	{"memory-budget-policy", "VEEKAY_MEMORY_BUDGET_POLICY", "warn|fail",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseName(v, budget_policies, c.memory_budget_policy); }},
+	{"workers", "VEEKAY_WORKERS", "<count, 0 = auto>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseUint(v, c.worker_threads); }},
+	{"clock", "VEEKAY_CLOCK", "real|step|frame",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseName(v, clock_modes, c.clock_mode); }},
+	{"clock-step", "VEEKAY_CLOCK_STEP", "<seconds>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseDouble(v, c.clock_step) && c.clock_step > 0.0; }},
+	{"simulation-thread", "VEEKAY_SIMULATION_THREAD", "on|off",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseBool(v, c.simulation_thread); }},
+	{"simulation-rate", "VEEKAY_SIMULATION_RATE", "<updates per second, 0 = unthrottled>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseDouble(v, c.simulation_rate) && c.simulation_rate >= 0.0; }},
+	{"record", "VEEKAY_RECORD", "<file>",
+	 [](veekay::ApplicationConfig& c, const char* v) { c.record_input = v; return true; }},
+	{"playback", "VEEKAY_PLAYBACK", "<file>",
+	 [](veekay::ApplicationConfig& c, const char* v) { c.playback_input = v; return true; }},
+	{"profile", "VEEKAY_PROFILE", "<trace.json>",
+	 [](veekay::ApplicationConfig& c, const char* v) { c.profile_output = v; return true; }},
+	{"tiled-output", "VEEKAY_TILED_OUTPUT", "<image.ppm>",
+	 [](veekay::ApplicationConfig& c, const char* v) { c.tiled_output = v; return true; }},
+	{"tiled-width", "VEEKAY_TILED_WIDTH", "<pixels, 0 = window>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseUint(v, c.tiled_width); }},
+	{"tiled-height", "VEEKAY_TILED_HEIGHT", "<pixels, 0 = window>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseUint(v, c.tiled_height); }},
+	{"tile-size", "VEEKAY_TILE_SIZE", "<pixels>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseUint(v, c.tile_size) && c.tile_size > 0; }},
+	{"tiled-frames", "VEEKAY_TILED_FRAMES", "<count>",
+	 [](veekay::ApplicationConfig& c, const char* v) { return parseUint(v, c.tiled_frames) && c.tiled_frames > 0; }},
+};
+
+void printUsage(const char* program) {
+	std::cerr << "Usage: " << program << " [--option=value]...\n";
+	for (const Option& option : options) {
+		std::cerr << "  --" << option.flag << '=' << option.help
+		          << " (" << option.env << ")\n";
+	}
+}
+
+} // namespace
+
+bool veekay::parseConfig(int argc, char** argv, ApplicationConfig& config) {
+	const char* program = (argc > 0) ? argv[0] : "veekay";
+
+	for (const Option& option : options) {
+		const char* value = getenv(option.env);
+		if (value && !option.apply(config, value)) {
+			std::cerr << "Invalid value '" << value << "' of " << option.env << '\n';
+			printUsage(program);
+			return false;
+		}
+	}
+
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+
+		if (!strcmp(arg, "--help") || !strcmp(arg, "-h")) {
+			printUsage(program);
+			return false;
+		}
+
+		if (strncmp(arg, "--", 2) != 0) {
+			std::cerr << "Unexpected argument '" << arg << "'\n";
+			printUsage(program);
+			return false;
+		}
+
+		arg += 2;
+
+		// NOTE: Both --flag=value and --flag value are accepted
+		const char* equals = strchr(arg, '=');
+		const size_t length = equals ? size_t(equals - arg) : strlen(arg);
+
+		const Option* found = nullptr;
+		for (const Option& option : options) {
+			if (strlen(option.flag) == length && !strncmp(option.flag, arg, length)) {
+				found = &option;
+				break;
+			}
+		}
+
+		if (!found) {
+			std::cerr << "Unknown option '" << argv[i] << "'\n";
+			printUsage(program);
+			return false;
+		}
+
+		const char* value;
+		if (equals) {
+			value = equals + 1;
+		} else if (i + 1 < argc) {
+			value = argv[++i];
+		} else {
+			std::cerr << "Option '" << argv[i] << "' needs a value\n";
+			return false;
+		}
+
+		if (!found->apply(config, value)) {
+			std::cerr << "Invalid value '" << value << "' of --" << found->flag << '\n';
+			printUsage(program);
+			return false;
+		}
+	}
+
+	return true;
+}
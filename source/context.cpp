@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <veekay/context.hpp>
+#include <veekay/device.hpp>
+#include <veekay/memory.hpp>
+#include <veekay/tiled.hpp>
+#include <veekay/profiler.hpp>
+
+namespace {
+
+// NOTE: Same cap as run(), frame slot dirty masks are 8 bits wide
+constexpr uint32_t max_frames_in_flight = 8;
+
+// NOTE: Headless contexts don't initialize GLFW, their clocks run on this
+double wallTime() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// NOTE: Binds app to calling thread until end of scope, for context setup
+//       that may happen on a thread other than the one running it
+class AppBinding {
+public:
+	explicit AppBinding(veekay::Application* app) : previous_(veekay::app) { veekay::app = app; }
+	~AppBinding() { veekay::app = previous_; }
+
+	AppBinding(const AppBinding&) = delete;
+	AppBinding& operator=(const AppBinding&) = delete;
+
+private:
+	veekay::Application* previous_;
+};
+
+} // namespace
+
+bool veekay::Context::initialize(const ApplicationConfig& config, uint32_t queue_count) {
+	app_ = {};
+	device_ = {};
+	owns_device_ = true;
+	render_pass_ = VK_NULL_HANDLE;
+	next_queue_.store(1, std::memory_order_relaxed);
+
+	return createDevice(config, queue_count) && createRenderPass();
+}
+
+bool veekay::Context::initialize(const ApplicationConfig& config, Context& owner) {
+	app_ = {};
+	device_ = {};
+	owns_device_ = false;
+	render_pass_ = VK_NULL_HANDLE;
+	queue_count_ = 0;
+	next_queue_.store(0, std::memory_order_relaxed);
+
+	const uint32_t queue = owner.next_queue_.fetch_add(1, std::memory_order_relaxed);
+	if (queue >= owner.queue_count_) {
+		std::cerr << "No free queue left on shared device, it has " << owner.queue_count_
+		          << ", use a context with its own device\n";
+		return false;
+	}
+
+	app_.vk_device = owner.app_.vk_device;
+	app_.vk_physical_device = owner.app_.vk_physical_device;
+	app_.vk_graphics_queue_family = owner.app_.vk_graphics_queue_family;
+	app_.draw_indirect_count = owner.app_.draw_indirect_count;
+	app_.mesh_shader = owner.app_.mesh_shader;
+	app_.vk_depth_format = owner.app_.vk_depth_format;
+
+	// NOTE: Heaps and budget are the device's, shared with the owner
+	app_.memory = owner.app_.memory;
+
+	vkGetDeviceQueue(app_.vk_device, app_.vk_graphics_queue_family, queue, &app_.vk_graphics_queue);
+
+	return createRenderPass();
+}
+
+void veekay::Context::destroy() {
+	if (app_.vk_device) {
+		vkDestroyRenderPass(app_.vk_device, render_pass_, nullptr);
+	}
+
+	if (owns_device_) {
+		destroyDevice(device_);
+	}
+
+	app_ = {};
+	device_ = {};
+	render_pass_ = VK_NULL_HANDLE;
+}
+
+int veekay::Context::run(const ApplicationInfo& app_info, const ApplicationConfig& config) {
+	AppBinding binding(&app_);
+
+	app_.running = true;
+	app_.simulation_threaded = false;
+	app_.window_width = config.window_width;
+	app_.window_height = config.window_height;
+	app_.frame_index = 0;
+	app_.frames_in_flight = std::clamp(config.frames_in_flight, 1u, max_frames_in_flight);
+	app_.vk_render_pass = render_pass_;
+	app_.vk_render_pass_load = VK_NULL_HANDLE;
+	app_.vk_depth_image = VK_NULL_HANDLE;
+	app_.capture = nullptr;
+
+	frame_stats_ = {};
+	app_.frame_stats = &frame_stats_;
+
+	if (!pipelines_.initialize(app_.vk_device)) {
+		return 1;
+	}
+	app_.pipelines = &pipelines_;
+
+	if (!descriptors_.initialize(app_.vk_device, app_.frames_in_flight)) {
+		pipelines_.destroy();
+		return 1;
+	}
+	app_.descriptors = &descriptors_;
+
+	// NOTE: Systems with threads are started here, on the thread they
+	//       belong to, so their threads inherit this context
+	if (!jobs_.initialize(config.worker_threads)) {
+		descriptors_.destroy();
+		pipelines_.destroy();
+		return 1;
+	}
+	app_.jobs = &jobs_;
+
+	if (!loader_.initialize()) {
+		jobs_.destroy();
+		descriptors_.destroy();
+		pipelines_.destroy();
+		return 1;
+	}
+	app_.loader = &loader_;
+
+	{
+		VEEKAY_PROFILE_SCOPE("Init");
+		app_info.init();
+	}
+
+	clock_.reset(config.clock_mode, config.clock_step, wallTime());
+	app_.clock = &clock_;
+
+	int exit_code = 0;
+
+	if (app_.running) {
+		VEEKAY_PROFILE_SCOPE("Tiled render");
+
+		if (!renderTiledFrames(app_info, config, VK_FORMAT_R8G8B8A8_UNORM, app_.vk_depth_format,
+		                       render_pass_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, wallTime)) {
+			exit_code = 1;
+		}
+	}
+
+	// NOTE: Device may be shared, only this context's queue is waited for
+	vkQueueWaitIdle(app_.vk_graphics_queue);
+
+	loader_.destroy();
+
+	{
+		VEEKAY_PROFILE_SCOPE("Shutdown");
+		app_info.shutdown();
+	}
+
+	collectDeferredBuffers(true);
+
+	jobs_.destroy();
+	descriptors_.destroy();
+	pipelines_.destroy();
+
+	app_.running = false;
+
+	return exit_code;
+}
+
+bool veekay::Context::createDevice(const ApplicationConfig& config, uint32_t queue_count) {
+	if (!veekay::createDevice(config, nullptr, queue_count, device_)) {
+		return false;
+	}
+
+	queue_count_ = device_.queue_count;
+
+	app_.vk_device = device_.device;
+	app_.vk_physical_device = device_.physical_device;
+	app_.vk_graphics_queue_family = device_.graphics_queue_family;
+	app_.draw_indirect_count = device_.draw_indirect_count;
+	app_.mesh_shader = device_.mesh_shader;
+
+	vkGetDeviceQueue(app_.vk_device, app_.vk_graphics_queue_family, 0, &app_.vk_graphics_queue);
+
+	// NOTE: Nothing samples depth of headless contexts
+	app_.vk_depth_format = pickDepthFormat(app_.vk_physical_device, config, false);
+	if (app_.vk_depth_format == VK_FORMAT_UNDEFINED) {
+		return false;
+	}
+
+	memory_.initialize(app_.vk_physical_device, app_.vk_device, device_.memory_budget,
+	                   config.memory_budget, config.memory_budget_policy);
+	app_.memory = &memory_;
+
+	return true;
+}
+
+bool veekay::Context::createRenderPass() {
+	// NOTE: Compatible with run()'s pass for the same formats, but color
+	//       ends up ready for readback instead of presentation
+	render_pass_ = veekay::createRenderPass(app_.vk_device, VK_FORMAT_R8G8B8A8_UNORM,
+	                                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+	                                        app_.vk_depth_format, false);
+
+	return render_pass_ != VK_NULL_HANDLE;
+}
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/descriptors.hpp>
+#include <veekay/hash.hpp>
+
+namespace {
+
+// NOTE: Sets in the first pool of a chain, every next pool holds twice as
+//       many as the previous one up to the maximum
+constexpr uint32_t initial_pool_sets = 64;
+constexpr uint32_t max_pool_sets = 4096;
+
+// NOTE: Descriptors per set reserved in every pool, by type. Layouts of
+//       this framework are mostly storage buffers
+const VkDescriptorPoolSize pool_ratios[] = {
+	{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 8},
+	{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
+	{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+	{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2},
+	{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2},
+	{VK_DESCRIPTOR_TYPE_SAMPLER, 1},
+};
+
+} // namespace
+
+bool veekay::operator==(const DescriptorLayoutDescription& a, const DescriptorLayoutDescription& b) {
+	if (a.binding_count != b.binding_count) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < a.binding_count; ++i) {
+		const auto& x = a.bindings[i];
+		const auto& y = b.bindings[i];
+
+		if (x.binding != y.binding || x.descriptorType != y.descriptorType ||
+		    x.descriptorCount != y.descriptorCount || x.stageFlags != y.stageFlags) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t veekay::DescriptorLayoutDescriptionHash::operator()(const DescriptorLayoutDescription& d) const {
+	Hasher hasher;
+
+	hasher.add(d.binding_count);
+	for (uint32_t i = 0; i < d.binding_count; ++i) {
+		hasher.add(d.bindings[i].binding);
+		hasher.add(d.bindings[i].descriptorType);
+		hasher.add(d.bindings[i].descriptorCount);
+		hasher.add(d.bindings[i].stageFlags);
+	}
+
+	return static_cast<size_t>(hasher.value);
+}
+
+bool veekay::DescriptorAllocator::initialize(VkDevice device, uint32_t frames_in_flight) {
+	device_ = device;
+	frames_.resize(frames_in_flight);
+
+	return true;
+}
+
+void veekay::DescriptorAllocator::destroy() {
+	for (const PoolChain& chain : frames_) {
+		for (VkDescriptorPool pool : chain.pools) {
+			vkDestroyDescriptorPool(device_, pool, nullptr);
+		}
+	}
+
+	frames_.clear();
+
+	for (VkDescriptorPool pool : static_.pools) {
+		vkDestroyDescriptorPool(device_, pool, nullptr);
+	}
+
+	static_ = {};
+
+	for (const auto& [description, layout] : layouts_) {
+		vkDestroyDescriptorSetLayout(device_, layout, nullptr);
+	}
+
+	layouts_.clear();
+}
+
+VkDescriptorSetLayout veekay::DescriptorAllocator::layout(const DescriptorLayoutDescription& description) {
+	std::lock_guard lock(mutex_);
+
+	auto it = layouts_.find(description);
+	if (it != layouts_.end()) {
+		return it->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = description.binding_count,
+		.pBindings = description.bindings,
+	};
+
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(device_, &info, nullptr, &layout) != VK_SUCCESS) {
+		std::cerr << "Failed to create Vulkan descriptor set layout\n";
+		return VK_NULL_HANDLE;
+	}
+
+	layouts_.emplace(description, layout);
+
+	return layout;
+}
+
+VkDescriptorSet veekay::DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+	std::lock_guard lock(mutex_);
+	return allocate(frames_[veekay::app->frame_index], layout);
+}
+
+VkDescriptorSet veekay::DescriptorAllocator::allocateStorageBuffers(VkDescriptorSetLayout layout,
+                                                                   const VkBuffer* buffers,
+                                                                   uint32_t count) {
+	const VkDescriptorSet set = allocate(layout);
+	if (!set) {
+		return VK_NULL_HANDLE;
+	}
+
+	VkDescriptorBufferInfo infos[max_descriptor_bindings];
+	for (uint32_t i = 0; i < count; ++i) {
+		infos[i] = {
+			.buffer = buffers[i],
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+	}
+
+	VkWriteDescriptorSet write{
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = set,
+		.dstBinding = 0,
+		.descriptorCount = count,
+		.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		.pBufferInfo = infos,
+	};
+
+	vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+
+	return set;
+}
+
+VkDescriptorSet veekay::DescriptorAllocator::allocateStatic(VkDescriptorSetLayout layout) {
+	std::lock_guard lock(mutex_);
+	return allocate(static_, layout);
+}
+
+void veekay::DescriptorAllocator::reset(uint32_t frame) {
+	std::lock_guard lock(mutex_);
+
+	PoolChain& chain = frames_[frame];
+
+	// NOTE: Pools past current were never allocated from since last reset
+	const uint32_t used = std::min(chain.current + 1, static_cast<uint32_t>(chain.pools.size()));
+	for (uint32_t i = 0; i < used; ++i) {
+		vkResetDescriptorPool(device_, chain.pools[i], 0);
+	}
+
+	chain.current = 0;
+}
+
+VkDescriptorSet veekay::DescriptorAllocator::allocate(PoolChain& chain, VkDescriptorSetLayout layout) {
+	for (;;) {
+		const bool fresh = chain.current == chain.pools.size();
+
+		if (fresh) {
+			const size_t doublings = std::min<size_t>(chain.pools.size(), 6);
+			const uint32_t set_count = std::min(initial_pool_sets << doublings, max_pool_sets);
+
+			VkDescriptorPool pool = createPool(set_count);
+			if (!pool) {
+				return VK_NULL_HANDLE;
+			}
+
+			chain.pools.push_back(pool);
+		}
+
+		VkDescriptorSetAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.descriptorPool = chain.pools[chain.current],
+			.descriptorSetCount = 1,
+			.pSetLayouts = &layout,
+		};
+
+		VkDescriptorSet set;
+		const VkResult result = vkAllocateDescriptorSets(device_, &info, &set);
+
+		if (result == VK_SUCCESS) {
+			return set;
+		}
+
+		// NOTE: Any other error won't go away in a fresh pool, and a set that
+		//       doesn't fit an empty pool never will
+		if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || fresh) {
+			std::cerr << "Failed to allocate Vulkan descriptor set\n";
+			return VK_NULL_HANDLE;
+		}
+
+		++chain.current;
+	}
+}
+
+VkDescriptorPool veekay::DescriptorAllocator::createPool(uint32_t set_count) {
+	constexpr uint32_t type_count = sizeof(pool_ratios) / sizeof(pool_ratios[0]);
+
+	VkDescriptorPoolSize sizes[type_count];
+	for (uint32_t i = 0; i < type_count; ++i) {
+		sizes[i] = {
+			.type = pool_ratios[i].type,
+			.descriptorCount = pool_ratios[i].descriptorCount * set_count,
+		};
+	}
+
+	VkDescriptorPoolCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.maxSets = set_count,
+		.poolSizeCount = type_count,
+		.pPoolSizes = sizes,
+	};
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(device_, &info, nullptr, &pool) != VK_SUCCESS) {
+		std::cerr << "Failed to create Vulkan descriptor pool\n";
+		return VK_NULL_HANDLE;
+	}
+
+	return pool;
+}
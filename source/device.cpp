@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <VkBootstrap.h>
+
+#include <veekay/device.hpp>
+
+bool veekay::createDevice(const ApplicationConfig& config, CreateSurfaceFunc create_surface,
+                          uint32_t queue_count, Device& device) {
+	device = {};
+
+	vkb::InstanceBuilder instance_builder;
+
+	instance_builder.require_api_version(1, 2, 0)
+	                .set_headless(create_surface == nullptr)
+	                .request_validation_layers(config.validation);
+
+	if (config.validation) {
+		instance_builder.use_default_debug_messenger();
+	}
+
+	auto instance_result = instance_builder.build();
+	if (!instance_result) {
+		std::cerr << instance_result.error().message() << '\n';
+		return false;
+	}
+
+	auto instance = instance_result.value();
+
+	device.instance = instance.instance;
+	device.debug_messenger = instance.debug_messenger;
+
+	if (create_surface && !create_surface(device.instance, &device.surface)) {
+		device.surface = VK_NULL_HANDLE;
+		return false;
+	}
+
+	vkb::PhysicalDeviceSelector selector(instance);
+
+	if (device.surface) {
+		selector.set_surface(device.surface);
+	}
+
+	// NOTE: Bindless resources rely on descriptor indexing (core in 1.2)
+	VkPhysicalDeviceVulkan12Features features_12{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+	};
+
+	features_12.descriptorIndexing = true;
+	features_12.runtimeDescriptorArray = true;
+	features_12.shaderSampledImageArrayNonUniformIndexing = true;
+	features_12.descriptorBindingPartiallyBound = true;
+	features_12.descriptorBindingVariableDescriptorCount = true;
+	features_12.descriptorBindingSampledImageUpdateAfterBind = true;
+	features_12.descriptorBindingUpdateUnusedWhilePending = true;
+
+	// NOTE: Geometry pool submits all mesh batches with one indirect call
+	VkPhysicalDeviceFeatures features{};
+	features.multiDrawIndirect = true;
+	features.drawIndirectFirstInstance = true;
+
+	auto selector_result = selector.set_required_features(features)
+	                               .set_required_features_12(features_12)
+	                               .select_devices();
+	if (!selector_result) {
+		std::cerr << selector_result.error().message() << '\n';
+		return false;
+	}
+
+	// NOTE: Every device here meets requirements, they are ordered by
+	//       vk-bootstrap's preference. Take the first one matching
+	//       configured type and name, or the first one at all
+	auto physical_devices = selector_result.value();
+	auto physical_device = physical_devices.front();
+
+	{
+		VkPhysicalDeviceType type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+		switch (config.device_type) {
+		case DeviceType::any: break;
+		case DeviceType::discrete: type = VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU; break;
+		case DeviceType::integrated: type = VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU; break;
+		case DeviceType::virtual_gpu: type = VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU; break;
+		case DeviceType::cpu: type = VK_PHYSICAL_DEVICE_TYPE_CPU; break;
+		}
+
+		auto matches = [&](const vkb::PhysicalDevice& candidate) {
+			return (config.device_type == DeviceType::any || candidate.properties.deviceType == type) &&
+			       (config.device_name.empty() ||
+			        candidate.name.find(config.device_name) != std::string::npos);
+		};
+
+		auto it = std::find_if(physical_devices.begin(), physical_devices.end(), matches);
+
+		if (it != physical_devices.end()) {
+			physical_device = *it;
+		} else {
+			std::cerr << "No suitable device matches configured type and name, using "
+			          << physical_device.name << '\n';
+		}
+	}
+
+	// NOTE: Real heap budgets and usage for memory tracking
+	device.memory_budget = physical_device.enable_extension_if_present(
+		VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+	// NOTE: GPU-driven draw lists pass their draw count in a buffer
+	device.draw_indirect_count = physical_device.enable_extension_if_present(
+		VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+	// NOTE: Meshlets are drawn by mesh shaders, otherwise through the
+	//       vertex pipeline
+	if (config.mesh_shader) {
+		VkPhysicalDeviceMeshShaderFeaturesEXT mesh_shader_features{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+			.meshShader = true,
+		};
+
+		device.mesh_shader = physical_device.enable_extension_if_present(VK_EXT_MESH_SHADER_EXTENSION_NAME) &&
+		                     physical_device.enable_extension_features_if_present(mesh_shader_features);
+	}
+
+	// NOTE: Present completion timestamps for latency statistics
+	if (device.surface) {
+		VkPhysicalDevicePresentIdFeaturesKHR present_id_features{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+			.presentId = true,
+		};
+
+		VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+			.presentWait = true,
+		};
+
+		device.present_wait = physical_device.enable_extension_if_present(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+		                      physical_device.enable_extension_if_present(VK_KHR_PRESENT_WAIT_EXTENSION_NAME) &&
+		                      physical_device.enable_extension_features_if_present(present_id_features) &&
+		                      physical_device.enable_extension_features_if_present(present_wait_features);
+	}
+
+	{ // NOTE: Frames are presented from the graphics queue, its family has
+		//       to support the surface as well
+		const std::vector<VkQueueFamilyProperties> families = physical_device.get_queue_families();
+
+		uint32_t family = 0;
+		for (; family < families.size(); ++family) {
+			if (!(families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+				continue;
+			}
+
+			VkBool32 present = VK_TRUE;
+			if (device.surface) {
+				vkGetPhysicalDeviceSurfaceSupportKHR(physical_device.physical_device, family,
+				                                     device.surface, &present);
+			}
+
+			if (present) {
+				break;
+			}
+		}
+
+		if (family == families.size()) {
+			std::cerr << "Device " << physical_device.name << " has no graphics queue"
+			          << (device.surface ? " that can present\n" : "\n");
+			return false;
+		}
+
+		device.queue_count = std::clamp(queue_count, 1u, families[family].queueCount);
+		if (device.queue_count < queue_count) {
+			std::cerr << "Device " << physical_device.name << " has only " << device.queue_count
+			          << " graphics queues, " << queue_count << " requested\n";
+		}
+
+		std::vector<vkb::CustomQueueDescription> queues{
+			vkb::CustomQueueDescription(family, std::vector<float>(device.queue_count, 1.0f)),
+		};
+
+		vkb::DeviceBuilder device_builder(physical_device);
+
+		auto device_result = device_builder.custom_queue_setup(queues).build();
+		if (!device_result) {
+			std::cerr << device_result.error().message() << '\n';
+			return false;
+		}
+
+		device.device = device_result.value().device;
+		device.physical_device = physical_device.physical_device;
+		device.graphics_queue_family = family;
+	}
+
+	return true;
+}
+
+void veekay::destroyDevice(const Device& device) {
+	if (device.device) {
+		vkDestroyDevice(device.device, nullptr);
+	}
+
+	if (device.surface) {
+		vkDestroySurfaceKHR(device.instance, device.surface, nullptr);
+	}
+
+	if (device.debug_messenger) {
+		vkb::destroy_debug_utils_messenger(device.instance, device.debug_messenger);
+	}
+
+	if (device.instance) {
+		vkDestroyInstance(device.instance, nullptr);
+	}
+}
+
+VkFormat veekay::pickDepthFormat(VkPhysicalDevice physical_device, const ApplicationConfig& config,
+                                 bool sampled) {
+	VkFormatFeatureFlags depth_features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	if (sampled) {
+		depth_features |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+	}
+
+	auto supported = [&](VkFormat format) {
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+
+		return (properties.optimalTilingFeatures & depth_features) == depth_features;
+	};
+
+	if (config.depth_format != VK_FORMAT_UNDEFINED) {
+		if (supported(config.depth_format)) {
+			return config.depth_format;
+		}
+
+		std::cerr << "Configured depth format is not supported, picking another one\n";
+	}
+
+	const VkFormat candidates[] = {
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_D32_SFLOAT_S8_UINT,
+		VK_FORMAT_D24_UNORM_S8_UINT,
+	};
+
+	for (VkFormat format : candidates) {
+		if (supported(format)) {
+			return format;
+		}
+	}
+
+	std::cerr << "Failed to find supported depth format\n";
+	return VK_FORMAT_UNDEFINED;
+}
+
+VkRenderPass veekay::createRenderPass(VkDevice device, VkFormat color_format, VkImageLayout color_layout,
+                                      VkFormat depth_format, bool store_depth, bool load) {
+	const VkAttachmentLoadOp load_op = load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+
+	VkAttachmentDescription attachments[] = {
+		{
+			.format = color_format,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.loadOp = load_op,
+			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			.initialLayout = load ? color_layout : VK_IMAGE_LAYOUT_UNDEFINED,
+			.finalLayout = color_layout,
+		},
+		{
+			.format = depth_format,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.loadOp = load_op,
+			.storeOp = store_depth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			.initialLayout = load ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL :
+			                        VK_IMAGE_LAYOUT_UNDEFINED,
+			.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		},
+	};
+
+	VkAttachmentReference color_ref{
+		.attachment = 0,
+		.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	};
+
+	VkAttachmentReference depth_ref{
+		.attachment = 1,
+		.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+	};
+
+	VkSubpassDescription subpass{
+		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+		.colorAttachmentCount = 1,
+		.pColorAttachments = &color_ref,
+		.pDepthStencilAttachment = &depth_ref,
+	};
+
+	VkSubpassDependency dependency{
+		.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+		                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+		                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+		.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+	};
+
+	VkRenderPassCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+		.attachmentCount = 2,
+		.pAttachments = attachments,
+		.subpassCount = 1,
+		.pSubpasses = &subpass,
+		.dependencyCount = 1,
+		.pDependencies = &dependency,
+	};
+
+	VkRenderPass result;
+	if (vkCreateRenderPass(device, &info, nullptr, &result) != VK_SUCCESS) {
+		std::cerr << "Failed to create render pass\n";
+		return VK_NULL_HANDLE;
+	}
+
+	return result;
+}
@@ -0,0 +1,128 @@
+#include <cstring>
+
+#include <veekay/veekay.hpp>
+#include <veekay/dynamic_mesh.hpp>
+#include <veekay/profiler.hpp>
+
+namespace {
+
+constexpr uint32_t min_capacity = 256;
+
+// NOTE: Doubling keeps regeneration amortized O(1) per element while
+//       segment count is dragged up one step at a time
+uint32_t grownCapacity(uint32_t capacity, uint32_t required) {
+	capacity = (capacity < min_capacity) ? min_capacity : capacity;
+
+	while (capacity < required) {
+		capacity *= 2;
+	}
+
+	return capacity;
+}
+
+} // namespace
+
+void veekay::DynamicMesh::initialize(uint32_t vertex_stride) {
+	vertex_stride_ = vertex_stride;
+	vertex_count_ = 0;
+	index_count_ = 0;
+	version_ = 0;
+
+	slots_.assign(veekay::app->frames_in_flight, Slot{});
+}
+
+void veekay::DynamicMesh::destroy() {
+	for (const Slot& slot : slots_) {
+		if (slot.vertex_buffer.buffer) {
+			destroyBuffer(slot.vertex_buffer);
+		}
+		if (slot.index_buffer.buffer) {
+			destroyBuffer(slot.index_buffer);
+		}
+	}
+
+	slots_.clear();
+	vertices_.clear();
+	indices_.clear();
+}
+
+void veekay::DynamicMesh::update(const void* vertices, uint32_t vertex_count,
+                                 const uint32_t* indices, uint32_t index_count) {
+	const auto* vertex_data = static_cast<const char*>(vertices);
+
+	vertices_.assign(vertex_data, vertex_data + size_t(vertex_count) * vertex_stride_);
+	indices_.assign(indices, indices + index_count);
+
+	vertex_count_ = vertex_count;
+	index_count_ = index_count;
+	++version_;
+}
+
+bool veekay::DynamicMesh::reserve(Slot& slot) {
+	if (vertex_count_ > slot.vertex_capacity) {
+		const uint32_t capacity = grownCapacity(slot.vertex_capacity, vertex_count_);
+
+		Buffer buffer = createBuffer(VkDeviceSize(capacity) * vertex_stride_, nullptr,
+		                             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		if (!buffer.buffer) {
+			return false;
+		}
+
+		destroyBufferDeferred(slot.vertex_buffer);
+		slot.vertex_buffer = buffer;
+		slot.vertex_capacity = capacity;
+	}
+
+	if (index_count_ > slot.index_capacity) {
+		const uint32_t capacity = grownCapacity(slot.index_capacity, index_count_);
+
+		Buffer buffer = createBuffer(VkDeviceSize(capacity) * sizeof(uint32_t), nullptr,
+		                             VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+		if (!buffer.buffer) {
+			return false;
+		}
+
+		destroyBufferDeferred(slot.index_buffer);
+		slot.index_buffer = buffer;
+		slot.index_capacity = capacity;
+	}
+
+	return true;
+}
+
+bool veekay::DynamicMesh::bind(VkCommandBuffer cmd, uint32_t frame) {
+	Slot& slot = slots_[frame];
+
+	if (slot.version != version_) {
+		VEEKAY_PROFILE_SCOPE("Dynamic mesh upload");
+
+		// NOTE: Slot's previous frame has retired, its buffers are free to
+		//       rewrite in place
+		if (!reserve(slot)) {
+			return false;
+		}
+
+		memcpy(slot.vertex_buffer.mapped, vertices_.data(), vertices_.size());
+		memcpy(slot.index_buffer.mapped, indices_.data(), indices_.size() * sizeof(uint32_t));
+		slot.version = version_;
+	}
+
+	if (!slot.vertex_buffer.buffer) {
+		return false;
+	}
+
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmd, 0, 1, &slot.vertex_buffer.buffer, &offset);
+	vkCmdBindIndexBuffer(cmd, slot.index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+	return true;
+}
+
+veekay::MeshRange veekay::DynamicMesh::mesh() const {
+	return MeshRange{
+		.first_index = 0,
+		.index_count = index_count_,
+		.vertex_offset = 0,
+		.vertex_count = vertex_count_,
+	};
+}
@@ -0,0 +1,122 @@
+#include <cstring>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/geometry_pool.hpp>
+
+bool veekay::GeometryPool::initialize(uint32_t vertex_stride, uint32_t max_vertices,
+                                      uint32_t max_indices) {
+	vertex_stride_ = vertex_stride;
+	max_vertices_ = max_vertices;
+	max_indices_ = max_indices;
+	vertex_count_ = 0;
+	index_count_ = 0;
+
+	// NOTE: Vertices are also read as storage buffer, e.g. by mesh shaders
+	vertex_buffer_ = createBuffer(VkDeviceSize(max_vertices) * vertex_stride, nullptr,
+	                              VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	index_buffer_ = createBuffer(VkDeviceSize(max_indices) * sizeof(uint32_t), nullptr,
+	                             VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+	return vertex_buffer_.buffer && index_buffer_.buffer;
+}
+
+void veekay::GeometryPool::destroy() {
+	destroyBuffer(index_buffer_);
+	destroyBuffer(vertex_buffer_);
+	meshes_.clear();
+}
+
+uint32_t veekay::GeometryPool::add(const void* vertices, uint32_t vertex_count,
+                                   const uint32_t* indices, uint32_t index_count) {
+	if (vertex_count_ + vertex_count > max_vertices_ ||
+	    index_count_ + index_count > max_indices_) {
+		std::cerr << "Geometry pool is out of space\n";
+		return invalid_mesh;
+	}
+
+	MeshRange range{
+		.first_index = index_count_,
+		.index_count = index_count,
+		.vertex_offset = static_cast<int32_t>(vertex_count_),
+		.vertex_count = vertex_count,
+	};
+
+	auto* vertex_data = static_cast<char*>(vertex_buffer_.mapped);
+	auto* index_data = static_cast<uint32_t*>(index_buffer_.mapped);
+
+	memcpy(vertex_data + size_t(vertex_count_) * vertex_stride_, vertices,
+	       size_t(vertex_count) * vertex_stride_);
+	memcpy(index_data + index_count_, indices, size_t(index_count) * sizeof(uint32_t));
+
+	vertex_count_ += vertex_count;
+	index_count_ += index_count;
+
+	meshes_.push_back(range);
+
+	return static_cast<uint32_t>(meshes_.size() - 1);
+}
+
+void veekay::GeometryPool::bind(VkCommandBuffer cmd) const {
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmd, 0, 1, &vertex_buffer_.buffer, &offset);
+	vkCmdBindIndexBuffer(cmd, index_buffer_.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+bool veekay::DrawList::initialize(uint32_t max_draws) {
+	max_draws_ = max_draws;
+	frame_ = 0;
+	count_ = 0;
+
+	buffers_.resize(veekay::app->frames_in_flight);
+
+	for (Buffer& buffer : buffers_) {
+		buffer = createBuffer(VkDeviceSize(max_draws) * sizeof(VkDrawIndexedIndirectCommand),
+		                      nullptr, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+		if (!buffer.buffer) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void veekay::DrawList::destroy() {
+	for (const Buffer& buffer : buffers_) {
+		destroyBuffer(buffer);
+	}
+
+	buffers_.clear();
+}
+
+void veekay::DrawList::reset(uint32_t frame) {
+	frame_ = frame;
+	count_ = 0;
+}
+
+void veekay::DrawList::add(const MeshRange& mesh, uint32_t first_instance,
+                           uint32_t instance_count) {
+	if (count_ == max_draws_) {
+		std::cerr << "Draw list is full\n";
+		return;
+	}
+
+	auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(buffers_[frame_].mapped);
+
+	commands[count_++] = VkDrawIndexedIndirectCommand{
+		.indexCount = mesh.index_count,
+		.instanceCount = instance_count,
+		.firstIndex = mesh.first_index,
+		.vertexOffset = mesh.vertex_offset,
+		.firstInstance = first_instance,
+	};
+}
+
+void veekay::DrawList::draw(VkCommandBuffer cmd) const {
+	if (count_ == 0) {
+		return;
+	}
+
+	vkCmdDrawIndexedIndirect(cmd, buffers_[frame_].buffer, 0, count_,
+	                         sizeof(VkDrawIndexedIndirectCommand));
+}
@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/gpu_cylinder.hpp>
+#include <veekay/Cylinder.hpp>
+#include <veekay/profiler.hpp>
+
+namespace {
+
+constexpr uint32_t group_size = 64;
+
+// NOTE: Mirrors push constants of cylinder.comp
+struct CylinderConstants {
+	float radius;
+	float height;
+	uint32_t segments;
+};
+
+// NOTE: GPU sin/cos are only required to be accurate to about 2^-11
+constexpr float validation_tolerance = 1e-3f;
+
+} // namespace
+
+bool veekay::GpuCylinder::initialize(VkShaderModule shader, uint32_t max_segments) {
+	device_ = veekay::app->vk_device;
+	max_segments_ = std::max(max_segments, 3u);
+	segments_ = 0;
+
+	{
+		VkDescriptorSetLayoutBinding bindings[] = {
+			{
+				.binding = 0,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			{
+				.binding = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+		};
+
+		VkDescriptorSetLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = 2,
+			.pBindings = bindings,
+		};
+
+		if (vkCreateDescriptorSetLayout(device_, &info, nullptr, &set_layout_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan descriptor set layout for cylinder generation\n";
+			return false;
+		}
+	}
+
+	{
+		VkPushConstantRange push_constants{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.size = sizeof(CylinderConstants),
+		};
+
+		VkPipelineLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &set_layout_,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &push_constants,
+		};
+
+		if (vkCreatePipelineLayout(device_, &info, nullptr, &layout_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan pipeline layout for cylinder generation\n";
+			return false;
+		}
+	}
+
+	{
+		VkComputePipelineCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = shader,
+				.pName = "main",
+			},
+			.layout = layout_,
+		};
+
+		if (vkCreateComputePipelines(device_, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan compute pipeline for cylinder generation\n";
+			return false;
+		}
+	}
+
+	{ // NOTE: Transfer source for validate() reading them back
+		vertex_buffer_ = createDeviceBuffer(VkDeviceSize(vertexCount(max_segments_)) * sizeof(geometry::Vertex),
+		                                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+		                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+		index_buffer_ = createDeviceBuffer(VkDeviceSize(indexCount(max_segments_)) * sizeof(uint32_t),
+		                                   VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+		                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+		if (!vertex_buffer_.buffer || !index_buffer_.buffer) {
+			return false;
+		}
+	}
+
+	{
+		VkDescriptorPoolSize size{
+			.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 2,
+		};
+
+		VkDescriptorPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.maxSets = 1,
+			.poolSizeCount = 1,
+			.pPoolSizes = &size,
+		};
+
+		if (vkCreateDescriptorPool(device_, &info, nullptr, &pool_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan descriptor pool for cylinder generation\n";
+			return false;
+		}
+	}
+
+	{
+		VkDescriptorSetAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.descriptorPool = pool_,
+			.descriptorSetCount = 1,
+			.pSetLayouts = &set_layout_,
+		};
+
+		if (vkAllocateDescriptorSets(device_, &info, &set_) != VK_SUCCESS) {
+			std::cerr << "Failed to allocate Vulkan descriptor set for cylinder generation\n";
+			return false;
+		}
+
+		VkDescriptorBufferInfo buffers[] = {
+			{
+				.buffer = vertex_buffer_.buffer,
+				.offset = 0,
+				.range = VK_WHOLE_SIZE,
+			},
+			{
+				.buffer = index_buffer_.buffer,
+				.offset = 0,
+				.range = VK_WHOLE_SIZE,
+			},
+		};
+
+		VkWriteDescriptorSet write{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = set_,
+			.dstBinding = 0,
+			.descriptorCount = 2,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo = buffers,
+		};
+
+		vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+	}
+
+	return true;
+}
+
+void veekay::GpuCylinder::destroy() {
+	destroyBuffer(index_buffer_);
+	destroyBuffer(vertex_buffer_);
+
+	vkDestroyDescriptorPool(device_, pool_, nullptr);
+	vkDestroyPipeline(device_, pipeline_, nullptr);
+	vkDestroyPipelineLayout(device_, layout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_, set_layout_, nullptr);
+}
+
+void veekay::GpuCylinder::generate(VkCommandBuffer cmd, float radius, float height, uint32_t segments) {
+	segments = std::clamp(segments, 3u, max_segments_);
+
+	if (segments == segments_ && radius == radius_ && height == height_) {
+		return;
+	}
+
+	record(cmd, radius, height, segments);
+}
+
+void veekay::GpuCylinder::record(VkCommandBuffer cmd, float radius, float height, uint32_t segments) {
+	VEEKAY_PROFILE_FUNCTION();
+
+	{ // NOTE: Draws of earlier frames are done reading before rewrite
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	CylinderConstants constants{
+		.radius = radius,
+		.height = height,
+		.segments = segments,
+	};
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout_,
+	                        0, 1, &set_, 0, nullptr);
+	vkCmdPushConstants(cmd, layout_, VK_SHADER_STAGE_COMPUTE_BIT,
+	                   0, sizeof(constants), &constants);
+	vkCmdDispatch(cmd, (segments + group_size - 1) / group_size, 1, 1);
+
+	{
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+			                 VK_ACCESS_TRANSFER_READ_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	radius_ = radius;
+	height_ = height;
+	segments_ = segments;
+}
+
+void veekay::GpuCylinder::bind(VkCommandBuffer cmd) const {
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmd, 0, 1, &vertex_buffer_.buffer, &offset);
+	vkCmdBindIndexBuffer(cmd, index_buffer_.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+veekay::MeshRange veekay::GpuCylinder::mesh() const {
+	return MeshRange{
+		.first_index = 0,
+		.index_count = segments_ ? indexCount(segments_) : 0,
+		.vertex_offset = 0,
+		.vertex_count = segments_ ? vertexCount(segments_) : 0,
+	};
+}
+
+bool veekay::GpuCylinder::validate(float radius, float height, uint32_t segments) {
+	VkDevice device = device_;
+
+	segments = std::clamp(segments, 3u, max_segments_);
+
+	const uint32_t vertex_count = vertexCount(segments);
+	const uint32_t index_count = indexCount(segments);
+	const VkDeviceSize vertex_size = VkDeviceSize(vertex_count) * sizeof(geometry::Vertex);
+	const VkDeviceSize index_size = VkDeviceSize(index_count) * sizeof(uint32_t);
+
+	Buffer vertex_readback = createBuffer(vertex_size, nullptr, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                                      VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+	Buffer index_readback = createBuffer(index_size, nullptr, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                                     VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+	if (!vertex_readback.buffer || !index_readback.buffer) {
+		destroyBuffer(index_readback);
+		destroyBuffer(vertex_readback);
+		return false;
+	}
+
+	// NOTE: Frames in flight may still draw from the buffers
+	vkQueueWaitIdle(veekay::app->vk_graphics_queue);
+
+	{ // NOTE: Generate, copy back and wait for it
+		VkCommandPool pool;
+		VkCommandBuffer cmd;
+
+		{
+			VkCommandPoolCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+				.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+				.queueFamilyIndex = veekay::app->vk_graphics_queue_family,
+			};
+
+			vkCreateCommandPool(device, &info, nullptr, &pool);
+		}
+
+		{
+			VkCommandBufferAllocateInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = pool,
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = 1,
+			};
+
+			vkAllocateCommandBuffers(device, &info, &cmd);
+		}
+
+		{
+			VkCommandBufferBeginInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+				.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+			};
+
+			vkBeginCommandBuffer(cmd, &info);
+		}
+
+		record(cmd, radius, height, segments);
+
+		VkBufferCopy vertex_region{.size = vertex_size};
+		VkBufferCopy index_region{.size = index_size};
+
+		vkCmdCopyBuffer(cmd, vertex_buffer_.buffer, vertex_readback.buffer, 1, &vertex_region);
+		vkCmdCopyBuffer(cmd, index_buffer_.buffer, index_readback.buffer, 1, &index_region);
+
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkEndCommandBuffer(cmd);
+
+		VkSubmitInfo info{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &cmd,
+		};
+
+		vkQueueSubmit(veekay::app->vk_graphics_queue, 1, &info, VK_NULL_HANDLE);
+		vkQueueWaitIdle(veekay::app->vk_graphics_queue);
+
+		vkDestroyCommandPool(device, pool, nullptr);
+	}
+
+	geometry::Cylinder reference(radius, height, segments);
+
+	bool valid = true;
+
+	if (reference.getVertexCount() != vertex_count || reference.getIndexCount() != index_count) {
+		std::cerr << "GPU cylinder size differs from CPU one: " << vertex_count << " vertices, "
+		          << index_count << " indices instead of " << reference.getVertexCount() << ", "
+		          << reference.getIndexCount() << '\n';
+		valid = false;
+	}
+
+	if (valid) {
+		const auto* indices = static_cast<const uint32_t*>(index_readback.mapped);
+
+		for (uint32_t i = 0; i < index_count; ++i) {
+			if (indices[i] != reference.indices_[i]) {
+				std::cerr << "GPU cylinder index " << i << " is " << indices[i]
+				          << " instead of " << reference.indices_[i] << '\n';
+				valid = false;
+				break;
+			}
+		}
+	}
+
+	if (valid) { // NOTE: Positions scale with size, normals and uvs don't
+		const auto* vertices = static_cast<const float*>(vertex_readback.mapped);
+		const auto* expected = reinterpret_cast<const float*>(reference.vertices_.data());
+		const float scale = std::max({std::fabs(radius), std::fabs(height), 1.0f});
+
+		constexpr uint32_t floats_per_vertex = sizeof(geometry::Vertex) / sizeof(float);
+
+		for (uint32_t i = 0; i < vertex_count * floats_per_vertex; ++i) {
+			const float tolerance = validation_tolerance * ((i % floats_per_vertex < 3) ? scale : 1.0f);
+
+			if (std::fabs(vertices[i] - expected[i]) > tolerance) {
+				std::cerr << "GPU cylinder vertex " << i / floats_per_vertex << " component "
+				          << i % floats_per_vertex << " is " << vertices[i]
+				          << " instead of " << expected[i] << '\n';
+				valid = false;
+				break;
+			}
+		}
+	}
+
+	destroyBuffer(index_readback);
+	destroyBuffer(vertex_readback);
+
+	return valid;
+}
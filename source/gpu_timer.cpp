@@ -0,0 +1,120 @@
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/gpu_timer.hpp>
+
+bool veekay::GpuTimer::initialize() {
+	device_ = veekay::app->vk_device;
+	pool_ = VK_NULL_HANDLE;
+	frame_ = 0;
+	open_ = false;
+
+	slots_.assign(veekay::app->frames_in_flight, Slot{});
+
+	{
+		uint32_t count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(veekay::app->vk_physical_device, &count, nullptr);
+
+		std::vector<VkQueueFamilyProperties> families(count);
+		vkGetPhysicalDeviceQueueFamilyProperties(veekay::app->vk_physical_device, &count, families.data());
+
+		const uint32_t valid_bits = families[veekay::app->vk_graphics_queue_family].timestampValidBits;
+		if (valid_bits == 0) {
+			std::cerr << "Graphics queue doesn't support timestamps, GPU timings are off\n";
+			return true;
+		}
+
+		valid_mask_ = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+	}
+
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(veekay::app->vk_physical_device, &properties);
+
+		period_ = properties.limits.timestampPeriod;
+	}
+
+	{ // NOTE: Begin and end timestamp of every pass of every slot
+		VkQueryPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = static_cast<uint32_t>(slots_.size()) * max_passes * 2,
+		};
+
+		if (vkCreateQueryPool(device_, &info, nullptr, &pool_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan query pool for GPU timings\n";
+			pool_ = VK_NULL_HANDLE;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void veekay::GpuTimer::destroy() {
+	vkDestroyQueryPool(device_, pool_, nullptr);
+	pool_ = VK_NULL_HANDLE;
+}
+
+void veekay::GpuTimer::beginFrame(VkCommandBuffer cmd) {
+	if (!pool_) {
+		return;
+	}
+
+	frame_ = veekay::app->frame_index;
+	open_ = false;
+
+	Slot& slot = slots_[frame_];
+	const uint32_t first_query = frame_ * max_passes * 2;
+
+	// NOTE: Slot's fence has signaled, so results are there unless its
+	//       command buffer never got submitted, then old timings stay
+	if (slot.pass_count != 0) {
+		uint64_t timestamps[max_passes * 2];
+		const VkResult result = vkGetQueryPoolResults(device_, pool_, first_query, slot.pass_count * 2,
+		                                              sizeof(timestamps), timestamps, sizeof(uint64_t),
+		                                              VK_QUERY_RESULT_64_BIT);
+
+		if (result == VK_SUCCESS) {
+			timings_.clear();
+			for (uint32_t i = 0; i < slot.pass_count; ++i) {
+				const uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & valid_mask_;
+				timings_.push_back({slot.names[i], double(ticks) * period_ * 1e-6});
+			}
+		}
+	}
+
+	slot.pass_count = 0;
+	vkCmdResetQueryPool(cmd, pool_, first_query, max_passes * 2);
+}
+
+void veekay::GpuTimer::begin(VkCommandBuffer cmd, const char* name) {
+	if (!pool_ || open_) {
+		return;
+	}
+
+	Slot& slot = slots_[frame_];
+	if (slot.pass_count == max_passes) {
+		return;
+	}
+
+	const uint32_t query = (frame_ * max_passes + slot.pass_count) * 2;
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool_, query);
+
+	slot.names[slot.pass_count] = name;
+	open_ = true;
+}
+
+void veekay::GpuTimer::end(VkCommandBuffer cmd) {
+	if (!open_) {
+		return;
+	}
+
+	Slot& slot = slots_[frame_];
+
+	const uint32_t query = (frame_ * max_passes + slot.pass_count) * 2 + 1;
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool_, query);
+
+	++slot.pass_count;
+	open_ = false;
+}
@@ -0,0 +1,211 @@
+#include <cstring>
+#include <iostream>
+
+#include <imgui.h>
+#include <imgui_internal.h>
+
+#include <veekay/input_replay.hpp>
+
+namespace {
+
+constexpr char replay_magic[4] = {'V', 'K', 'I', 'R'};
+constexpr uint32_t replay_version = 1;
+
+} // namespace
+
+bool veekay::InputReplay::startRecording(const char* path) {
+	stop();
+
+	file_ = fopen(path, "wb");
+	if (!file_) {
+		std::cerr << "Failed to open " << path << " for input recording\n";
+		return false;
+	}
+
+	fwrite(replay_magic, 1, sizeof(replay_magic), file_);
+	fwrite(&replay_version, sizeof(replay_version), 1, file_);
+
+	playing_ = false;
+	next_event_id_ = ImGui::GetCurrentContext()->InputEventsNextEventId;
+
+	return true;
+}
+
+bool veekay::InputReplay::startPlayback(const char* path) {
+	stop();
+
+	file_ = fopen(path, "rb");
+	if (!file_) {
+		std::cerr << "Failed to open input recording " << path << '\n';
+		return false;
+	}
+
+	char magic[4];
+	uint32_t version;
+
+	if (fread(magic, 1, sizeof(magic), file_) != sizeof(magic) ||
+	    fread(&version, sizeof(version), 1, file_) != 1 ||
+	    memcmp(magic, replay_magic, sizeof(magic)) != 0 ||
+	    version != replay_version) {
+		std::cerr << "File " << path << " is not a valid input recording\n";
+		stop();
+		return false;
+	}
+
+	playing_ = true;
+	next_event_id_ = ImGui::GetCurrentContext()->InputEventsNextEventId;
+
+	return true;
+}
+
+void veekay::InputReplay::stop() {
+	if (file_) {
+		fclose(file_);
+		file_ = nullptr;
+	}
+}
+
+bool veekay::InputReplay::frame(Clock& clock) {
+	if (!file_) {
+		return true;
+	}
+
+	if (playing_) {
+		return play(clock);
+	}
+
+	record(clock);
+	return true;
+}
+
+void veekay::InputReplay::record(Clock& clock) {
+	ImGuiContext& context = *ImGui::GetCurrentContext();
+
+	events_.clear();
+
+	for (const ImGuiInputEvent& e : context.InputEventsQueue) {
+		if (e.EventId < next_event_id_) {
+			continue;
+		}
+
+		// NOTE: Zeroed, fields the type doesn't use are written too
+		Event event{};
+		event.type = static_cast<uint32_t>(e.Type);
+
+		switch (e.Type) {
+		case ImGuiInputEventType_MousePos:
+			event.x = e.MousePos.PosX;
+			event.y = e.MousePos.PosY;
+			break;
+
+		case ImGuiInputEventType_MouseWheel:
+			event.x = e.MouseWheel.WheelX;
+			event.y = e.MouseWheel.WheelY;
+			break;
+
+		case ImGuiInputEventType_MouseButton:
+			event.value = e.MouseButton.Button;
+			event.x = e.MouseButton.Down ? 1.0f : 0.0f;
+			break;
+
+		case ImGuiInputEventType_Key:
+			event.value = e.Key.Key;
+			event.x = e.Key.Down ? 1.0f : 0.0f;
+			event.y = e.Key.AnalogValue;
+			break;
+
+		case ImGuiInputEventType_Text:
+			event.value = static_cast<int32_t>(e.Text.Char);
+			break;
+
+		case ImGuiInputEventType_Focus:
+			event.value = e.AppFocused.Focused;
+			break;
+
+		default:
+			continue;
+		}
+
+		events_.push_back(event);
+	}
+
+	next_event_id_ = context.InputEventsNextEventId;
+
+	// NOTE: Value-initialized so trailing padding is zero as well and
+	//       recordings of the same input are identical
+	FrameHeader header{};
+	header.time = clock.time();
+	header.delta = clock.delta();
+	header.imgui_delta = context.IO.DeltaTime;
+	header.steps = clock.steps();
+	header.event_count = static_cast<uint32_t>(events_.size());
+
+	fwrite(&header, sizeof(header), 1, file_);
+	fwrite(events_.data(), sizeof(Event), events_.size(), file_);
+}
+
+bool veekay::InputReplay::play(Clock& clock) {
+	ImGuiContext& context = *ImGui::GetCurrentContext();
+	ImGuiIO& io = context.IO;
+
+	FrameHeader header;
+	if (fread(&header, sizeof(header), 1, file_) != 1) {
+		stop();
+		return false;
+	}
+
+	events_.resize(header.event_count);
+	if (fread(events_.data(), sizeof(Event), events_.size(), file_) != events_.size()) {
+		stop();
+		return false;
+	}
+
+	// NOTE: Drop live events of this frame, keep replayed ones trickling
+	//       over from previous frames
+	ImVector<ImGuiInputEvent>& queue = context.InputEventsQueue;
+	for (int i = 0; i < queue.Size;) {
+		if (queue[i].EventId >= next_event_id_) {
+			queue.erase(queue.Data + i);
+		} else {
+			++i;
+		}
+	}
+
+	for (const Event& event : events_) {
+		switch (static_cast<ImGuiInputEventType>(event.type)) {
+		case ImGuiInputEventType_MousePos:
+			io.AddMousePosEvent(event.x, event.y);
+			break;
+
+		case ImGuiInputEventType_MouseWheel:
+			io.AddMouseWheelEvent(event.x, event.y);
+			break;
+
+		case ImGuiInputEventType_MouseButton:
+			io.AddMouseButtonEvent(event.value, event.x != 0.0f);
+			break;
+
+		case ImGuiInputEventType_Key:
+			io.AddKeyAnalogEvent(static_cast<ImGuiKey>(event.value), event.x != 0.0f, event.y);
+			break;
+
+		case ImGuiInputEventType_Text:
+			io.AddInputCharacter(static_cast<unsigned int>(event.value));
+			break;
+
+		case ImGuiInputEventType_Focus:
+			io.AddFocusEvent(event.value != 0);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	next_event_id_ = context.InputEventsNextEventId;
+
+	io.DeltaTime = header.imgui_delta;
+	clock.set(header.time, header.delta, header.steps);
+
+	return true;
+}
@@ -0,0 +1,240 @@
+#include <iostream>
+#include <string>
+
+#include <veekay/veekay.hpp>
+#include <veekay/jobs.hpp>
+#include <veekay/profiler.hpp>
+
+namespace {
+
+constexpr uint32_t no_queue = UINT32_MAX;
+
+// NOTE: Queue of the calling thread within the system it belongs to,
+//       threads foreign to the system only push round-robin and steal
+thread_local const veekay::JobSystem* current_system = nullptr;
+thread_local uint32_t current_queue = no_queue;
+
+} // namespace
+
+bool veekay::JobSystem::initialize(uint32_t worker_count) {
+	if (worker_count == 0) {
+		const uint32_t hardware = std::thread::hardware_concurrency();
+		worker_count = (hardware > 1) ? hardware - 1 : 1;
+	}
+
+	quit_ = false;
+
+	queues_.clear();
+	for (uint32_t i = 0; i <= worker_count; ++i) {
+		queues_.push_back(std::make_unique<Queue>());
+	}
+
+	current_system = this;
+	current_queue = 0;
+
+	for (uint32_t i = 1; i <= worker_count; ++i) {
+		try {
+			workers_.emplace_back(&JobSystem::workerLoop, this, i, veekay::app);
+		} catch (const std::system_error&) {
+			std::cerr << "Failed to start job worker thread\n";
+			destroy();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void veekay::JobSystem::destroy() {
+	{
+		std::lock_guard lock(sleep_mutex_);
+		quit_ = true;
+	}
+	wake_.notify_all();
+
+	// NOTE: Workers drain every queue before leaving
+	for (std::thread& worker : workers_) {
+		worker.join();
+	}
+	workers_.clear();
+
+	while (tryExecute(0)) {}
+
+	queues_.clear();
+
+	if (current_system == this) {
+		current_system = nullptr;
+		current_queue = no_queue;
+	}
+}
+
+void veekay::JobSystem::run(Job job, JobCounter* counter) {
+	if (counter) {
+		counter->pending_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	push(Task{std::move(job), counter});
+}
+
+void veekay::JobSystem::then(JobCounter& counter, Job continuation, JobCounter* next) {
+	if (next) {
+		next->pending_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard lock(counter.mutex_);
+
+		// NOTE: Pending count only drops under this mutex, so counter can't
+		//       finish between check and append
+		if (counter.pending_.load(std::memory_order_acquire) != 0) {
+			JobCounter* target = next;
+			counter.continuations_.push_back([this, job = std::move(continuation), target]() mutable {
+				push(Task{std::move(job), target});
+			});
+			return;
+		}
+	}
+
+	push(Task{std::move(continuation), next});
+}
+
+void veekay::JobSystem::wait(JobCounter& counter) {
+	const uint32_t queue = (current_system == this) ? current_queue : no_queue;
+
+	while (!counter.done()) {
+		if (!tryExecute(queue)) {
+			std::this_thread::yield();
+		}
+	}
+
+	// NOTE: Last finishing job may still hold counter mutex, counter is
+	//       commonly destroyed right after wait returns
+	std::lock_guard lock(counter.mutex_);
+}
+
+void veekay::JobSystem::push(Task task) {
+	uint32_t queue = (current_system == this) ? current_queue : no_queue;
+	if (queue == no_queue) {
+		queue = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+	}
+
+	// NOTE: Counted before it's visible so a thief can't decrement first
+	{
+		std::lock_guard lock(sleep_mutex_);
+		queued_.fetch_add(1, std::memory_order_release);
+	}
+
+	{
+		std::lock_guard lock(queues_[queue]->mutex);
+		queues_[queue]->tasks.push_back(std::move(task));
+	}
+	wake_.notify_one();
+}
+
+bool veekay::JobSystem::pop(uint32_t queue, Task& task) {
+	Queue& q = *queues_[queue];
+
+	std::lock_guard lock(q.mutex);
+	if (q.tasks.empty()) {
+		return false;
+	}
+
+	task = std::move(q.tasks.back());
+	q.tasks.pop_back();
+	return true;
+}
+
+bool veekay::JobSystem::steal(uint32_t thief, Task& task) {
+	const uint32_t count = static_cast<uint32_t>(queues_.size());
+	const uint32_t first = (thief == no_queue) ? 0 : thief + 1;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		const uint32_t victim = (first + i) % count;
+		if (victim == thief) {
+			continue;
+		}
+
+		Queue& q = *queues_[victim];
+
+		// NOTE: Busy victim is skipped rather than waited for
+		std::unique_lock lock(q.mutex, std::try_to_lock);
+		if (!lock.owns_lock() || q.tasks.empty()) {
+			continue;
+		}
+
+		task = std::move(q.tasks.front());
+		q.tasks.pop_front();
+		return true;
+	}
+
+	return false;
+}
+
+bool veekay::JobSystem::tryExecute(uint32_t queue) {
+	if (queued_.load(std::memory_order_acquire) == 0) {
+		return false;
+	}
+
+	Task task;
+	if ((queue == no_queue || !pop(queue, task)) && !steal(queue, task)) {
+		return false;
+	}
+
+	queued_.fetch_sub(1, std::memory_order_relaxed);
+	execute(task);
+	return true;
+}
+
+void veekay::JobSystem::execute(Task& task) {
+	{
+		VEEKAY_PROFILE_SCOPE("Job");
+		task.job();
+	}
+
+	// NOTE: Release job captures before counter can signal completion
+	task.job = nullptr;
+
+	if (task.counter) {
+		finish(*task.counter);
+	}
+}
+
+void veekay::JobSystem::finish(JobCounter& counter) {
+	std::vector<Job> continuations;
+
+	{
+		std::lock_guard lock(counter.mutex_);
+		if (counter.pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			continuations.swap(counter.continuations_);
+		}
+	}
+
+	// NOTE: Counter may be gone already, continuations don't touch it
+	for (Job& continuation : continuations) {
+		continuation();
+	}
+}
+
+void veekay::JobSystem::workerLoop(uint32_t queue, Application* app) {
+	// NOTE: Jobs run with the app of the context that owns this system
+	veekay::app = app;
+	current_system = this;
+	current_queue = queue;
+
+	VEEKAY_PROFILE_THREAD(("Worker " + std::to_string(queue)).c_str());
+
+	for (;;) {
+		if (tryExecute(queue)) {
+			continue;
+		}
+
+		std::unique_lock lock(sleep_mutex_);
+		wake_.wait(lock, [this] {
+			return quit_ || queued_.load(std::memory_order_acquire) != 0;
+		});
+
+		if (quit_ && queued_.load(std::memory_order_acquire) == 0) {
+			break;
+		}
+	}
+}
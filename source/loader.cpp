@@ -0,0 +1,327 @@
+#include <cstring>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/loader.hpp>
+#include <veekay/profiler.hpp>
+
+void* veekay::Upload::stage(VkBuffer dst, VkDeviceSize offset, VkDeviceSize size) {
+	Buffer staging = createBuffer(size, nullptr, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	if (!staging.buffer) {
+		return nullptr;
+	}
+
+	regions_.push_back({staging, dst, offset, size});
+	size_ += size;
+
+	return staging.mapped;
+}
+
+bool veekay::Upload::copy(VkBuffer dst, VkDeviceSize offset, const void* data, VkDeviceSize size) {
+	void* mapped = stage(dst, offset, size);
+	if (!mapped) {
+		return false;
+	}
+
+	memcpy(mapped, data, size);
+
+	return true;
+}
+
+void veekay::Upload::release() {
+	for (const Region& region : regions_) {
+		destroyBuffer(region.staging);
+	}
+
+	regions_.clear();
+	size_ = 0;
+}
+
+bool veekay::ResourceLoader::initialize() {
+	device_ = veekay::app->vk_device;
+
+	{
+		VkCommandPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = veekay::app->vk_graphics_queue_family,
+		};
+
+		if (vkCreateCommandPool(device_, &info, nullptr, &command_pool_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan command pool for resource loader\n";
+			return false;
+		}
+	}
+
+	quit_ = false;
+	loader_ = std::thread(&ResourceLoader::loaderLoop, this, veekay::app);
+
+	return true;
+}
+
+void veekay::ResourceLoader::destroy() {
+	if (loader_.joinable()) {
+		{
+			std::lock_guard lock(mutex_);
+			quit_ = true;
+		}
+
+		wake_.notify_one();
+		loader_.join();
+	}
+
+	requests_.clear();
+
+	for (Staged& staged : staged_) {
+		staged.upload.release();
+	}
+
+	staged_.clear();
+
+	// NOTE: Device is idle here, every submitted copy has finished
+	for (Batch& batch : in_flight_) {
+		for (Staged& staged : batch.loads) {
+			staged.upload.release();
+		}
+
+		free_batches_.push_back(std::move(batch));
+	}
+
+	in_flight_.clear();
+
+	for (const Batch& batch : free_batches_) {
+		vkDestroyFence(device_, batch.fence, nullptr);
+	}
+
+	free_batches_.clear();
+
+	vkDestroyCommandPool(device_, command_pool_, nullptr);
+
+	pending_.store(0, std::memory_order_release);
+}
+
+std::shared_future<bool> veekay::ResourceLoader::load(Load load, Callback done) {
+	Request request{
+		.load = std::move(load),
+		.done = std::move(done),
+	};
+
+	std::shared_future<bool> future = request.promise.get_future().share();
+
+	pending_.fetch_add(1, std::memory_order_acq_rel);
+
+	{
+		std::lock_guard lock(mutex_);
+		requests_.push_back(std::move(request));
+	}
+
+	wake_.notify_one();
+
+	return future;
+}
+
+void veekay::ResourceLoader::poll() {
+	VEEKAY_PROFILE_FUNCTION();
+
+	// NOTE: Batches retire in submission order, stop at first unfinished
+	while (!in_flight_.empty() && vkGetFenceStatus(device_, in_flight_.front().fence) == VK_SUCCESS) {
+		Batch batch = std::move(in_flight_.front());
+		in_flight_.pop_front();
+
+		for (Staged& staged : batch.loads) {
+			complete(staged);
+		}
+
+		batch.loads.clear();
+		free_batches_.push_back(std::move(batch));
+	}
+
+	std::vector<Staged> staged;
+	{
+		std::lock_guard lock(mutex_);
+		staged.swap(staged_);
+	}
+
+	// NOTE: Failed loads and loads without uploads are done right away
+	std::vector<Staged> uploads;
+	for (Staged& load : staged) {
+		if (load.success && !load.upload.regions_.empty()) {
+			uploads.push_back(std::move(load));
+		} else {
+			complete(load);
+		}
+	}
+
+	if (!uploads.empty() && !submit(uploads)) {
+		for (Staged& load : uploads) {
+			load.success = false;
+			complete(load);
+		}
+	}
+}
+
+void veekay::ResourceLoader::flush() {
+	for (;;) {
+		poll();
+
+		if (pendingCount() == 0) {
+			return;
+		}
+
+		if (!in_flight_.empty()) {
+			vkWaitForFences(device_, 1, &in_flight_.front().fence, true, UINT64_MAX);
+		} else { // NOTE: Something is still queued or loading on loader thread
+			std::unique_lock lock(mutex_);
+			staged_wake_.wait(lock, [this] { return !staged_.empty(); });
+		}
+	}
+}
+
+void veekay::ResourceLoader::loaderLoop(Application* app) {
+	veekay::app = app;
+	VEEKAY_PROFILE_THREAD("Loader");
+
+	for (;;) {
+		Request request;
+
+		{
+			std::unique_lock lock(mutex_);
+			wake_.wait(lock, [this] { return quit_ || !requests_.empty(); });
+
+			// NOTE: Unlike frame capture, queued loads are abandoned on quit
+			if (quit_) {
+				return;
+			}
+
+			request = std::move(requests_.front());
+			requests_.pop_front();
+		}
+
+		Staged staged{
+			.success = false,
+			.done = std::move(request.done),
+			.promise = std::move(request.promise),
+		};
+
+		{
+			VEEKAY_PROFILE_SCOPE("Load");
+			staged.success = request.load(staged.upload);
+		}
+
+		if (!staged.success) {
+			staged.upload.release();
+		}
+
+		{
+			std::lock_guard lock(mutex_);
+			staged_.push_back(std::move(staged));
+		}
+
+		staged_wake_.notify_all();
+	}
+}
+
+void veekay::ResourceLoader::complete(Staged& staged) {
+	staged.upload.release();
+
+	staged.promise.set_value(staged.success);
+
+	if (staged.done) {
+		staged.done(staged.success);
+	}
+
+	pending_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool veekay::ResourceLoader::submit(std::vector<Staged>& loads) {
+	VEEKAY_PROFILE_FUNCTION();
+
+	Batch batch;
+
+	if (!free_batches_.empty()) {
+		batch = std::move(free_batches_.back());
+		free_batches_.pop_back();
+
+		vkResetFences(device_, 1, &batch.fence);
+	} else {
+		{
+			VkCommandBufferAllocateInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = command_pool_,
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = 1,
+			};
+
+			if (vkAllocateCommandBuffers(device_, &info, &batch.cmd) != VK_SUCCESS) {
+				std::cerr << "Failed to allocate Vulkan command buffer for resource loader\n";
+				return false;
+			}
+		}
+
+		{
+			VkFenceCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+			};
+
+			if (vkCreateFence(device_, &info, nullptr, &batch.fence) != VK_SUCCESS) {
+				std::cerr << "Failed to create Vulkan fence for resource loader\n";
+				vkFreeCommandBuffers(device_, command_pool_, 1, &batch.cmd);
+				return false;
+			}
+		}
+	}
+
+	{
+		VkCommandBufferBeginInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		};
+
+		vkBeginCommandBuffer(batch.cmd, &info);
+	}
+
+	for (const Staged& load : loads) {
+		for (const Upload::Region& region : load.upload.regions_) {
+			VkBufferCopy copy{
+				.srcOffset = 0,
+				.dstOffset = region.offset,
+				.size = region.size,
+			};
+
+			vkCmdCopyBuffer(batch.cmd, region.staging.buffer, region.dst, 1, &copy);
+		}
+	}
+
+	{ // NOTE: Later submissions on this queue see the copied data, whatever
+		//       they use it for
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+		};
+
+		vkCmdPipelineBarrier(batch.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	vkEndCommandBuffer(batch.cmd);
+
+	{
+		VkSubmitInfo info{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &batch.cmd,
+		};
+
+		if (vkQueueSubmit(veekay::app->vk_graphics_queue, 1, &info, batch.fence) != VK_SUCCESS) {
+			std::cerr << "Failed to submit resource loader uploads\n";
+			free_batches_.push_back(std::move(batch));
+			return false;
+		}
+	}
+
+	batch.loads = std::move(loads);
+	in_flight_.push_back(std::move(batch));
+
+	return true;
+}
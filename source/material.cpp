@@ -0,0 +1,421 @@
+#include <cstring>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/material.hpp>
+
+bool veekay::MaterialSystem::initialize(uint32_t max_materials, uint32_t max_textures) {
+	VkDevice device = veekay::app->vk_device;
+	const uint32_t frames = veekay::app->frames_in_flight;
+
+	max_materials_ = max_materials;
+	max_textures_ = max_textures;
+	texture_count_ = 0;
+	all_frames_mask_ = static_cast<uint8_t>((1u << frames) - 1u);
+
+	{ // NOTE: Sampler shared by every texture in the array
+		VkSamplerCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+			.magFilter = VK_FILTER_LINEAR,
+			.minFilter = VK_FILTER_LINEAR,
+			.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+			.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			.maxLod = VK_LOD_CLAMP_NONE,
+		};
+
+		if (vkCreateSampler(device, &info, nullptr, &sampler_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan sampler for materials\n";
+			return false;
+		}
+	}
+
+	{ // NOTE: Texture array may be updated while bound and left partially empty
+		VkDescriptorSetLayoutBinding bindings[] = {
+			{
+				.binding = 0,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			},
+			{
+				.binding = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = max_textures_,
+				.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			},
+		};
+
+		VkDescriptorBindingFlags binding_flags[] = {
+			0,
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+			VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT,
+		};
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+			.bindingCount = 2,
+			.pBindingFlags = binding_flags,
+		};
+
+		VkDescriptorSetLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.pNext = &flags_info,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+			.bindingCount = 2,
+			.pBindings = bindings,
+		};
+
+		if (vkCreateDescriptorSetLayout(device, &info, nullptr, &set_layout_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan descriptor set layout for materials\n";
+			return false;
+		}
+	}
+
+	{
+		VkDescriptorPoolSize sizes[] = {
+			{
+				.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = frames,
+			},
+			{
+				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = frames * max_textures_,
+			},
+		};
+
+		VkDescriptorPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+			.maxSets = frames,
+			.poolSizeCount = 2,
+			.pPoolSizes = sizes,
+		};
+
+		if (vkCreateDescriptorPool(device, &info, nullptr, &pool_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan descriptor pool for materials\n";
+			return false;
+		}
+	}
+
+	buffers_.resize(frames);
+	sets_.resize(frames);
+
+	for (uint32_t i = 0; i < frames; ++i) {
+		buffers_[i] = createBuffer(max_materials_ * sizeof(Material), nullptr,
+		                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		if (!buffers_[i].buffer) {
+			return false;
+		}
+
+		{
+			VkDescriptorSetVariableDescriptorCountAllocateInfo count_info{
+				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+				.descriptorSetCount = 1,
+				.pDescriptorCounts = &max_textures_,
+			};
+
+			VkDescriptorSetAllocateInfo info{
+				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+				.pNext = &count_info,
+				.descriptorPool = pool_,
+				.descriptorSetCount = 1,
+				.pSetLayouts = &set_layout_,
+			};
+
+			if (vkAllocateDescriptorSets(device, &info, &sets_[i]) != VK_SUCCESS) {
+				std::cerr << "Failed to allocate Vulkan descriptor set for materials\n";
+				return false;
+			}
+		}
+
+		VkDescriptorBufferInfo buffer_info{
+			.buffer = buffers_[i].buffer,
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkWriteDescriptorSet write{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = sets_[i],
+			.dstBinding = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo = &buffer_info,
+		};
+
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	}
+
+	return true;
+}
+
+void veekay::MaterialSystem::destroy() {
+	VkDevice device = veekay::app->vk_device;
+
+	for (const Texture& texture : textures_) {
+		vkDestroyImageView(device, texture.view, nullptr);
+		vkDestroyImage(device, texture.image, nullptr);
+		freeMemory(texture.memory);
+	}
+
+	for (const Buffer& buffer : buffers_) {
+		destroyBuffer(buffer);
+	}
+
+	vkDestroyDescriptorPool(device, pool_, nullptr);
+	vkDestroyDescriptorSetLayout(device, set_layout_, nullptr);
+	vkDestroySampler(device, sampler_, nullptr);
+
+	textures_.clear();
+	buffers_.clear();
+	sets_.clear();
+	materials_.clear();
+	dirty_.clear();
+	dirty_list_.clear();
+}
+
+uint32_t veekay::MaterialSystem::create(const Material& material) {
+	const uint32_t id = static_cast<uint32_t>(materials_.size());
+	if (id == max_materials_) {
+		std::cerr << "Out of material slots\n";
+		return 0;
+	}
+
+	materials_.push_back(material);
+	dirty_.push_back(0);
+	markDirty(id);
+
+	return id;
+}
+
+void veekay::MaterialSystem::update(uint32_t id, const Material& material) {
+	materials_[id] = material;
+	markDirty(id);
+}
+
+void veekay::MaterialSystem::markDirty(uint32_t id) {
+	if (dirty_[id] == 0) {
+		dirty_list_.push_back(id);
+	}
+
+	dirty_[id] = all_frames_mask_;
+}
+
+void veekay::MaterialSystem::flush(uint32_t frame) {
+	const uint8_t bit = static_cast<uint8_t>(1u << frame);
+	auto* gpu_materials = static_cast<Material*>(buffers_[frame].mapped);
+
+	size_t kept = 0;
+	for (size_t i = 0, e = dirty_list_.size(); i != e; ++i) {
+		const uint32_t id = dirty_list_[i];
+
+		if (dirty_[id] & bit) {
+			gpu_materials[id] = materials_[id];
+			dirty_[id] &= static_cast<uint8_t>(~bit);
+		}
+
+		if (dirty_[id] != 0) {
+			dirty_list_[kept++] = id;
+		}
+	}
+
+	dirty_list_.resize(kept);
+}
+
+uint32_t veekay::MaterialSystem::addTexture(VkImageView view) {
+	if (texture_count_ == max_textures_) {
+		std::cerr << "Out of bindless texture slots\n";
+		return no_texture;
+	}
+
+	const uint32_t index = texture_count_++;
+
+	VkDescriptorImageInfo image_info{
+		.sampler = sampler_,
+		.imageView = view,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	// NOTE: Slot was never used before, so it is safe to write it even
+	//       while sets are bound in pending command buffers
+	for (VkDescriptorSet set : sets_) {
+		VkWriteDescriptorSet write{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = set,
+			.dstBinding = 1,
+			.dstArrayElement = index,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.pImageInfo = &image_info,
+		};
+
+		vkUpdateDescriptorSets(veekay::app->vk_device, 1, &write, 0, nullptr);
+	}
+
+	return index;
+}
+
+uint32_t veekay::MaterialSystem::createTexture(uint32_t width, uint32_t height, const void* pixels) {
+	VkDevice device = veekay::app->vk_device;
+
+	const VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+	const VkDeviceSize size = VkDeviceSize(width) * height * 4;
+
+	Texture texture{};
+
+	{
+		VkImageCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = format,
+			.extent = {width, height, 1},
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		};
+
+		if (vkCreateImage(device, &info, nullptr, &texture.image) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan texture image\n";
+			return no_texture;
+		}
+	}
+
+	{
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, texture.image, &requirements);
+
+		texture.memory = allocateMemory(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                MemoryCategory::image);
+		if (!texture.memory) {
+			std::cerr << "Failed to allocate memory for Vulkan texture image\n";
+			vkDestroyImage(device, texture.image, nullptr);
+			return no_texture;
+		}
+
+		vkBindImageMemory(device, texture.image, texture.memory, 0);
+	}
+
+	{ // NOTE: Upload through staging buffer and wait for it
+		Buffer staging = createBuffer(size, pixels, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+		VkCommandPool pool;
+		VkCommandBuffer cmd;
+
+		{
+			VkCommandPoolCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+				.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+				.queueFamilyIndex = veekay::app->vk_graphics_queue_family,
+			};
+
+			vkCreateCommandPool(device, &info, nullptr, &pool);
+		}
+
+		{
+			VkCommandBufferAllocateInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = pool,
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = 1,
+			};
+
+			vkAllocateCommandBuffers(device, &info, &cmd);
+		}
+
+		{
+			VkCommandBufferBeginInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+				.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+			};
+
+			vkBeginCommandBuffer(cmd, &info);
+		}
+
+		VkImageMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = texture.image,
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.levelCount = 1,
+				.layerCount = 1,
+			},
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		                     0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkBufferImageCopy region{
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.layerCount = 1,
+			},
+			.imageExtent = {width, height, 1},
+		};
+
+		vkCmdCopyBufferToImage(cmd, staging.buffer, texture.image,
+		                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		                     0, nullptr, 0, nullptr, 1, &barrier);
+
+		vkEndCommandBuffer(cmd);
+
+		VkSubmitInfo info{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &cmd,
+		};
+
+		vkQueueSubmit(veekay::app->vk_graphics_queue, 1, &info, VK_NULL_HANDLE);
+		vkQueueWaitIdle(veekay::app->vk_graphics_queue);
+
+		vkDestroyCommandPool(device, pool, nullptr);
+		destroyBuffer(staging);
+	}
+
+	{
+		VkImageViewCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = texture.image,
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = format,
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		};
+
+		if (vkCreateImageView(device, &info, nullptr, &texture.view) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan texture image view\n";
+			vkDestroyImage(device, texture.image, nullptr);
+			freeMemory(texture.memory);
+			return no_texture;
+		}
+	}
+
+	textures_.push_back(texture);
+
+	return addTexture(texture.view);
+}
@@ -0,0 +1,530 @@
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <imgui.h>
+
+#include <veekay/veekay.hpp>
+#include <veekay/memory.hpp>
+
+namespace {
+
+constexpr uint32_t category_count = static_cast<uint32_t>(veekay::MemoryCategory::count);
+
+// NOTE: Buffers waiting for frames in flight to retire, frames_left
+//       counts fence waits still needed. Only frames of the owning
+//       context count, each has its own frames in flight
+struct DeferredBuffer {
+	veekay::Buffer buffer;
+	uint32_t frames_left;
+	const veekay::Application* owner;
+};
+
+std::mutex deferred_mutex;
+std::vector<DeferredBuffer> deferred_buffers;
+
+void addUsage(veekay::MemoryUsage& usage, VkDeviceSize size) {
+	usage.current += size;
+	usage.allocations += 1;
+
+	if (usage.current > usage.peak) {
+		usage.peak = usage.current;
+	}
+}
+
+void removeUsage(veekay::MemoryUsage& usage, VkDeviceSize size) {
+	usage.current -= size;
+	usage.allocations -= 1;
+}
+
+veekay::MemoryCategory categorize(VkBufferUsageFlags usage) {
+	if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+		return veekay::MemoryCategory::vertex;
+	}
+
+	if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+		return veekay::MemoryCategory::index;
+	}
+
+	if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+		return veekay::MemoryCategory::uniform;
+	}
+
+	if (usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+		return veekay::MemoryCategory::indirect;
+	}
+
+	if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+		return veekay::MemoryCategory::storage;
+	}
+
+	if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+		return veekay::MemoryCategory::staging;
+	}
+
+	if (usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) {
+		return veekay::MemoryCategory::readback;
+	}
+
+	return veekay::MemoryCategory::storage;
+}
+
+} // namespace
+
+const char* veekay::memoryCategoryName(MemoryCategory category) {
+	switch (category) {
+	case MemoryCategory::vertex: return "Vertex";
+	case MemoryCategory::index: return "Index";
+	case MemoryCategory::uniform: return "Uniform";
+	case MemoryCategory::storage: return "Storage";
+	case MemoryCategory::indirect: return "Indirect";
+	case MemoryCategory::image: return "Image";
+	case MemoryCategory::staging: return "Staging";
+	case MemoryCategory::readback: return "Readback";
+	case MemoryCategory::count: break;
+	}
+
+	return "Unknown";
+}
+
+void veekay::MemoryTracker::initialize(VkPhysicalDevice physical_device, VkDevice device,
+                                       bool budget_extension, VkDeviceSize budget,
+                                       MemoryBudgetPolicy policy) {
+	{
+		std::lock_guard lock(mutex_);
+
+		physical_device_ = physical_device;
+		device_ = device;
+
+		vkGetPhysicalDeviceMemoryProperties(physical_device_, &properties_);
+
+		budget_extension_ = budget_extension;
+		budget_ = budget;
+		budget_policy_ = policy;
+		budget_warned_ = false;
+
+		for (MemoryUsage& usage : category_usage_) {
+			usage = {};
+		}
+
+		total_usage_ = {};
+		allocations_.clear();
+
+		for (uint32_t i = 0; i < properties_.memoryHeapCount; ++i) {
+			heap_warned_[i] = false;
+
+			const VkMemoryHeap& heap = properties_.memoryHeaps[i];
+
+			heap_usage_[i] = HeapUsage{
+				.size = heap.size,
+				.device_local = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+				.budget = heap.size,
+			};
+		}
+	}
+
+	updateBudget();
+}
+
+void veekay::MemoryTracker::updateBudget() {
+	if (!budget_extension_) {
+		return;
+	}
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+	};
+
+	VkPhysicalDeviceMemoryProperties2 properties_2{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+		.pNext = &budget_properties,
+	};
+
+	vkGetPhysicalDeviceMemoryProperties2(physical_device_, &properties_2);
+
+	std::lock_guard lock(mutex_);
+
+	for (uint32_t i = 0; i < properties_.memoryHeapCount; ++i) {
+		heap_usage_[i].budget = budget_properties.heapBudget[i];
+		heap_usage_[i].process_usage = budget_properties.heapUsage[i];
+	}
+}
+
+uint32_t veekay::MemoryTracker::findType(uint32_t type_bits, VkMemoryPropertyFlags flags) const {
+	for (uint32_t i = 0; i < properties_.memoryTypeCount; ++i) {
+		const VkMemoryType& type = properties_.memoryTypes[i];
+
+		if ((type_bits & (1 << i)) && (type.propertyFlags & flags) == flags) {
+			return i;
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+VkDeviceMemory veekay::MemoryTracker::allocate(const VkMemoryRequirements& requirements,
+                                               VkMemoryPropertyFlags flags, MemoryCategory category,
+                                               VkMemoryPropertyFlags preferred) {
+	uint32_t index = UINT32_MAX;
+	if (preferred) {
+		index = findType(requirements.memoryTypeBits, flags | preferred);
+	}
+
+	if (index == UINT32_MAX) {
+		index = findType(requirements.memoryTypeBits, flags);
+	}
+
+	if (index == UINT32_MAX) {
+		std::cerr << "Failed to find required memory type for "
+		          << memoryCategoryName(category) << " allocation\n";
+		return VK_NULL_HANDLE;
+	}
+
+	const uint32_t heap = properties_.memoryTypes[index].heapIndex;
+
+	{
+		std::lock_guard lock(mutex_);
+
+		if (!checkBudget(requirements.size, heap)) {
+			return VK_NULL_HANDLE;
+		}
+	}
+
+	VkMemoryAllocateInfo info{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize = requirements.size,
+		.memoryTypeIndex = index,
+	};
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(device_, &info, nullptr, &memory) != VK_SUCCESS) {
+		std::cerr << "Failed to allocate " << requirements.size << " bytes of "
+		          << memoryCategoryName(category) << " memory\n";
+		return VK_NULL_HANDLE;
+	}
+
+	{
+		std::lock_guard lock(mutex_);
+
+		allocations_[memory] = Allocation{requirements.size, heap, category};
+
+		addUsage(category_usage_[static_cast<uint32_t>(category)], requirements.size);
+		addUsage(heap_usage_[heap].tracked, requirements.size);
+		addUsage(total_usage_, requirements.size);
+	}
+
+	return memory;
+}
+
+void veekay::MemoryTracker::free(VkDeviceMemory memory) {
+	if (memory == VK_NULL_HANDLE) {
+		return;
+	}
+
+	{
+		std::lock_guard lock(mutex_);
+
+		auto it = allocations_.find(memory);
+		if (it != allocations_.end()) {
+			const Allocation& allocation = it->second;
+
+			removeUsage(category_usage_[static_cast<uint32_t>(allocation.category)], allocation.size);
+			removeUsage(heap_usage_[allocation.heap].tracked, allocation.size);
+			removeUsage(total_usage_, allocation.size);
+
+			allocations_.erase(it);
+		}
+	}
+
+	vkFreeMemory(device_, memory, nullptr);
+}
+
+veekay::MemoryUsage veekay::MemoryTracker::usage(MemoryCategory category) {
+	std::lock_guard lock(mutex_);
+	return category_usage_[static_cast<uint32_t>(category)];
+}
+
+veekay::MemoryUsage veekay::MemoryTracker::usageTotal() {
+	std::lock_guard lock(mutex_);
+	return total_usage_;
+}
+
+veekay::HeapUsage veekay::MemoryTracker::heapUsage(uint32_t heap) {
+	std::lock_guard lock(mutex_);
+	return heap_usage_[heap];
+}
+
+bool veekay::MemoryTracker::checkBudget(VkDeviceSize size, uint32_t heap) {
+	const HeapUsage& usage = heap_usage_[heap];
+
+	if (usage.tracked.current + size <= usage.budget) {
+		heap_warned_[heap] = false;
+	} else if (budget_policy_ == MemoryBudgetPolicy::fail) {
+		std::cerr << "Allocation of " << size << " bytes exceeds budget of memory heap "
+		          << heap << '\n';
+		return false;
+	} else if (!heap_warned_[heap]) {
+		std::cerr << "Budget of memory heap " << heap << " exceeded\n";
+		heap_warned_[heap] = true;
+	}
+
+	if (budget_ == 0 || total_usage_.current + size <= budget_) {
+		budget_warned_ = false;
+		return true;
+	}
+
+	if (budget_policy_ == MemoryBudgetPolicy::fail) {
+		std::cerr << "Allocation of " << size << " bytes exceeds memory budget of "
+		          << budget_ << " bytes\n";
+		return false;
+	}
+
+	// NOTE: Warn once each time budget gets crossed, not on every allocation
+	if (!budget_warned_) {
+		std::cerr << "Memory budget of " << budget_ << " bytes exceeded\n";
+		budget_warned_ = true;
+	}
+
+	return true;
+}
+
+void veekay::updateMemoryBudget() {
+	veekay::app->memory->updateBudget();
+}
+
+uint32_t veekay::findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags flags) {
+	return veekay::app->memory->findType(type_bits, flags);
+}
+
+VkDeviceMemory veekay::allocateMemory(const VkMemoryRequirements& requirements,
+                                      VkMemoryPropertyFlags flags, MemoryCategory category,
+                                      VkMemoryPropertyFlags preferred) {
+	return veekay::app->memory->allocate(requirements, flags, category, preferred);
+}
+
+void veekay::freeMemory(VkDeviceMemory memory) {
+	veekay::app->memory->free(memory);
+}
+
+veekay::MemoryUsage veekay::memoryUsage(MemoryCategory category) {
+	return veekay::app->memory->usage(category);
+}
+
+veekay::MemoryUsage veekay::memoryUsageTotal() {
+	return veekay::app->memory->usageTotal();
+}
+
+uint32_t veekay::memoryHeapCount() {
+	return veekay::app->memory->heapCount();
+}
+
+veekay::HeapUsage veekay::memoryHeapUsage(uint32_t heap) {
+	return veekay::app->memory->heapUsage(heap);
+}
+
+void veekay::showMemoryWindow(bool* open) {
+	constexpr double mib = 1024.0 * 1024.0;
+
+	MemoryTracker& tracker = *veekay::app->memory;
+	tracker.updateBudget();
+
+	const VkDeviceSize budget = tracker.budget();
+
+	if (!ImGui::Begin("GPU Memory", open)) {
+		ImGui::End();
+		return;
+	}
+
+	const MemoryUsage total = memoryUsageTotal();
+
+	ImGui::Text("Total: %.2f MiB, peak %.2f MiB, %u allocations",
+	            total.current / mib, total.peak / mib, total.allocations);
+
+	if (budget != 0) {
+		ImGui::ProgressBar(float(double(total.current) / double(budget)), ImVec2(-1.0f, 0.0f));
+		ImGui::Text("Budget: %.2f MiB (%s)", budget / mib,
+		            (tracker.budgetPolicy() == MemoryBudgetPolicy::fail) ? "fail" : "warn");
+	}
+
+	if (ImGui::BeginTable("categories", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Category");
+		ImGui::TableSetupColumn("Current, MiB");
+		ImGui::TableSetupColumn("Peak, MiB");
+		ImGui::TableSetupColumn("Count");
+		ImGui::TableHeadersRow();
+
+		for (uint32_t i = 0; i < category_count; ++i) {
+			const MemoryCategory category = static_cast<MemoryCategory>(i);
+			const MemoryUsage usage = memoryUsage(category);
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(memoryCategoryName(category));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", usage.current / mib);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", usage.peak / mib);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", usage.allocations);
+		}
+
+		ImGui::EndTable();
+	}
+
+	for (uint32_t i = 0; i < memoryHeapCount(); ++i) {
+		const HeapUsage heap = memoryHeapUsage(i);
+
+		ImGui::Separator();
+		ImGui::Text("Heap %u (%s): %.0f MiB", i, heap.device_local ? "device local" : "host",
+		            heap.size / mib);
+		ImGui::Text("Tracked: %.2f MiB, peak %.2f MiB", heap.tracked.current / mib,
+		            heap.tracked.peak / mib);
+
+		if (tracker.budgetExtension()) {
+			ImGui::Text("Process: %.2f MiB of %.2f MiB budget", heap.process_usage / mib,
+			            heap.budget / mib);
+			ImGui::ProgressBar(float(double(heap.process_usage) / double(heap.budget)),
+			                   ImVec2(-1.0f, 0.0f));
+		}
+	}
+
+	ImGui::End();
+}
+
+veekay::Buffer veekay::createBuffer(VkDeviceSize size, const void* data, VkBufferUsageFlags usage,
+                                    VkMemoryPropertyFlags preferred) {
+	VkDevice device = veekay::app->vk_device;
+
+	Buffer result{};
+
+	{
+		VkBufferCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = size,
+			.usage = usage,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		};
+
+		if (vkCreateBuffer(device, &info, nullptr, &result.buffer) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan buffer\n";
+			return {};
+		}
+	}
+
+	{
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(device, result.buffer, &requirements);
+
+		const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+		                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		result.memory = allocateMemory(requirements, flags, categorize(usage), preferred);
+		if (!result.memory) {
+			vkDestroyBuffer(device, result.buffer, nullptr);
+			return {};
+		}
+
+		if (vkBindBufferMemory(device, result.buffer, result.memory, 0) != VK_SUCCESS) {
+			std::cerr << "Failed to bind Vulkan buffer memory\n";
+			destroyBuffer(result);
+			return {};
+		}
+
+		if (vkMapMemory(device, result.memory, 0, VK_WHOLE_SIZE, 0, &result.mapped) != VK_SUCCESS) {
+			std::cerr << "Failed to map Vulkan buffer memory\n";
+			destroyBuffer(result);
+			return {};
+		}
+	}
+
+	result.size = size;
+
+	if (data) {
+		memcpy(result.mapped, data, size);
+	}
+
+	return result;
+}
+
+void veekay::destroyBufferDeferred(const Buffer& buffer) {
+	if (!buffer.buffer) {
+		return;
+	}
+
+	std::lock_guard lock(deferred_mutex);
+	deferred_buffers.push_back({buffer, veekay::app->frames_in_flight, veekay::app});
+}
+
+void veekay::collectDeferredBuffers(bool all) {
+	std::vector<Buffer> retired;
+
+	{
+		std::lock_guard lock(deferred_mutex);
+
+		size_t kept = 0;
+		for (DeferredBuffer& deferred : deferred_buffers) {
+			if (deferred.owner == veekay::app && (all || --deferred.frames_left == 0)) {
+				retired.push_back(deferred.buffer);
+			} else {
+				deferred_buffers[kept++] = deferred;
+			}
+		}
+
+		deferred_buffers.resize(kept);
+	}
+
+	for (const Buffer& buffer : retired) {
+		destroyBuffer(buffer);
+	}
+}
+
+veekay::Buffer veekay::createDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage) {
+	VkDevice device = veekay::app->vk_device;
+
+	Buffer result{};
+
+	{
+		VkBufferCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = size,
+			.usage = usage,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		};
+
+		if (vkCreateBuffer(device, &info, nullptr, &result.buffer) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan buffer\n";
+			return {};
+		}
+	}
+
+	{
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(device, result.buffer, &requirements);
+
+		result.memory = allocateMemory(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                               categorize(usage));
+		if (!result.memory) {
+			vkDestroyBuffer(device, result.buffer, nullptr);
+			return {};
+		}
+
+		if (vkBindBufferMemory(device, result.buffer, result.memory, 0) != VK_SUCCESS) {
+			std::cerr << "Failed to bind Vulkan buffer memory\n";
+			destroyBuffer(result);
+			return {};
+		}
+	}
+
+	result.size = size;
+
+	return result;
+}
+
+void veekay::destroyBuffer(const Buffer& buffer) {
+	VkDevice device = veekay::app->vk_device;
+
+	freeMemory(buffer.memory);
+	vkDestroyBuffer(device, buffer.buffer, nullptr);
+}
@@ -0,0 +1,264 @@
+#include <cstring>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/meshlet_renderer.hpp>
+#include <veekay/descriptors.hpp>
+#include <veekay/profiler.hpp>
+
+namespace {
+
+constexpr uint32_t group_size = 64;
+
+// NOTE: Meshlets, meshlet vertices, meshlet triangles, mesh vertices,
+//       instances, visible list, draws, mesh tasks command
+constexpr uint32_t binding_count = 8;
+
+} // namespace
+
+bool veekay::MeshletRenderer::initialize(VkShaderModule cull_shader, const geometry::MeshletData& data,
+                                         const MeshRange& mesh, VkBuffer vertex_buffer) {
+	device_ = veekay::app->vk_device;
+	vertex_buffer_ = vertex_buffer;
+	set_ = VK_NULL_HANDLE;
+
+	meshlet_count_ = static_cast<uint32_t>(data.meshlets.size());
+	mesh_ = mesh;
+	constants_ = {};
+
+	if (meshlet_count_ == 0) {
+		std::cerr << "Mesh has no meshlets\n";
+		return false;
+	}
+
+	draw_indexed_indirect_count_ = nullptr;
+	if (veekay::app->draw_indirect_count) {
+		draw_indexed_indirect_count_ = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(
+			vkGetDeviceProcAddr(device_, "vkCmdDrawIndexedIndirectCountKHR"));
+	}
+
+	draw_mesh_tasks_indirect_ = nullptr;
+	if (veekay::app->mesh_shader) {
+		draw_mesh_tasks_indirect_ = reinterpret_cast<PFN_vkCmdDrawMeshTasksIndirectEXT>(
+			vkGetDeviceProcAddr(device_, "vkCmdDrawMeshTasksIndirectEXT"));
+	}
+
+	{
+		VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT;
+		if (veekay::app->mesh_shader) {
+			stages |= VK_SHADER_STAGE_MESH_BIT_EXT;
+		}
+
+		DescriptorLayoutDescription description{.binding_count = binding_count};
+		for (uint32_t i = 0; i < binding_count; ++i) {
+			description.bindings[i] = {
+				.binding = i,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = stages,
+			};
+		}
+
+		set_layout_ = veekay::app->descriptors->layout(description);
+		if (!set_layout_) {
+			return false;
+		}
+	}
+
+	{
+		VkPushConstantRange push_constants{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.size = sizeof(MeshletConstants),
+		};
+
+		VkPipelineLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &set_layout_,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &push_constants,
+		};
+
+		if (vkCreatePipelineLayout(device_, &info, nullptr, &cull_layout_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan pipeline layout for meshlet culling\n";
+			return false;
+		}
+	}
+
+	{
+		VkComputePipelineCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = cull_shader,
+				.pName = "main",
+			},
+			.layout = cull_layout_,
+		};
+
+		if (vkCreateComputePipelines(device_, VK_NULL_HANDLE, 1, &info, nullptr, &cull_pipeline_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan compute pipeline for meshlet culling\n";
+			return false;
+		}
+	}
+
+	{
+		const std::vector<uint32_t> indices = geometry::meshletIndices(data);
+
+		meshlets_ = createBuffer(data.meshlets.size() * sizeof(geometry::Meshlet), data.meshlets.data(),
+		                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		meshlet_vertices_ = createBuffer(data.vertices.size() * sizeof(uint32_t), data.vertices.data(),
+		                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		meshlet_triangles_ = createBuffer(data.triangles.size(), data.triangles.data(),
+		                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		index_buffer_ = createBuffer(indices.size() * sizeof(uint32_t), indices.data(),
+		                             VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+		visible_ = createBuffer(VkDeviceSize(meshlet_count_) * sizeof(uint32_t), nullptr,
+		                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		draws_ = createBuffer(VkDeviceSize(meshlet_count_) * sizeof(VkDrawIndexedIndirectCommand), nullptr,
+		                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+		// NOTE: Only x is counted on GPU, y and z stay one
+		const VkDrawMeshTasksIndirectCommandEXT tasks{
+			.groupCountX = 0,
+			.groupCountY = 1,
+			.groupCountZ = 1,
+		};
+
+		tasks_ = createBuffer(sizeof(tasks), &tasks,
+		                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+		                      VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+		if (!meshlets_.buffer || !meshlet_vertices_.buffer || !meshlet_triangles_.buffer ||
+		    !index_buffer_.buffer || !visible_.buffer || !draws_.buffer || !tasks_.buffer) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void veekay::MeshletRenderer::destroy() {
+	destroyBuffer(tasks_);
+	destroyBuffer(draws_);
+	destroyBuffer(visible_);
+	destroyBuffer(index_buffer_);
+	destroyBuffer(meshlet_triangles_);
+	destroyBuffer(meshlet_vertices_);
+	destroyBuffer(meshlets_);
+
+	vkDestroyPipeline(device_, cull_pipeline_, nullptr);
+	vkDestroyPipelineLayout(device_, cull_layout_, nullptr);
+}
+
+bool veekay::MeshletRenderer::cull(VkCommandBuffer cmd, VkBuffer instances, uint32_t instance,
+                                   const float view_projection[16], const float camera[4]) {
+	VEEKAY_PROFILE_FUNCTION();
+
+	{
+		const VkBuffer buffers[binding_count] = {
+			meshlets_.buffer,
+			meshlet_vertices_.buffer,
+			meshlet_triangles_.buffer,
+			vertex_buffer_,
+			instances,
+			visible_.buffer,
+			draws_.buffer,
+			tasks_.buffer,
+		};
+
+		set_ = veekay::app->descriptors->allocateStorageBuffers(set_layout_, buffers, binding_count);
+		if (!set_) {
+			std::cerr << "Failed to allocate descriptor set for meshlet culling\n";
+			return false;
+		}
+	}
+
+	{ // NOTE: Earlier draws are done with the lists before rewrite
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		};
+
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		if (draw_mesh_tasks_indirect_) {
+			stages |= VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT;
+		}
+
+		vkCmdPipelineBarrier(cmd, stages,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	vkCmdFillBuffer(cmd, tasks_.buffer, 0, sizeof(uint32_t), 0);
+
+	{
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	memcpy(constants_.view_projection, view_projection, sizeof(constants_.view_projection));
+	memcpy(constants_.camera, camera, sizeof(constants_.camera));
+	constants_.instance = instance;
+	constants_.meshlet_count = meshlet_count_;
+	constants_.vertex_base = mesh_.vertex_offset;
+	constants_.compact = compacting() ? 1 : 0;
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_layout_,
+	                        0, 1, &set_, 0, nullptr);
+	vkCmdPushConstants(cmd, cull_layout_, VK_SHADER_STAGE_COMPUTE_BIT,
+	                   0, sizeof(constants_), &constants_);
+	vkCmdDispatch(cmd, (meshlet_count_ + group_size - 1) / group_size, 1, 1);
+
+	{
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+		};
+
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		if (draw_mesh_tasks_indirect_) {
+			stages |= VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT;
+		}
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, stages,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	return true;
+}
+
+void veekay::MeshletRenderer::draw(VkCommandBuffer cmd) const {
+	vkCmdBindIndexBuffer(cmd, index_buffer_.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+	if (draw_indexed_indirect_count_) {
+		draw_indexed_indirect_count_(cmd, draws_.buffer, 0, tasks_.buffer, 0,
+		                             meshlet_count_, sizeof(VkDrawIndexedIndirectCommand));
+	} else {
+		vkCmdDrawIndexedIndirect(cmd, draws_.buffer, 0, meshlet_count_,
+		                         sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
+
+void veekay::MeshletRenderer::drawMeshTasks(VkCommandBuffer cmd, VkPipelineLayout layout) const {
+	if (!draw_mesh_tasks_indirect_ || !set_) {
+		return;
+	}
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+	                        1, 1, &set_, 0, nullptr);
+	vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_MESH_BIT_EXT,
+	                   0, sizeof(constants_), &constants_);
+	draw_mesh_tasks_indirect_(cmd, tasks_.buffer, 0, 1, sizeof(VkDrawMeshTasksIndirectCommandEXT));
+}
@@ -0,0 +1,776 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/occlusion.hpp>
+#include <veekay/profiler.hpp>
+
+namespace {
+
+constexpr uint32_t cull_group_size = 64;
+constexpr uint32_t pyramid_group_size = 8;
+
+// NOTE: Mirror push constants of pyramid.comp and cull.comp
+struct PyramidConstants {
+	int32_t source_width;
+	int32_t source_height;
+};
+
+struct CullConstants {
+	float view_projection[16];
+	uint32_t instance_count;
+	uint32_t phase;
+	uint32_t occlusion;
+	uint32_t draw_base;
+	float depth_width;
+	float depth_height;
+	uint32_t pyramid_levels;
+	uint32_t compact;
+};
+
+VkPipeline createComputePipeline(VkDevice device, VkShaderModule shader, VkPipelineLayout layout) {
+	VkComputePipelineCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.stage = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = shader,
+			.pName = "main",
+		},
+		.layout = layout,
+	};
+
+	VkPipeline pipeline;
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
+		return VK_NULL_HANDLE;
+	}
+
+	return pipeline;
+}
+
+bool hasStencil(VkFormat format) {
+	return format == VK_FORMAT_D16_UNORM_S8_UINT ||
+	       format == VK_FORMAT_D24_UNORM_S8_UINT ||
+	       format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+} // namespace
+
+bool veekay::OcclusionCuller::initialize(VkShaderModule pyramid_shader, VkShaderModule cull_shader,
+                                         uint32_t max_instances, uint32_t max_meshes) {
+	device_ = veekay::app->vk_device;
+	const uint32_t frames = veekay::app->frames_in_flight;
+
+	max_instances_ = max_instances;
+	max_meshes_ = max_meshes;
+
+	pyramid_valid_ = false;
+	pyramid_ready_ = false;
+	visibility_ready_ = false;
+	draw_counts_[0] = draw_counts_[1] = 0;
+
+	if (!veekay::app->vk_depth_image) {
+		std::cerr << "Occlusion culling needs ApplicationConfig::depth_sampled\n";
+		return false;
+	}
+
+	draw_indexed_indirect_count_ = nullptr;
+	if (veekay::app->draw_indirect_count) {
+		draw_indexed_indirect_count_ = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(
+			vkGetDeviceProcAddr(device_, "vkCmdDrawIndexedIndirectCountKHR"));
+	}
+
+	{ // NOTE: Shaders only use texelFetch, sampler is there for the binding
+		VkSamplerCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+			.magFilter = VK_FILTER_NEAREST,
+			.minFilter = VK_FILTER_NEAREST,
+			.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+			.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.maxLod = VK_LOD_CLAMP_NONE,
+		};
+
+		if (vkCreateSampler(device_, &info, nullptr, &sampler_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan sampler for depth pyramid\n";
+			return false;
+		}
+	}
+
+	{ // NOTE: Reads previous level (or depth), writes the next one
+		VkDescriptorSetLayoutBinding bindings[] = {
+			{
+				.binding = 0,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			{
+				.binding = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+		};
+
+		VkDescriptorSetLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = 2,
+			.pBindings = bindings,
+		};
+
+		if (vkCreateDescriptorSetLayout(device_, &info, nullptr, &pyramid_set_layout_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan descriptor set layout for depth pyramid\n";
+			return false;
+		}
+	}
+
+	{ // NOTE: Instances, instance meshes, meshes, draws, counts, visibility
+		//       and pyramid
+		VkDescriptorSetLayoutBinding bindings[7];
+		for (uint32_t i = 0; i < 7; ++i) {
+			bindings[i] = {
+				.binding = i,
+				.descriptorType = (i == 6) ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER :
+				                             VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			};
+		}
+
+		VkDescriptorSetLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = 7,
+			.pBindings = bindings,
+		};
+
+		if (vkCreateDescriptorSetLayout(device_, &info, nullptr, &cull_set_layout_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan descriptor set layout for culling\n";
+			return false;
+		}
+	}
+
+	{
+		VkPushConstantRange push_constants{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.size = sizeof(PyramidConstants),
+		};
+
+		VkPipelineLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &pyramid_set_layout_,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &push_constants,
+		};
+
+		if (vkCreatePipelineLayout(device_, &info, nullptr, &pyramid_layout_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan pipeline layout for depth pyramid\n";
+			return false;
+		}
+	}
+
+	{
+		VkPushConstantRange push_constants{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.size = sizeof(CullConstants),
+		};
+
+		VkPipelineLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &cull_set_layout_,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &push_constants,
+		};
+
+		if (vkCreatePipelineLayout(device_, &info, nullptr, &cull_layout_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan pipeline layout for culling\n";
+			return false;
+		}
+	}
+
+	pyramid_pipeline_ = createComputePipeline(device_, pyramid_shader, pyramid_layout_);
+	cull_pipeline_ = createComputePipeline(device_, cull_shader, cull_layout_);
+	if (!pyramid_pipeline_ || !cull_pipeline_) {
+		std::cerr << "Failed to create Vulkan compute pipelines for culling\n";
+		return false;
+	}
+
+	{ // NOTE: Pyramid covers depth exactly, every texel of mip i holds
+		//       farthest depth of 2x2 texels of mip i - 1
+		pyramid_width_ = (veekay::app->window_width + 1) / 2;
+		pyramid_height_ = (veekay::app->window_height + 1) / 2;
+		pyramid_levels_ = 1;
+
+		for (uint32_t w = pyramid_width_, h = pyramid_height_;
+		     (w > 1 || h > 1) && pyramid_levels_ < max_pyramid_levels; ++pyramid_levels_) {
+			w = (w + 1) / 2;
+			h = (h + 1) / 2;
+		}
+
+		VkImageCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = VK_FORMAT_R32_SFLOAT,
+			.extent = {pyramid_width_, pyramid_height_, 1},
+			.mipLevels = pyramid_levels_,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+
+		if (vkCreateImage(device_, &info, nullptr, &pyramid_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan image for depth pyramid\n";
+			return false;
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device_, pyramid_, &requirements);
+
+		pyramid_memory_ = allocateMemory(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                 MemoryCategory::image);
+		if (!pyramid_memory_ || vkBindImageMemory(device_, pyramid_, pyramid_memory_, 0) != VK_SUCCESS) {
+			std::cerr << "Failed to allocate memory for depth pyramid\n";
+			return false;
+		}
+	}
+
+	{
+		VkImageViewCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = pyramid_,
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = VK_FORMAT_R32_SFLOAT,
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = pyramid_levels_,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		};
+
+		if (vkCreateImageView(device_, &info, nullptr, &pyramid_view_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan image view for depth pyramid\n";
+			return false;
+		}
+
+		info.subresourceRange.levelCount = 1;
+
+		for (uint32_t i = 0; i < pyramid_levels_; ++i) {
+			info.subresourceRange.baseMipLevel = i;
+
+			if (vkCreateImageView(device_, &info, nullptr, &level_views_[i]) != VK_SUCCESS) {
+				std::cerr << "Failed to create Vulkan image view for depth pyramid level\n";
+				return false;
+			}
+		}
+
+		info.image = veekay::app->vk_depth_image;
+		info.format = veekay::app->vk_depth_format;
+		info.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		};
+
+		if (vkCreateImageView(device_, &info, nullptr, &depth_view_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan image view for sampled depth\n";
+			return false;
+		}
+	}
+
+	{
+		meshes_ = createBuffer(VkDeviceSize(max_meshes) * sizeof(GpuMesh), nullptr,
+		                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		instance_meshes_ = createBuffer(VkDeviceSize(max_instances) * sizeof(uint32_t), nullptr,
+		                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		visibility_ = createBuffer(VkDeviceSize(max_instances) * sizeof(uint32_t), nullptr,
+		                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		draws_ = createBuffer(2 * VkDeviceSize(max_instances) * sizeof(VkDrawIndexedIndirectCommand), nullptr,
+		                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+		counts_ = createBuffer(2 * sizeof(uint32_t), nullptr,
+		                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+		                       VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+		if (!meshes_.buffer || !instance_meshes_.buffer || !visibility_.buffer ||
+		    !draws_.buffer || !counts_.buffer) {
+			return false;
+		}
+
+		memset(meshes_.mapped, 0, size_t(max_meshes) * sizeof(GpuMesh));
+		memset(instance_meshes_.mapped, 0, size_t(max_instances) * sizeof(uint32_t));
+	}
+
+	{
+		VkDescriptorPoolSize sizes[] = {
+			{
+				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = pyramid_levels_ + frames,
+			},
+			{
+				.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.descriptorCount = pyramid_levels_,
+			},
+			{
+				.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 6 * frames,
+			},
+		};
+
+		VkDescriptorPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.maxSets = pyramid_levels_ + frames,
+			.poolSizeCount = 3,
+			.pPoolSizes = sizes,
+		};
+
+		if (vkCreateDescriptorPool(device_, &info, nullptr, &pool_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan descriptor pool for culling\n";
+			return false;
+		}
+	}
+
+	{
+		std::vector<VkDescriptorSetLayout> layouts(pyramid_levels_, pyramid_set_layout_);
+		pyramid_sets_.resize(pyramid_levels_);
+
+		VkDescriptorSetAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.descriptorPool = pool_,
+			.descriptorSetCount = pyramid_levels_,
+			.pSetLayouts = layouts.data(),
+		};
+
+		if (vkAllocateDescriptorSets(device_, &info, pyramid_sets_.data()) != VK_SUCCESS) {
+			std::cerr << "Failed to allocate Vulkan descriptor sets for depth pyramid\n";
+			return false;
+		}
+
+		for (uint32_t i = 0; i < pyramid_levels_; ++i) {
+			VkDescriptorImageInfo source{
+				.sampler = sampler_,
+				.imageView = (i == 0) ? depth_view_ : level_views_[i - 1],
+				.imageLayout = (i == 0) ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL :
+				                          VK_IMAGE_LAYOUT_GENERAL,
+			};
+
+			VkDescriptorImageInfo destination{
+				.imageView = level_views_[i],
+				.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+			};
+
+			VkWriteDescriptorSet writes[] = {
+				{
+					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.dstSet = pyramid_sets_[i],
+					.dstBinding = 0,
+					.descriptorCount = 1,
+					.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					.pImageInfo = &source,
+				},
+				{
+					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.dstSet = pyramid_sets_[i],
+					.dstBinding = 1,
+					.descriptorCount = 1,
+					.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+					.pImageInfo = &destination,
+				},
+			};
+
+			vkUpdateDescriptorSets(device_, 2, writes, 0, nullptr);
+		}
+	}
+
+	{ // NOTE: Instance buffer (binding 0) is written by cull(), it differs
+		//       from frame to frame
+		std::vector<VkDescriptorSetLayout> layouts(frames, cull_set_layout_);
+		cull_sets_.resize(frames);
+		cull_instances_.assign(frames, VK_NULL_HANDLE);
+
+		VkDescriptorSetAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.descriptorPool = pool_,
+			.descriptorSetCount = frames,
+			.pSetLayouts = layouts.data(),
+		};
+
+		if (vkAllocateDescriptorSets(device_, &info, cull_sets_.data()) != VK_SUCCESS) {
+			std::cerr << "Failed to allocate Vulkan descriptor sets for culling\n";
+			return false;
+		}
+
+		const VkBuffer buffers[] = {
+			instance_meshes_.buffer,
+			meshes_.buffer,
+			draws_.buffer,
+			counts_.buffer,
+			visibility_.buffer,
+		};
+
+		VkDescriptorBufferInfo buffer_infos[5];
+		for (uint32_t i = 0; i < 5; ++i) {
+			buffer_infos[i] = {
+				.buffer = buffers[i],
+				.offset = 0,
+				.range = VK_WHOLE_SIZE,
+			};
+		}
+
+		VkDescriptorImageInfo pyramid_info{
+			.sampler = sampler_,
+			.imageView = pyramid_view_,
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+		for (uint32_t frame = 0; frame < frames; ++frame) {
+			VkWriteDescriptorSet writes[] = {
+				{
+					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.dstSet = cull_sets_[frame],
+					.dstBinding = 1,
+					.descriptorCount = 5,
+					.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					.pBufferInfo = buffer_infos,
+				},
+				{
+					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.dstSet = cull_sets_[frame],
+					.dstBinding = 6,
+					.descriptorCount = 1,
+					.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					.pImageInfo = &pyramid_info,
+				},
+			};
+
+			vkUpdateDescriptorSets(device_, 2, writes, 0, nullptr);
+		}
+	}
+
+	return true;
+}
+
+void veekay::OcclusionCuller::destroy() {
+	destroyBuffer(counts_);
+	destroyBuffer(draws_);
+	destroyBuffer(visibility_);
+	destroyBuffer(instance_meshes_);
+	destroyBuffer(meshes_);
+
+	vkDestroyDescriptorPool(device_, pool_, nullptr);
+	pyramid_sets_.clear();
+	cull_sets_.clear();
+
+	vkDestroyImageView(device_, depth_view_, nullptr);
+	for (uint32_t i = 0; i < pyramid_levels_; ++i) {
+		vkDestroyImageView(device_, level_views_[i], nullptr);
+	}
+	vkDestroyImageView(device_, pyramid_view_, nullptr);
+	vkDestroyImage(device_, pyramid_, nullptr);
+	freeMemory(pyramid_memory_);
+
+	vkDestroyPipeline(device_, cull_pipeline_, nullptr);
+	vkDestroyPipeline(device_, pyramid_pipeline_, nullptr);
+	vkDestroyPipelineLayout(device_, cull_layout_, nullptr);
+	vkDestroyPipelineLayout(device_, pyramid_layout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_, cull_set_layout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_, pyramid_set_layout_, nullptr);
+	vkDestroySampler(device_, sampler_, nullptr);
+}
+
+void veekay::OcclusionCuller::setMesh(uint32_t mesh, const MeshRange& range,
+                                      const float center[3], float radius) {
+	if (mesh >= max_meshes_) {
+		std::cerr << "Mesh " << mesh << " is out of culling mesh table\n";
+		return;
+	}
+
+	static_cast<GpuMesh*>(meshes_.mapped)[mesh] = GpuMesh{
+		.sphere = {center[0], center[1], center[2], radius},
+		.index_count = range.index_count,
+		.first_index = range.first_index,
+		.vertex_offset = range.vertex_offset,
+	};
+}
+
+void veekay::OcclusionCuller::setInstanceMesh(uint32_t instance, uint32_t mesh) {
+	if (instance >= max_instances_) {
+		std::cerr << "Instance " << instance << " is out of culling range\n";
+		return;
+	}
+
+	static_cast<uint32_t*>(instance_meshes_.mapped)[instance] = mesh;
+}
+
+void veekay::OcclusionCuller::cull(VkCommandBuffer cmd, CullPhase phase, VkBuffer instances,
+                                   uint32_t instance_count, const float view_projection[16]) {
+	VEEKAY_PROFILE_FUNCTION();
+
+	const uint32_t frame = veekay::app->frame_index;
+	const uint32_t slot = (phase == CullPhase::late) ? 1 : 0;
+
+	instance_count = std::min(instance_count, max_instances_);
+	draw_counts_[slot] = instance_count;
+
+	if (cull_instances_[frame] != instances) {
+		VkDescriptorBufferInfo info{
+			.buffer = instances,
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkWriteDescriptorSet write{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = cull_sets_[frame],
+			.dstBinding = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo = &info,
+		};
+
+		vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+		cull_instances_[frame] = instances;
+	}
+
+	{ // NOTE: Earlier draws and culls are done with buffers before rewrite
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT |
+			                 VK_ACCESS_SHADER_WRITE_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	if (!pyramid_ready_) { // NOTE: Pyramid is bound even before it's built
+		VkImageMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.newLayout = VK_IMAGE_LAYOUT_GENERAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = pyramid_,
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = pyramid_levels_,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+		pyramid_ready_ = true;
+	}
+
+	if (!visibility_ready_) {
+		vkCmdFillBuffer(cmd, visibility_.buffer, 0, VK_WHOLE_SIZE, 0);
+		visibility_ready_ = true;
+	}
+
+	vkCmdFillBuffer(cmd, counts_.buffer, slot * sizeof(uint32_t), sizeof(uint32_t), 0);
+
+	{
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	if (instance_count != 0) {
+		CullConstants constants{
+			.instance_count = instance_count,
+			.phase = static_cast<uint32_t>(phase),
+			.occlusion = (phase != CullPhase::early && pyramid_valid_) ? 1u : 0u,
+			.draw_base = slot * max_instances_,
+			.depth_width = static_cast<float>(veekay::app->window_width),
+			.depth_height = static_cast<float>(veekay::app->window_height),
+			.pyramid_levels = pyramid_levels_,
+			.compact = compacting() ? 1u : 0u,
+		};
+		memcpy(constants.view_projection, view_projection, sizeof(constants.view_projection));
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_layout_,
+		                        0, 1, &cull_sets_[frame], 0, nullptr);
+		vkCmdPushConstants(cmd, cull_layout_, VK_SHADER_STAGE_COMPUTE_BIT,
+		                   0, sizeof(constants), &constants);
+		vkCmdDispatch(cmd, (instance_count + cull_group_size - 1) / cull_group_size, 1, 1);
+	}
+
+	{
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+void veekay::OcclusionCuller::draw(VkCommandBuffer cmd, CullPhase phase) const {
+	const uint32_t slot = (phase == CullPhase::late) ? 1 : 0;
+	if (draw_counts_[slot] == 0) {
+		return;
+	}
+
+	const VkDeviceSize offset = VkDeviceSize(slot) * max_instances_ * sizeof(VkDrawIndexedIndirectCommand);
+
+	if (draw_indexed_indirect_count_) {
+		draw_indexed_indirect_count_(cmd, draws_.buffer, offset,
+		                             counts_.buffer, slot * sizeof(uint32_t),
+		                             draw_counts_[slot], sizeof(VkDrawIndexedIndirectCommand));
+	} else {
+		vkCmdDrawIndexedIndirect(cmd, draws_.buffer, offset, draw_counts_[slot],
+		                         sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
+
+void veekay::OcclusionCuller::buildPyramid(VkCommandBuffer cmd) {
+	VEEKAY_PROFILE_FUNCTION();
+
+	VkImageAspectFlags depth_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if (hasStencil(veekay::app->vk_depth_format)) {
+		depth_aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+	}
+
+	{
+		VkImageMemoryBarrier barriers[] = {
+			{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = veekay::app->vk_depth_image,
+				.subresourceRange = {
+					.aspectMask = depth_aspect,
+					.baseMipLevel = 0,
+					.levelCount = 1,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+			},
+			{ // NOTE: Culls reading the old pyramid finish before it's rewritten
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.srcAccessMask = 0,
+				.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+				.oldLayout = pyramid_ready_ ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED,
+				.newLayout = VK_IMAGE_LAYOUT_GENERAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = pyramid_,
+				.subresourceRange = {
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.baseMipLevel = 0,
+					.levelCount = pyramid_levels_,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+			},
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 0, nullptr, 0, nullptr, 2, barriers);
+		pyramid_ready_ = true;
+	}
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pyramid_pipeline_);
+
+	uint32_t source_width = veekay::app->window_width;
+	uint32_t source_height = veekay::app->window_height;
+	uint32_t width = pyramid_width_;
+	uint32_t height = pyramid_height_;
+
+	for (uint32_t i = 0; i < pyramid_levels_; ++i) {
+		PyramidConstants constants{
+			.source_width = static_cast<int32_t>(source_width),
+			.source_height = static_cast<int32_t>(source_height),
+		};
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pyramid_layout_,
+		                        0, 1, &pyramid_sets_[i], 0, nullptr);
+		vkCmdPushConstants(cmd, pyramid_layout_, VK_SHADER_STAGE_COMPUTE_BIT,
+		                   0, sizeof(constants), &constants);
+		vkCmdDispatch(cmd, (width + pyramid_group_size - 1) / pyramid_group_size,
+		              (height + pyramid_group_size - 1) / pyramid_group_size, 1);
+
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		source_width = width;
+		source_height = height;
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+	}
+
+	{ // NOTE: Depth goes back to attachment, color writes of the pass
+		//       before are made visible too, for vk_render_pass_load
+		VkMemoryBarrier color_barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		};
+
+		VkImageMemoryBarrier depth_barrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+			                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = veekay::app->vk_depth_image,
+			.subresourceRange = {
+				.aspectMask = depth_aspect,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		                     VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+		                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		                     0, 1, &color_barrier, 0, nullptr, 1, &depth_barrier);
+	}
+
+	pyramid_valid_ = true;
+}
+
+void veekay::OcclusionCuller::reset() {
+	pyramid_valid_ = false;
+	visibility_ready_ = false;
+}
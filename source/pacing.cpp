@@ -0,0 +1,168 @@
+#include <chrono>
+
+#include <veekay/pacing.hpp>
+#include <veekay/profiler.hpp>
+
+namespace {
+
+// NOTE: Limiter wakes up this much earlier than predicted, covers sleep
+//       overshoot and small spikes of frame work
+constexpr uint64_t limiter_slack = 500'000;
+
+// NOTE: Present waits time out periodically to notice shutdown
+constexpr uint64_t present_wait_timeout = 100'000'000;
+
+constexpr size_t max_pending_presents = 8;
+
+uint64_t now() {
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void smooth(double& value, double sample) {
+	value = (value == 0.0) ? sample : value + (sample - value) * 0.1;
+}
+
+} // namespace
+
+void veekay::FramePacer::initialize(VkDevice device, VkSwapchainKHR swapchain, double frame_limit,
+                                    PFN_vkWaitForPresentKHR wait_for_present) {
+	device_ = device;
+	swapchain_ = swapchain;
+	wait_for_present_ = wait_for_present;
+
+	period_ = (frame_limit > 0.0) ? static_cast<uint64_t>(1e9 / frame_limit) : 0;
+	predicted_work_ = 0;
+
+	input_sampled_ = 0;
+	last_submit_ = 0;
+	last_frame_ = 0;
+	next_present_id_ = 0;
+
+	stats_ = {.present_wait = wait_for_present != nullptr};
+
+	quit_ = false;
+	present_latency_.store(0, std::memory_order_relaxed);
+
+	if (wait_for_present_) {
+		waiter_ = std::thread(&FramePacer::waiterLoop, this);
+	}
+}
+
+void veekay::FramePacer::destroy() {
+	if (waiter_.joinable()) {
+		{
+			std::lock_guard lock(mutex_);
+			quit_ = true;
+		}
+		pending_cv_.notify_one();
+
+		waiter_.join();
+	}
+
+	pending_.clear();
+}
+
+void veekay::FramePacer::limit() {
+	if (period_ == 0 || last_submit_ == 0) {
+		return;
+	}
+
+	VEEKAY_PROFILE_SCOPE("Frame limiter");
+
+	// NOTE: Next frame should be submitted one period after the last one,
+	//       start it as late as predicted work allows to sample fresh input
+	const uint64_t lead = predicted_work_ + limiter_slack;
+	const uint64_t deadline = last_submit_ + period_;
+	if (deadline <= lead) {
+		return;
+	}
+
+	const uint64_t wake = deadline - lead;
+	const uint64_t current = now();
+	if (wake > current) {
+		std::this_thread::sleep_for(std::chrono::nanoseconds(wake - current));
+	}
+}
+
+void veekay::FramePacer::inputSampled() {
+	input_sampled_ = now();
+}
+
+uint64_t veekay::FramePacer::presentSubmitted() {
+	const uint64_t current = now();
+
+	if (last_frame_ != 0) {
+		smooth(stats_.frame_time, (current - last_frame_) * 1e-6);
+	}
+	last_frame_ = current;
+
+	const uint64_t work = current - input_sampled_;
+	smooth(stats_.input_to_submit, work * 1e-6);
+
+	// NOTE: Prediction jumps up to a slower frame at once and decays
+	//       slowly, a late wake-up costs a whole display refresh
+	predicted_work_ = (work > predicted_work_) ? work : predicted_work_ - (predicted_work_ - work) / 16;
+	last_submit_ = current;
+
+	if (!wait_for_present_) {
+		return 0;
+	}
+
+	const uint64_t latency = present_latency_.load(std::memory_order_relaxed);
+	if (latency != 0) {
+		smooth(stats_.submit_to_present, latency * 1e-6);
+	}
+
+	const uint64_t id = ++next_present_id_;
+
+	{
+		std::lock_guard lock(mutex_);
+
+		// NOTE: Waiting on a later present covers earlier ones too
+		if (pending_.size() == max_pending_presents) {
+			pending_.pop_front();
+		}
+		pending_.push_back({id, current});
+	}
+	pending_cv_.notify_one();
+
+	return id;
+}
+
+void veekay::FramePacer::waiterLoop() {
+	VEEKAY_PROFILE_THREAD("Present waiter");
+
+	for (;;) {
+		Pending pending;
+
+		{
+			std::unique_lock lock(mutex_);
+			pending_cv_.wait(lock, [this] { return quit_ || !pending_.empty(); });
+
+			if (quit_) {
+				break;
+			}
+
+			pending = pending_.front();
+			pending_.pop_front();
+		}
+
+		VkResult result;
+		for (;;) {
+			result = wait_for_present_(device_, swapchain_, pending.id, present_wait_timeout);
+			if (result != VK_TIMEOUT) {
+				break;
+			}
+
+			std::lock_guard lock(mutex_);
+			if (quit_) {
+				return;
+			}
+		}
+
+		if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+			present_latency_.store(now() - pending.submitted, std::memory_order_relaxed);
+		}
+	}
+}
@@ -0,0 +1,288 @@
+#include <iostream>
+
+#include <veekay/pipeline.hpp>
+#include <veekay/hash.hpp>
+
+bool veekay::operator==(const PipelineDescription& a, const PipelineDescription& b) {
+	if (a.vertex_shader != b.vertex_shader ||
+	    a.fragment_shader != b.fragment_shader ||
+	    a.mesh_shader != b.mesh_shader ||
+	    a.binding_count != b.binding_count ||
+	    a.attribute_count != b.attribute_count ||
+	    a.topology != b.topology ||
+	    a.polygon_mode != b.polygon_mode ||
+	    a.cull_mode != b.cull_mode ||
+	    a.front_face != b.front_face ||
+	    a.depth_test != b.depth_test ||
+	    a.depth_write != b.depth_write ||
+	    a.depth_compare != b.depth_compare ||
+	    a.blend != b.blend ||
+	    a.specialization_count != b.specialization_count ||
+	    a.layout != b.layout ||
+	    a.render_pass != b.render_pass ||
+	    a.subpass != b.subpass) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < a.binding_count; ++i) {
+		const auto& x = a.bindings[i];
+		const auto& y = b.bindings[i];
+
+		if (x.binding != y.binding || x.stride != y.stride || x.inputRate != y.inputRate) {
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < a.attribute_count; ++i) {
+		const auto& x = a.attributes[i];
+		const auto& y = b.attributes[i];
+
+		if (x.location != y.location || x.binding != y.binding ||
+		    x.format != y.format || x.offset != y.offset) {
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < a.specialization_count; ++i) {
+		if (a.specialization[i] != b.specialization[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t veekay::PipelineDescriptionHash::operator()(const PipelineDescription& d) const {
+	Hasher hasher;
+
+	hasher.add(d.vertex_shader);
+	hasher.add(d.fragment_shader);
+	hasher.add(d.mesh_shader);
+
+	hasher.add(d.binding_count);
+	for (uint32_t i = 0; i < d.binding_count; ++i) {
+		hasher.add(d.bindings[i].binding);
+		hasher.add(d.bindings[i].stride);
+		hasher.add(d.bindings[i].inputRate);
+	}
+
+	hasher.add(d.attribute_count);
+	for (uint32_t i = 0; i < d.attribute_count; ++i) {
+		hasher.add(d.attributes[i].location);
+		hasher.add(d.attributes[i].binding);
+		hasher.add(d.attributes[i].format);
+		hasher.add(d.attributes[i].offset);
+	}
+
+	hasher.add(d.topology);
+	hasher.add(d.polygon_mode);
+	hasher.add(d.cull_mode);
+	hasher.add(d.front_face);
+	hasher.add(d.depth_test);
+	hasher.add(d.depth_write);
+	hasher.add(d.depth_compare);
+	hasher.add(d.blend);
+
+	hasher.add(d.specialization_count);
+	for (uint32_t i = 0; i < d.specialization_count; ++i) {
+		hasher.add(d.specialization[i]);
+	}
+
+	hasher.add(d.layout);
+	hasher.add(d.render_pass);
+	hasher.add(d.subpass);
+
+	return static_cast<size_t>(hasher.value);
+}
+
+bool veekay::PipelineRegistry::initialize(VkDevice device) {
+	device_ = device;
+
+	VkPipelineCacheCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+	};
+
+	if (vkCreatePipelineCache(device_, &info, nullptr, &cache_) != VK_SUCCESS) {
+		std::cerr << "Failed to create Vulkan pipeline cache\n";
+		return false;
+	}
+
+	return true;
+}
+
+void veekay::PipelineRegistry::destroy() {
+	for (const auto& [description, pipeline] : pipelines_) {
+		vkDestroyPipeline(device_, pipeline, nullptr);
+	}
+
+	pipelines_.clear();
+
+	vkDestroyPipelineCache(device_, cache_, nullptr);
+}
+
+VkPipeline veekay::PipelineRegistry::request(const PipelineDescription& description) {
+	{
+		std::lock_guard lock(mutex_);
+
+		auto it = pipelines_.find(description);
+		if (it != pipelines_.end()) {
+			return it->second;
+		}
+	}
+
+	// NOTE: Created unlocked, compiling in background doesn't stall lookups
+	//       of other threads. Pipeline cache is internally synchronized
+	VkPipeline pipeline = create(description);
+	if (pipeline == VK_NULL_HANDLE) {
+		return VK_NULL_HANDLE;
+	}
+
+	std::lock_guard lock(mutex_);
+
+	// NOTE: Another thread may have created the same one meanwhile
+	auto [it, inserted] = pipelines_.emplace(description, pipeline);
+	if (!inserted) {
+		vkDestroyPipeline(device_, pipeline, nullptr);
+	}
+
+	return it->second;
+}
+
+VkPipeline veekay::PipelineRegistry::create(const PipelineDescription& d) {
+	// NOTE: Constant i is the i-th word of specialization data. Stages
+	//       ignore constants they don't declare
+	VkSpecializationMapEntry specialization_entries[max_specialization_constants];
+	for (uint32_t i = 0; i < d.specialization_count; ++i) {
+		specialization_entries[i] = {
+			.constantID = i,
+			.offset = static_cast<uint32_t>(i * sizeof(uint32_t)),
+			.size = sizeof(uint32_t),
+		};
+	}
+
+	VkSpecializationInfo specialization_info{
+		.mapEntryCount = d.specialization_count,
+		.pMapEntries = specialization_entries,
+		.dataSize = d.specialization_count * sizeof(uint32_t),
+		.pData = d.specialization,
+	};
+
+	const VkSpecializationInfo* specialization = d.specialization_count ? &specialization_info : nullptr;
+
+	VkPipelineShaderStageCreateInfo stage_infos[] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = d.mesh_shader ? VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT,
+			.module = d.mesh_shader ? d.mesh_shader : d.vertex_shader,
+			.pName = "main",
+			.pSpecializationInfo = specialization,
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.module = d.fragment_shader,
+			.pName = "main",
+			.pSpecializationInfo = specialization,
+		},
+	};
+
+	VkPipelineVertexInputStateCreateInfo input_state_info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+		.vertexBindingDescriptionCount = d.binding_count,
+		.pVertexBindingDescriptions = d.bindings,
+		.vertexAttributeDescriptionCount = d.attribute_count,
+		.pVertexAttributeDescriptions = d.attributes,
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo assembly_state_info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+		.topology = d.topology,
+	};
+
+	VkPipelineRasterizationStateCreateInfo raster_info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+		.polygonMode = d.polygon_mode,
+		.cullMode = d.cull_mode,
+		.frontFace = d.front_face,
+		.lineWidth = 1.0f,
+	};
+
+	VkPipelineMultisampleStateCreateInfo sample_info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+		.sampleShadingEnable = false,
+		.minSampleShading = 1.0f,
+	};
+
+	// NOTE: Only counts are baked in, actual rectangles are dynamic
+	VkPipelineViewportStateCreateInfo viewport_info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+		.viewportCount = 1,
+		.scissorCount = 1,
+	};
+
+	VkDynamicState dynamic_states[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR,
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamic_info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.dynamicStateCount = sizeof(dynamic_states) / sizeof(dynamic_states[0]),
+		.pDynamicStates = dynamic_states,
+	};
+
+	VkPipelineDepthStencilStateCreateInfo depth_info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+		.depthTestEnable = d.depth_test,
+		.depthWriteEnable = d.depth_write,
+		.depthCompareOp = d.depth_compare,
+	};
+
+	VkPipelineColorBlendAttachmentState attachment_info{
+		.blendEnable = d.blend,
+		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.colorBlendOp = VK_BLEND_OP_ADD,
+		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.alphaBlendOp = VK_BLEND_OP_ADD,
+		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
+		                  VK_COLOR_COMPONENT_G_BIT |
+		                  VK_COLOR_COMPONENT_B_BIT |
+		                  VK_COLOR_COMPONENT_A_BIT,
+	};
+
+	VkPipelineColorBlendStateCreateInfo blend_info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+		.logicOpEnable = false,
+		.logicOp = VK_LOGIC_OP_COPY,
+		.attachmentCount = 1,
+		.pAttachments = &attachment_info,
+	};
+
+	VkGraphicsPipelineCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+		.stageCount = 2,
+		.pStages = stage_infos,
+		.pVertexInputState = d.mesh_shader ? nullptr : &input_state_info,
+		.pInputAssemblyState = d.mesh_shader ? nullptr : &assembly_state_info,
+		.pViewportState = &viewport_info,
+		.pRasterizationState = &raster_info,
+		.pMultisampleState = &sample_info,
+		.pDepthStencilState = &depth_info,
+		.pColorBlendState = &blend_info,
+		.pDynamicState = &dynamic_info,
+		.layout = d.layout,
+		.renderPass = d.render_pass,
+		.subpass = d.subpass,
+	};
+
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(device_, cache_, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
+		std::cerr << "Failed to create Vulkan pipeline\n";
+		return VK_NULL_HANDLE;
+	}
+
+	return pipeline;
+}
@@ -0,0 +1,171 @@
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <veekay/profiler.hpp>
+
+namespace {
+
+constexpr uint32_t ring_capacity = 1 << 16;
+
+struct Zone {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+};
+
+// NOTE: Written by its owner thread only. head counts every zone ever
+//       written, zone i lives at i % ring_capacity
+struct ThreadRing {
+	std::atomic<uint64_t> head{0};
+	uint32_t id;
+	std::string name;
+	Zone zones[ring_capacity];
+};
+
+std::atomic<bool> enabled{false};
+
+// NOTE: Rings of exited threads stay in rings until another thread takes
+//       them from free_rings, so their zones can still be exported while
+//       short-lived threads (e.g. one tile writer per image) reuse the
+//       same few rings
+std::mutex rings_mutex;
+std::vector<std::unique_ptr<ThreadRing>> rings;
+std::vector<ThreadRing*> free_rings;
+uint32_t next_thread_id = 0;
+
+const uint64_t epoch = veekay::profilerTimestamp();
+
+// NOTE: Name is kept here until the thread records its first zone, only
+//       then it gets a ring
+struct ThreadState {
+	ThreadRing* ring = nullptr;
+	std::string name;
+
+	~ThreadState() {
+		if (ring) {
+			std::lock_guard lock(rings_mutex);
+			free_rings.push_back(ring);
+		}
+	}
+};
+
+thread_local ThreadState thread_state;
+
+ThreadRing& threadRing() {
+	ThreadState& state = thread_state;
+
+	if (!state.ring) {
+		std::lock_guard lock(rings_mutex);
+
+		if (free_rings.empty()) {
+			rings.push_back(std::make_unique<ThreadRing>());
+			state.ring = rings.back().get();
+		} else {
+			state.ring = free_rings.back();
+			free_rings.pop_back();
+			state.ring->head.store(0, std::memory_order_relaxed);
+		}
+
+		state.ring->id = next_thread_id++;
+		state.ring->name = state.name.empty()
+			? "Thread " + std::to_string(state.ring->id)
+			: state.name;
+	}
+
+	return *state.ring;
+}
+
+void writeEscaped(FILE* file, const char* text) {
+	for (; *text; ++text) {
+		if (*text == '"' || *text == '\\') {
+			fputc('\\', file);
+		}
+		fputc(*text, file);
+	}
+}
+
+} // namespace
+
+void veekay::setProfilerEnabled(bool value) {
+	enabled.store(value, std::memory_order_relaxed);
+}
+
+bool veekay::profilerEnabled() {
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void veekay::setProfilerThreadName(const char* name) {
+	ThreadState& state = thread_state;
+	state.name = name;
+
+	if (state.ring) {
+		std::lock_guard lock(rings_mutex);
+		state.ring->name = name;
+	}
+}
+
+void veekay::recordProfileZone(const char* name, uint64_t start, uint64_t end) {
+	ThreadRing& ring = threadRing();
+
+	const uint64_t head = ring.head.load(std::memory_order_relaxed);
+	ring.zones[head % ring_capacity] = Zone{name, start, end};
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+bool veekay::writeProfilerTrace(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		std::cerr << "Failed to open " << path << " for profiler trace\n";
+		return false;
+	}
+
+	fputs("{\"traceEvents\":[\n", file);
+
+	bool first = true;
+	std::vector<Zone> zones;
+
+	std::lock_guard lock(rings_mutex);
+
+	for (const auto& ring : rings) {
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+		        first ? "" : ",\n", ring->id);
+		writeEscaped(file, ring->name.c_str());
+		fputs("\"}}", file);
+		first = false;
+
+		// NOTE: Owner thread may keep writing while zones are copied out,
+		//       zones it could have overwritten meanwhile are dropped
+		const uint64_t head = ring->head.load(std::memory_order_acquire);
+		const uint64_t begin = (head > ring_capacity) ? head - ring_capacity : 0;
+
+		zones.clear();
+		for (uint64_t i = begin; i < head; ++i) {
+			zones.push_back(ring->zones[i % ring_capacity]);
+		}
+
+		const uint64_t new_head = ring->head.load(std::memory_order_acquire);
+		const uint64_t valid = (new_head > ring_capacity) ? new_head - ring_capacity : 0;
+
+		for (uint64_t i = begin; i < head; ++i) {
+			if (i < valid) {
+				continue;
+			}
+
+			const Zone& zone = zones[i - begin];
+
+			fputs(",\n{\"name\":\"", file);
+			writeEscaped(file, zone.name);
+			fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			        ring->id, (zone.start - epoch) / 1000.0, (zone.end - zone.start) / 1000.0);
+		}
+	}
+
+	fputs("\n]}\n", file);
+
+	return fclose(file) == 0;
+}
@@ -0,0 +1,238 @@
+#include <cmath>
+#include <cassert>
+
+#include <veekay/scene.hpp>
+#include <veekay/jobs.hpp>
+
+namespace {
+
+// NOTE: Objects are processed in fixed-size batches: components are gathered
+//       into lane arrays, matrices are computed lane-wise without branches
+//       (compiler vectorizes these loops) and then scattered to GPU memory
+constexpr uint32_t batch_size = 16;
+
+// NOTE: Batches computed by a single job in parallel flush
+constexpr uint32_t batches_per_job = 64;
+
+} // namespace
+
+veekay::Scene::Scene(uint32_t frame_count) {
+	assert(frame_count > 0 && frame_count <= max_frames);
+	all_frames_mask_ = static_cast<uint8_t>((1u << frame_count) - 1u);
+}
+
+uint32_t veekay::Scene::create() {
+	const uint32_t id = size();
+
+	position_x_.push_back(0.0f);
+	position_y_.push_back(0.0f);
+	position_z_.push_back(0.0f);
+
+	rotation_x_.push_back(0.0f);
+	rotation_y_.push_back(0.0f);
+	rotation_z_.push_back(0.0f);
+	rotation_w_.push_back(1.0f);
+
+	scale_x_.push_back(1.0f);
+	scale_y_.push_back(1.0f);
+	scale_z_.push_back(1.0f);
+
+	material_.push_back(0);
+
+	dirty_.push_back(0);
+	markDirty(id);
+
+	return id;
+}
+
+void veekay::Scene::setPosition(uint32_t id, float x, float y, float z) {
+	position_x_[id] = x;
+	position_y_[id] = y;
+	position_z_[id] = z;
+	markDirty(id);
+}
+
+void veekay::Scene::setRotation(uint32_t id, float axis_x, float axis_y, float axis_z, float angle) {
+	float length = sqrtf(axis_x * axis_x + axis_y * axis_y + axis_z * axis_z);
+	float s = sinf(angle * 0.5f) / length;
+
+	rotation_x_[id] = axis_x * s;
+	rotation_y_[id] = axis_y * s;
+	rotation_z_[id] = axis_z * s;
+	rotation_w_[id] = cosf(angle * 0.5f);
+	markDirty(id);
+}
+
+void veekay::Scene::setScale(uint32_t id, float x, float y, float z) {
+	scale_x_[id] = x;
+	scale_y_[id] = y;
+	scale_z_[id] = z;
+	markDirty(id);
+}
+
+void veekay::Scene::setMaterial(uint32_t id, uint32_t material) {
+	material_[id] = material;
+	markDirty(id);
+}
+
+void veekay::Scene::markDirty(uint32_t id) {
+	if (dirty_[id] == 0) {
+		dirty_list_.push_back(id);
+	}
+
+	dirty_[id] = all_frames_mask_;
+}
+
+uint32_t veekay::Scene::flush(uint32_t frame, InstanceData* instances) {
+	const uint8_t bit = static_cast<uint8_t>(1u << frame);
+
+	uint32_t batch[batch_size];
+	uint32_t count = 0;
+	uint32_t written = 0;
+
+	// NOTE: Walk only changed objects, drop those that are now up to date
+	//       in every frame slot from the list
+	size_t kept = 0;
+	for (size_t i = 0, e = dirty_list_.size(); i != e; ++i) {
+		const uint32_t id = dirty_list_[i];
+
+		if (dirty_[id] & bit) {
+			dirty_[id] &= static_cast<uint8_t>(~bit);
+			batch[count++] = id;
+
+			if (count == batch_size) {
+				computeBatch(batch, count, instances);
+				written += count;
+				count = 0;
+			}
+		}
+
+		if (dirty_[id] != 0) {
+			dirty_list_[kept++] = id;
+		}
+	}
+
+	if (count != 0) {
+		computeBatch(batch, count, instances);
+		written += count;
+	}
+
+	dirty_list_.resize(kept);
+
+	return written;
+}
+
+uint32_t veekay::Scene::flush(uint32_t frame, InstanceData* instances, JobSystem& jobs) {
+	const uint8_t bit = static_cast<uint8_t>(1u << frame);
+
+	// NOTE: Dirty list is updated serially, only matrix computation is
+	//       split, every batch writes its own instance records
+	flush_ids_.clear();
+
+	size_t kept = 0;
+	for (size_t i = 0, e = dirty_list_.size(); i != e; ++i) {
+		const uint32_t id = dirty_list_[i];
+
+		if (dirty_[id] & bit) {
+			dirty_[id] &= static_cast<uint8_t>(~bit);
+			flush_ids_.push_back(id);
+		}
+
+		if (dirty_[id] != 0) {
+			dirty_list_[kept++] = id;
+		}
+	}
+
+	dirty_list_.resize(kept);
+
+	const uint32_t count = static_cast<uint32_t>(flush_ids_.size());
+	const uint32_t batches = (count + batch_size - 1) / batch_size;
+
+	jobs.parallelFor(batches, batches_per_job, [this, count, instances](uint32_t begin, uint32_t end) {
+		for (uint32_t b = begin; b < end; ++b) {
+			const uint32_t first = b * batch_size;
+			const uint32_t n = (count - first < batch_size) ? count - first : batch_size;
+			computeBatch(flush_ids_.data() + first, n, instances);
+		}
+	});
+
+	return count;
+}
+
+void veekay::Scene::computeBatch(const uint32_t* ids, uint32_t count,
+                                 InstanceData* instances) const {
+	alignas(64) float px[batch_size], py[batch_size], pz[batch_size];
+	alignas(64) float qx[batch_size], qy[batch_size], qz[batch_size], qw[batch_size];
+	alignas(64) float sx[batch_size], sy[batch_size], sz[batch_size];
+
+	// NOTE: Gather, unused tail lanes are computed but never written back
+	for (uint32_t i = 0; i < batch_size; ++i) {
+		const uint32_t id = ids[i < count ? i : 0];
+
+		px[i] = position_x_[id];
+		py[i] = position_y_[id];
+		pz[i] = position_z_[id];
+
+		qx[i] = rotation_x_[id];
+		qy[i] = rotation_y_[id];
+		qz[i] = rotation_z_[id];
+		qw[i] = rotation_w_[id];
+
+		sx[i] = scale_x_[id];
+		sy[i] = scale_y_[id];
+		sz[i] = scale_z_[id];
+	}
+
+	// NOTE: Columns of T * R * S, R comes from unit quaternion
+	alignas(64) float m[12][batch_size];
+
+	for (uint32_t i = 0; i < batch_size; ++i) {
+		const float xx = qx[i] * qx[i], yy = qy[i] * qy[i], zz = qz[i] * qz[i];
+		const float xy = qx[i] * qy[i], xz = qx[i] * qz[i], yz = qy[i] * qz[i];
+		const float wx = qw[i] * qx[i], wy = qw[i] * qy[i], wz = qw[i] * qz[i];
+
+		m[0][i] = sx[i] * (1.0f - 2.0f * (yy + zz));
+		m[1][i] = sx[i] * (2.0f * (xy + wz));
+		m[2][i] = sx[i] * (2.0f * (xz - wy));
+
+		m[3][i] = sy[i] * (2.0f * (xy - wz));
+		m[4][i] = sy[i] * (1.0f - 2.0f * (xx + zz));
+		m[5][i] = sy[i] * (2.0f * (yz + wx));
+
+		m[6][i] = sz[i] * (2.0f * (xz + wy));
+		m[7][i] = sz[i] * (2.0f * (yz - wx));
+		m[8][i] = sz[i] * (1.0f - 2.0f * (xx + yy));
+
+		m[9][i] = px[i];
+		m[10][i] = py[i];
+		m[11][i] = pz[i];
+	}
+
+	// NOTE: Scatter straight into (mapped) instance buffer
+	for (uint32_t i = 0; i < count; ++i) {
+		const uint32_t id = ids[i];
+		InstanceData& out = instances[id];
+
+		out.model[0] = m[0][i];
+		out.model[1] = m[1][i];
+		out.model[2] = m[2][i];
+		out.model[3] = 0.0f;
+
+		out.model[4] = m[3][i];
+		out.model[5] = m[4][i];
+		out.model[6] = m[5][i];
+		out.model[7] = 0.0f;
+
+		out.model[8] = m[6][i];
+		out.model[9] = m[7][i];
+		out.model[10] = m[8][i];
+		out.model[11] = 0.0f;
+
+		out.model[12] = m[9][i];
+		out.model[13] = m[10][i];
+		out.model[14] = m[11][i];
+		out.model[15] = 1.0f;
+
+		out.material = material_[id];
+	}
+}
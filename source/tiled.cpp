@@ -0,0 +1,617 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/tiled.hpp>
+#include <veekay/descriptors.hpp>
+#include <veekay/loader.hpp>
+#include <veekay/profiler.hpp>
+
+namespace {
+
+bool seekFile(FILE* file, uint64_t offset) {
+#if defined(_WIN32)
+	return _fseeki64(file, static_cast<long long>(offset), SEEK_SET) == 0;
+#else
+	return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+std::string framePath(const std::string& pattern, uint32_t frame, uint32_t frame_count) {
+	std::string path = pattern;
+
+	size_t begin = path.find('#');
+	size_t length;
+
+	if (begin != std::string::npos) {
+		const size_t end = path.find_first_not_of('#', begin);
+		length = ((end == std::string::npos) ? path.size() : end) - begin;
+	} else if (frame_count > 1) { // NOTE: Numbered as _#### before extension
+		const size_t dot = path.rfind('.');
+		const size_t slash = path.find_last_of("/\\");
+
+		begin = (dot != std::string::npos && (slash == std::string::npos || dot > slash)) ?
+		        dot : path.size();
+		path.insert(begin, "_####");
+
+		begin += 1;
+		length = 4;
+	} else {
+		return path;
+	}
+
+	std::string number = std::to_string(frame);
+	if (number.size() < length) {
+		number.insert(0, length - number.size(), '0');
+	}
+
+	path.replace(begin, length, number);
+
+	return path;
+}
+
+} // namespace
+
+bool veekay::renderTiledFrames(const ApplicationInfo& app_info, const ApplicationConfig& config,
+                               VkFormat color_format, VkFormat depth_format,
+                               VkRenderPass render_pass, VkImageLayout color_layout,
+                               double (*now)()) {
+	VEEKAY_PROFILE_FUNCTION();
+
+	if (config.tiled_output.empty()) {
+		std::cerr << "Tiled rendering needs an output image, set tiled_output\n";
+		return false;
+	}
+
+	const uint32_t width = config.tiled_width ? config.tiled_width : veekay::app->window_width;
+	const uint32_t height = config.tiled_height ? config.tiled_height : veekay::app->window_height;
+	const uint32_t frame_count = std::max(config.tiled_frames, 1u);
+
+	// NOTE: Frame slots are idle, nothing was submitted through them yet
+	TiledRenderer renderer;
+	bool rendered = renderer.initialize(color_format, depth_format, render_pass, color_layout,
+	                                    config.tile_size, veekay::app->frames_in_flight);
+
+	for (uint32_t frame = 0; rendered && frame < frame_count; ++frame) {
+		if (frame != 0) {
+			veekay::app->clock->advance(now());
+		}
+
+		// NOTE: Everything started loading so far is in place, images don't
+		//       depend on how fast the loader happened to be
+		veekay::app->loader->flush();
+
+		if (!veekay::app->simulation_threaded) {
+			app_info.update(veekay::app->clock->time());
+		}
+
+		const std::string path = framePath(config.tiled_output, frame, frame_count);
+
+		rendered = renderer.render(path, width, height, app_info.render);
+		if (rendered) {
+			std::cerr << "Rendered " << width << 'x' << height << " image to " << path << '\n';
+		}
+	}
+
+	// NOTE: Device may be shared by other contexts, their queues are theirs
+	vkQueueWaitIdle(veekay::app->vk_graphics_queue);
+	renderer.destroy();
+
+	return rendered;
+}
+
+void veekay::tileProjection(float projection[16]) {
+	const TileInfo& tile = veekay::app->tile;
+	if (!tile.active) {
+		return;
+	}
+
+	// NOTE: Rows 0 and 1 (x and y) become scale * row + offset * row 3 (w)
+	for (int column = 0; column < 4; ++column) {
+		float* m = projection + column * 4;
+		m[0] = tile.scale[0] * m[0] + tile.offset[0] * m[3];
+		m[1] = tile.scale[1] * m[1] + tile.offset[1] * m[3];
+	}
+}
+
+bool veekay::TiledRenderer::initialize(VkFormat color_format, VkFormat depth_format,
+                                       VkRenderPass render_pass, VkImageLayout color_layout,
+                                       uint32_t tile_size, uint32_t slot_count) {
+	device_ = veekay::app->vk_device;
+	tile_size_ = tile_size;
+	color_layout_ = color_layout;
+	command_pool_ = VK_NULL_HANDLE;
+	file_ = nullptr;
+
+	switch (color_format) {
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		swizzle_ = true;
+		break;
+
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		swizzle_ = false;
+		break;
+
+	default:
+		std::cerr << "Tiled rendering does not support color format " << color_format << '\n';
+		return false;
+	}
+
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(veekay::app->vk_physical_device, &properties);
+
+		if (tile_size == 0 || tile_size > properties.limits.maxFramebufferWidth ||
+		    tile_size > properties.limits.maxFramebufferHeight) {
+			std::cerr << "Tile size " << tile_size << " is not supported by device\n";
+			return false;
+		}
+	}
+
+	{
+		VkCommandPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = veekay::app->vk_graphics_queue_family,
+		};
+
+		if (vkCreateCommandPool(device_, &info, nullptr, &command_pool_) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan command pool for tiled rendering\n";
+			return false;
+		}
+	}
+
+	slots_.resize(slot_count);
+
+	for (Slot& slot : slots_) {
+		slot = {};
+
+		if (!createImage(color_format,
+		                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+		                 VK_IMAGE_ASPECT_COLOR_BIT, slot.color, slot.color_memory, slot.color_view) ||
+		    !createImage(depth_format,
+		                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+		                 VK_IMAGE_ASPECT_DEPTH_BIT, slot.depth, slot.depth_memory, slot.depth_view)) {
+			return false;
+		}
+
+		{
+			VkImageView attachments[] = {slot.color_view, slot.depth_view};
+
+			VkFramebufferCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+				.renderPass = render_pass,
+				.attachmentCount = 2,
+				.pAttachments = attachments,
+				.width = tile_size,
+				.height = tile_size,
+				.layers = 1,
+			};
+
+			if (vkCreateFramebuffer(device_, &info, nullptr, &slot.framebuffer) != VK_SUCCESS) {
+				std::cerr << "Failed to create Vulkan framebuffer for tiled rendering\n";
+				return false;
+			}
+		}
+
+		{
+			VkCommandBuffer buffers[2];
+
+			VkCommandBufferAllocateInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = command_pool_,
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = 2,
+			};
+
+			if (vkAllocateCommandBuffers(device_, &info, buffers) != VK_SUCCESS) {
+				std::cerr << "Failed to allocate Vulkan command buffers for tiled rendering\n";
+				return false;
+			}
+
+			slot.cmd = buffers[0];
+			slot.copy_cmd = buffers[1];
+		}
+
+		{
+			VkFenceCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+			};
+
+			if (vkCreateFence(device_, &info, nullptr, &slot.fence) != VK_SUCCESS) {
+				std::cerr << "Failed to create Vulkan fence for tiled rendering\n";
+				return false;
+			}
+		}
+
+		// NOTE: Cached memory makes CPU reads from readback buffers fast
+		slot.readback = createBuffer(VkDeviceSize(tile_size) * tile_size * 4, nullptr,
+		                             VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                             VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+		if (!slot.readback.buffer) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void veekay::TiledRenderer::destroy() {
+	for (const Slot& slot : slots_) {
+		destroyBuffer(slot.readback);
+		vkDestroyFence(device_, slot.fence, nullptr);
+		vkDestroyFramebuffer(device_, slot.framebuffer, nullptr);
+
+		vkDestroyImageView(device_, slot.depth_view, nullptr);
+		vkDestroyImage(device_, slot.depth, nullptr);
+		freeMemory(slot.depth_memory);
+
+		vkDestroyImageView(device_, slot.color_view, nullptr);
+		vkDestroyImage(device_, slot.color, nullptr);
+		freeMemory(slot.color_memory);
+	}
+
+	slots_.clear();
+
+	vkDestroyCommandPool(device_, command_pool_, nullptr);
+}
+
+bool veekay::TiledRenderer::render(const std::string& path, uint32_t width, uint32_t height,
+                                   RenderFunc render) {
+	VEEKAY_PROFILE_FUNCTION();
+
+	file_ = fopen(path.c_str(), "wb");
+	if (!file_) {
+		std::cerr << "Failed to open " << path << " for tiled rendering\n";
+		return false;
+	}
+
+	// NOTE: Tiles land at their offsets after the header, in any order
+	if (fprintf(file_, "P6\n%u %u\n255\n", width, height) < 0) {
+		std::cerr << "Failed to write " << path << '\n';
+		fclose(file_);
+		file_ = nullptr;
+		return false;
+	}
+
+	image_width_ = width;
+	write_failed_ = false;
+	quit_ = false;
+	writer_ = std::thread(&TiledRenderer::writerLoop, this);
+
+	const uint32_t window_width = veekay::app->window_width;
+	const uint32_t window_height = veekay::app->window_height;
+	const uint32_t frame_index = veekay::app->frame_index;
+
+	const uint32_t columns = (width + tile_size_ - 1) / tile_size_;
+	const uint32_t rows = (height + tile_size_ - 1) / tile_size_;
+	const uint32_t slot_count = static_cast<uint32_t>(slots_.size());
+	bool submit_failed = false;
+
+	for (uint32_t i = 0; i < columns * rows; ++i) {
+		const uint32_t index = i % slot_count;
+		Slot& slot = slots_[index];
+
+		// NOTE: Slot's previous tile goes to writer, its readback buffer
+		//       must be written out before it is reused
+		retire(index);
+		{
+			std::unique_lock lock(mutex_);
+			written_.wait(lock, [&slot] { return !slot.writing; });
+		}
+
+		const uint32_t x = (i % columns) * tile_size_;
+		const uint32_t y = (i / columns) * tile_size_;
+		const uint32_t tile_width = std::min(tile_size_, width - x);
+		const uint32_t tile_height = std::min(tile_size_, height - y);
+
+		// NOTE: Image spans [-1, 1] in NDC, tile spans [x0, x1] x [y0, y1]
+		//       and is stretched back over [-1, 1]
+		const float x0 = -1.0f + 2.0f * float(x) / float(width);
+		const float x1 = -1.0f + 2.0f * float(x + tile_width) / float(width);
+		const float y0 = -1.0f + 2.0f * float(y) / float(height);
+		const float y1 = -1.0f + 2.0f * float(y + tile_height) / float(height);
+
+		slot.tile = {
+			.active = true,
+			.image_width = width,
+			.image_height = height,
+			.x = x,
+			.y = y,
+			.width = tile_width,
+			.height = tile_height,
+			.scale = {2.0f / (x1 - x0), 2.0f / (y1 - y0)},
+			.offset = {-(x0 + x1) / (x1 - x0), -(y0 + y1) / (y1 - y0)},
+		};
+
+		veekay::app->tile = slot.tile;
+		veekay::app->window_width = tile_width;
+		veekay::app->window_height = tile_height;
+		veekay::app->frame_index = index;
+
+		{
+			VEEKAY_PROFILE_SCOPE("Render tile");
+			render(slot.cmd, slot.framebuffer);
+		}
+
+		recordCopy(slot);
+
+		VkCommandBuffer buffers[] = {slot.cmd, slot.copy_cmd};
+
+		VkSubmitInfo info{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.commandBufferCount = 2,
+			.pCommandBuffers = buffers,
+		};
+
+		if (vkQueueSubmit(veekay::app->vk_graphics_queue, 1, &info, slot.fence) != VK_SUCCESS) {
+			std::cerr << "Failed to submit tile\n";
+			submit_failed = true;
+			break;
+		}
+
+		slot.submitted = true;
+
+		// NOTE: Finished tiles go to writer right away instead of when
+		//       their slot is needed again, so writing overlaps rendering
+		for (uint32_t j = 0; j < slot_count; ++j) {
+			if (j != index && slots_[j].submitted &&
+			    vkGetFenceStatus(device_, slots_[j].fence) == VK_SUCCESS) {
+				retire(j);
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < slot_count; ++i) {
+		retire(i);
+	}
+
+	{
+		std::lock_guard lock(mutex_);
+		quit_ = true;
+	}
+
+	wake_.notify_one();
+	writer_.join();
+
+	veekay::app->tile = {};
+	veekay::app->window_width = window_width;
+	veekay::app->window_height = window_height;
+	veekay::app->frame_index = frame_index;
+
+	const bool ok = fclose(file_) == 0 && !write_failed_ && !submit_failed;
+	file_ = nullptr;
+
+	if (!ok) {
+		std::cerr << "Failed to write tiled image " << path << '\n';
+	}
+
+	return ok;
+}
+
+bool veekay::TiledRenderer::createImage(VkFormat format, VkImageUsageFlags usage,
+                                        VkImageAspectFlags aspect, VkImage& image,
+                                        VkDeviceMemory& memory, VkImageView& view) {
+	{
+		VkImageCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = format,
+			.extent = {tile_size_, tile_size_, 1},
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = usage,
+		};
+
+		if (vkCreateImage(device_, &info, nullptr, &image) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan image for tiled rendering\n";
+			return false;
+		}
+	}
+
+	{
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device_, image, &requirements);
+
+		// NOTE: Depth of a tile never leaves the render pass, same as
+		//       window depth when it isn't sampled
+		const VkMemoryPropertyFlags preferred = (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) ?
+		                                        VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0;
+
+		memory = allocateMemory(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                        MemoryCategory::image, preferred);
+		if (!memory) {
+			return false;
+		}
+
+		if (vkBindImageMemory(device_, image, memory, 0) != VK_SUCCESS) {
+			std::cerr << "Failed to bind Vulkan image memory for tiled rendering\n";
+			return false;
+		}
+	}
+
+	{
+		VkImageViewCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = image,
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = format,
+			.subresourceRange = {
+				.aspectMask = aspect,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		};
+
+		if (vkCreateImageView(device_, &info, nullptr, &view) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan image view for tiled rendering\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void veekay::TiledRenderer::recordCopy(Slot& slot) {
+	VkCommandBuffer cmd = slot.copy_cmd;
+
+	vkResetCommandBuffer(cmd, 0);
+
+	{
+		VkCommandBufferBeginInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		};
+
+		vkBeginCommandBuffer(cmd, &info);
+	}
+
+	{ // NOTE: Windowed vk_render_pass leaves color in PRESENT_SRC, headless
+		//       contexts' pass in TRANSFER_SRC already
+		VkImageMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+			.oldLayout = color_layout_,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = slot.color,
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.levelCount = 1,
+				.layerCount = 1,
+			},
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		                     0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	{ // NOTE: Edge tiles only copy their rendered part, rows stay tight
+		VkBufferImageCopy region{
+			.bufferOffset = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.layerCount = 1,
+			},
+			.imageExtent = {slot.tile.width, slot.tile.height, 1},
+		};
+
+		vkCmdCopyImageToBuffer(cmd, slot.color, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		                       slot.readback.buffer, 1, &region);
+	}
+
+	{
+		VkBufferMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.buffer = slot.readback.buffer,
+			.offset = 0,
+			.size = VK_WHOLE_SIZE,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		                     0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	vkEndCommandBuffer(cmd);
+}
+
+void veekay::TiledRenderer::retire(uint32_t index) {
+	Slot& slot = slots_[index];
+	if (!slot.submitted) {
+		return;
+	}
+
+	vkWaitForFences(device_, 1, &slot.fence, true, UINT64_MAX);
+	vkResetFences(device_, 1, &slot.fence);
+	slot.submitted = false;
+
+	// NOTE: Same bookkeeping as when a frame slot's fence signals
+	veekay::collectDeferredBuffers();
+	veekay::app->descriptors->reset(index);
+
+	{
+		std::lock_guard lock(mutex_);
+		slot.writing = true;
+		jobs_.push_back(index);
+	}
+
+	wake_.notify_one();
+}
+
+void veekay::TiledRenderer::writerLoop() {
+	VEEKAY_PROFILE_THREAD("Tile writer");
+
+	for (;;) {
+		uint32_t index;
+
+		{
+			std::unique_lock lock(mutex_);
+			wake_.wait(lock, [this] { return quit_ || !jobs_.empty(); });
+
+			// NOTE: Queue is drained before quitting, no tile is lost
+			if (jobs_.empty()) {
+				return;
+			}
+
+			index = jobs_.front();
+			jobs_.pop_front();
+		}
+
+		write(index);
+
+		{
+			std::lock_guard lock(mutex_);
+			slots_[index].writing = false;
+		}
+
+		written_.notify_all();
+	}
+}
+
+void veekay::TiledRenderer::write(uint32_t index) {
+	VEEKAY_PROFILE_SCOPE("Write tile");
+
+	const Slot& slot = slots_[index];
+	const TileInfo& tile = slot.tile;
+	const auto* pixels = static_cast<const uint8_t*>(slot.readback.mapped);
+
+	// NOTE: Header is "P6\n<width> <height>\n255\n", found by its length
+	const uint64_t header = uint64_t(snprintf(nullptr, 0, "P6\n%u %u\n255\n",
+	                                          tile.image_width, tile.image_height));
+
+	const int r = swizzle_ ? 2 : 0;
+	const int b = swizzle_ ? 0 : 2;
+
+	row_.resize(size_t(tile.width) * 3);
+
+	for (uint32_t y = 0; y < tile.height; ++y) {
+		const uint8_t* source = pixels + size_t(y) * tile.width * 4;
+
+		for (uint32_t x = 0; x < tile.width; ++x) {
+			row_[x * 3 + 0] = source[x * 4 + r];
+			row_[x * 3 + 1] = source[x * 4 + 1];
+			row_[x * 3 + 2] = source[x * 4 + b];
+		}
+
+		const uint64_t offset = header + (uint64_t(tile.y + y) * image_width_ + tile.x) * 3;
+
+		if (!seekFile(file_, offset) || fwrite(row_.data(), 1, row_.size(), file_) != row_.size()) {
+			write_failed_ = true;
+			return;
+		}
+	}
+}
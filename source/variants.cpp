@@ -0,0 +1,101 @@
+#include <veekay/veekay.hpp>
+#include <veekay/variants.hpp>
+#include <veekay/loader.hpp>
+#include <veekay/hash.hpp>
+
+bool veekay::operator==(const ShaderVariant& a, const ShaderVariant& b) {
+	if (a.count != b.count) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < a.count; ++i) {
+		if (a.constants[i] != b.constants[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t veekay::ShaderVariantHash::operator()(const ShaderVariant& variant) const {
+	Hasher hasher;
+
+	hasher.add(variant.count);
+	for (uint32_t i = 0; i < variant.count; ++i) {
+		hasher.add(variant.constants[i]);
+	}
+
+	return static_cast<size_t>(hasher.value);
+}
+
+void veekay::VariantCache::initialize(const PipelineDescription& base) {
+	base_ = base;
+	variants_.clear();
+	pending_ = 0;
+}
+
+void veekay::VariantCache::destroy() {
+	variants_.clear();
+	pending_ = 0;
+}
+
+veekay::PipelineDescription veekay::VariantCache::describe(const ShaderVariant& variant) const {
+	PipelineDescription description = base_;
+
+	description.specialization_count = variant.count;
+	for (uint32_t i = 0; i < variant.count; ++i) {
+		description.specialization[i] = variant.constants[i];
+	}
+
+	return description;
+}
+
+VkPipeline veekay::VariantCache::request(const ShaderVariant& variant) {
+	auto it = variants_.find(variant);
+	if (it != variants_.end() && !it->second.pending) {
+		return it->second.pipeline;
+	}
+
+	// NOTE: Registry deduplicates, so building a variant already queued for
+	//       background build only costs a second lookup there
+	VkPipeline pipeline = veekay::app->pipelines->request(describe(variant));
+
+	if (it == variants_.end()) {
+		variants_.emplace(variant, Entry{pipeline, false});
+	} else if (pipeline != VK_NULL_HANDLE) {
+		it->second.pipeline = pipeline;
+	}
+
+	return pipeline;
+}
+
+VkPipeline veekay::VariantCache::requestAsync(const ShaderVariant& variant) {
+	auto it = variants_.find(variant);
+	if (it != variants_.end()) {
+		return it->second.pipeline;
+	}
+
+	variants_.emplace(variant, Entry{VK_NULL_HANDLE, true});
+	++pending_;
+
+	// NOTE: Registry is thread-safe, pipeline handed over to main thread
+	//       through shared state, the load itself stages nothing
+	auto result = std::make_shared<VkPipeline>(VK_NULL_HANDLE);
+	PipelineDescription description = describe(variant);
+
+	veekay::app->loader->load(
+		[result, description](Upload&) {
+			*result = veekay::app->pipelines->request(description);
+			return *result != VK_NULL_HANDLE;
+		},
+		[this, variant, result](bool) {
+			Entry& entry = variants_.at(variant);
+			if (entry.pipeline == VK_NULL_HANDLE) {
+				entry.pipeline = *result;
+			}
+			entry.pending = false;
+			--pending_;
+		});
+
+	return VK_NULL_HANDLE;
+}
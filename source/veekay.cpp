@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <climits>
+#include <cstring>
 #include <iostream>
+#include <thread>
 
 #include <vector>
 
@@ -16,19 +21,37 @@
 #include <imgui_impl_vulkan.h>
 
 #include <veekay/veekay.hpp>
+#include <veekay/device.hpp>
+#include <veekay/pipeline.hpp>
+#include <veekay/memory.hpp>
+#include <veekay/capture.hpp>
+#include <veekay/input_replay.hpp>
+#include <veekay/jobs.hpp>
+#include <veekay/loader.hpp>
+#include <veekay/descriptors.hpp>
+#include <veekay/tiled.hpp>
+#include <veekay/pacing.hpp>
+#include <veekay/profiler.hpp>
 
 namespace {
 
-constexpr uint32_t window_default_width = 1280;
-constexpr uint32_t window_default_height = 720;
 constexpr char window_title[] = "Veekay";
 
-constexpr uint32_t max_frames_in_flight = 2;
+// NOTE: Frame slot dirty masks (see veekay::Scene) are 8 bits wide
+constexpr uint32_t max_frames_in_flight = 8;
+
+uint32_t frames_in_flight;
+
+// NOTE: State of the windowed app, there is one window per process.
+//       Headless contexts keep theirs in veekay::Context
+veekay::Application application;
 
 GLFWwindow* window;
 
+// NOTE: Owns instance, surface and device, globals below copy handles
+veekay::Device vk_device_setup;
+
 VkInstance vk_instance;
-VkDebugUtilsMessengerEXT vk_debug_messenger;
 VkPhysicalDevice vk_physical_device;
 VkDevice vk_device;
 VkSurfaceKHR vk_surface;
@@ -41,17 +64,29 @@ std::vector<VkImageView> vk_swapchain_image_views;
 VkQueue vk_graphics_queue;
 uint32_t vk_graphics_queue_family;
 
-// NOTE: ImGui rendering objects
+// NOTE: ImGui rendering objects, render pass, framebuffers and
+//       command buffers exist only with OverlayMode::separate_pass
+veekay::OverlayMode overlay_mode;
 VkDescriptorPool imgui_descriptor_pool;
 VkRenderPass imgui_render_pass;
 VkCommandPool imgui_command_pool;
 std::vector<VkCommandBuffer> imgui_command_buffers;
 std::vector<VkFramebuffer> imgui_framebuffers;
 
+// NOTE: Overlay command buffer of a swapchain image is recorded once per
+//       generation, a new generation starts whenever UI draw data changes.
+//       Reused buffers keep reading the vertex data ImGui backend uploaded
+//       when they were recorded
+uint64_t imgui_draw_hash;
+uint64_t imgui_generation = 1;
+std::vector<uint64_t> imgui_recorded_generation;
+bool imgui_reused;
+
 VkFormat vk_image_depth_format;
 VkImage vk_image_depth;
 VkDeviceMemory vk_image_depth_memory;
 VkImageView vk_image_depth_view;
+VkRenderPass vk_render_pass_load;
 
 VkRenderPass vk_render_pass;
 std::vector<VkFramebuffer> vk_framebuffers;
@@ -64,14 +99,156 @@ uint32_t vk_current_frame;
 VkCommandPool vk_command_pool;
 std::vector<VkCommandBuffer> vk_command_buffers;
 
+veekay::MemoryTracker memory_tracker;
+veekay::PipelineRegistry pipeline_registry;
+
+// NOTE: Readback buffers beyond frames in flight give writer thread slack
+//       before frames start getting dropped
+constexpr uint32_t capture_extra_buffers = 2;
+
+bool vk_swapchain_readable;
+veekay::FrameCapture frame_capture;
+
+veekay::Clock clock;
+veekay::InputReplay input_replay;
+
+veekay::JobSystem job_system;
+veekay::ResourceLoader resource_loader;
+veekay::DescriptorAllocator descriptor_allocator;
+
+veekay::FramePacer frame_pacer;
+
+// NOTE: Simulation thread keeps its own clock, main clock drives frames
+std::thread simulation_thread;
+std::atomic<bool> simulation_running;
+veekay::Clock simulation_clock;
+
+void simulationLoop(veekay::UpdateFunc update, double rate) {
+	using namespace std::chrono;
+
+	veekay::app = &application;
+	VEEKAY_PROFILE_THREAD("Simulation");
+
+	const auto period = duration_cast<steady_clock::duration>(
+		duration<double>((rate > 0.0) ? 1.0 / rate : 0.0));
+	auto next = steady_clock::now();
+
+	while (simulation_running.load(std::memory_order_acquire)) {
+		simulation_clock.advance(glfwGetTime());
+
+		{
+			VEEKAY_PROFILE_SCOPE("Update");
+			update(simulation_clock.time());
+		}
+
+		if (rate <= 0.0) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		// NOTE: Keeps steady rate, doesn't try to catch up after a stall
+		next += period;
+		const auto now = steady_clock::now();
+		if (next < now) {
+			next = now;
+		} else {
+			std::this_thread::sleep_until(next);
+		}
+	}
+}
+
+
+// NOTE: Word at a time, UI vertex data takes tens of kilobytes
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), bytes += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		hash = (hash ^ word) * 0x100000001b3ull;
+		hash ^= hash >> 29;
+	}
+
+	for (; size != 0; --size, ++bytes) {
+		hash = (hash ^ *bytes) * 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+uint64_t hashDrawData(const ImDrawData* data) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	hash = hashBytes(hash, &data->DisplayPos, sizeof(data->DisplayPos));
+	hash = hashBytes(hash, &data->DisplaySize, sizeof(data->DisplaySize));
+	hash = hashBytes(hash, &data->FramebufferScale, sizeof(data->FramebufferScale));
+
+	for (const ImDrawList* list : data->CmdLists) {
+		hash = hashBytes(hash, list->VtxBuffer.Data, list->VtxBuffer.size_in_bytes());
+		hash = hashBytes(hash, list->IdxBuffer.Data, list->IdxBuffer.size_in_bytes());
+
+		for (const ImDrawCmd& cmd : list->CmdBuffer) {
+			const uint64_t fields[] = {
+				reinterpret_cast<uint64_t>(cmd.TexRef._TexData),
+				static_cast<uint64_t>(cmd.TexRef._TexID),
+				cmd.VtxOffset,
+				cmd.IdxOffset,
+				cmd.ElemCount,
+				reinterpret_cast<uint64_t>(cmd.UserCallback),
+			};
+
+			hash = hashBytes(hash, &cmd.ClipRect, sizeof(cmd.ClipRect));
+			hash = hashBytes(hash, fields, sizeof(fields));
+		}
+	}
+
+	return hash;
+}
+
+// NOTE: Font atlas and user textures are uploaded by the backend while it
+//       renders draw data, pending ones force overlay to be re-recorded
+bool texturesPending(const ImDrawData* data) {
+	if (data->Textures) {
+		for (const ImTextureData* texture : *data->Textures) {
+			if (texture->Status != ImTextureStatus_OK) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
 
 } // namespace
 
-// NOTE: Global application state definition
-veekay::Application veekay::app;
+thread_local veekay::Application* veekay::app = nullptr;
+
+void veekay::renderOverlay(VkCommandBuffer cmd) {
+	if (overlay_mode != veekay::OverlayMode::app_pass) {
+		return;
+	}
+
+	// NOTE: No ImGui frame is built for tiles, UI isn't part of the image
+	if (veekay::app->tile.active) {
+		return;
+	}
+
+	// NOTE: Commands of app's pass are recorded anew every frame, so only
+	//       hidden UI is skipped here
+	ImDrawData* draw_data = ImGui::GetDrawData();
+	if (draw_data->TotalVtxCount == 0 && !texturesPending(draw_data)) {
+		return;
+	}
+
+	ImGui_ImplVulkan_RenderDrawData(draw_data, cmd);
+}
 
-int veekay::run(const veekay::ApplicationInfo& app_info) {
-	veekay::app.running = true;
+int veekay::run(const veekay::ApplicationInfo& app_info, const veekay::ApplicationConfig& config) {
+	veekay::app = &application;
+	veekay::app->running = true;
+	veekay::app->simulation_threaded = config.simulation_thread;
+	overlay_mode = app_info.overlay_mode;
+	frames_in_flight = std::clamp(config.frames_in_flight, 1u, max_frames_in_flight);
 	
 	if (!glfwInit()) {
 		std::cerr << "Failed to initialize GLFW\n";
@@ -85,7 +262,12 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 	glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE);
 #endif
 
-	window = glfwCreateWindow(window_default_width, window_default_height,
+	// NOTE: Tiled rendering is headless, swapchain still needs a surface
+	if (!config.tiled_output.empty()) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
+	window = glfwCreateWindow(config.window_width, config.window_height,
 	                          window_title, nullptr, nullptr);
 	if (!window) {
 		std::cerr << "Failed to create GLFW window\n";
@@ -94,63 +276,45 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 
 	int framebuffer_width = 0, framebuffer_height = 0;
 	glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
-	veekay::app.window_width = static_cast<uint32_t>(framebuffer_width);
-	veekay::app.window_height = static_cast<uint32_t>(framebuffer_height);
+	veekay::app->window_width = static_cast<uint32_t>(framebuffer_width);
+	veekay::app->window_height = static_cast<uint32_t>(framebuffer_height);
 
 	{ // NOTE: Initialize Vulkan: grab device and create swapchain
-		vkb::InstanceBuilder instance_builder;
-
-		auto builder_result = instance_builder.require_api_version(1, 2, 0)
-		                                      .request_validation_layers()
-		                                      .use_default_debug_messenger()
-		                                      .build();
-		if (!builder_result) {
-			std::cerr << builder_result.error().message() << '\n';
-			return 1;
-		}
-
-		auto instance = builder_result.value();
+		auto create_surface = [](VkInstance instance, VkSurfaceKHR* surface) {
+			if (glfwCreateWindowSurface(instance, window, nullptr, surface) != VK_SUCCESS) {
+				const char* message;
+				glfwGetError(&message);
+				std::cerr << message << '\n';
+				return false;
+			}
 
-		vk_instance = instance.instance;
-		vk_debug_messenger = instance.debug_messenger;
+			return true;
+		};
 
-		if (glfwCreateWindowSurface(vk_instance, window, nullptr, &vk_surface) != VK_SUCCESS) {
-			const char* message;
-			glfwGetError(&message);
-			std::cerr << message << '\n';
-			return 1;
-		}
+		const bool created = veekay::createDevice(config, create_surface, 1, vk_device_setup);
 
-		vkb::PhysicalDeviceSelector physical_device_selector(instance);
+		vk_instance = vk_device_setup.instance;
+		vk_surface = vk_device_setup.surface;
+		vk_physical_device = vk_device_setup.physical_device;
+		vk_device = vk_device_setup.device;
 
-		auto selector_result = physical_device_selector.set_surface(vk_surface)
-		                                               .select();
-		if (!selector_result) {
-			std::cerr << selector_result.error().message() << '\n';
+		if (!created) {
 			return 1;
 		}
 
-		auto physical_device = selector_result.value();
-
-		{
-			vkb::DeviceBuilder device_builder(physical_device);
-
-			auto result = device_builder.build();
+		vk_graphics_queue_family = vk_device_setup.graphics_queue_family;
+		vkGetDeviceQueue(vk_device, vk_graphics_queue_family, 0, &vk_graphics_queue);
 
-			if (!result) {
-				std::cerr << result.error().message() << '\n';
-				return 1;
-			}
+		{ // NOTE: Frame capture copies out of swapchain images
+			VkSurfaceCapabilitiesKHR capabilities;
+			vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vk_physical_device, vk_surface, &capabilities);
 
-			auto device = result.value();
-
-			vk_device = device.device;
-			vk_physical_device = device.physical_device;
+			vk_swapchain_readable = capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		}
 
-			auto queue_type = vkb::QueueType::graphics;
-			
-			vk_graphics_queue = device.get_queue(queue_type).value();
-			vk_graphics_queue_family = device.get_queue_index(queue_type).value();
+		VkImageUsageFlags swapchain_usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		if (vk_swapchain_readable) {
+			swapchain_usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 		}
 
 		vkb::SwapchainBuilder swapchain_builder(vk_physical_device, vk_device, vk_surface);
@@ -163,9 +327,9 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		};
 
 		auto swapchain_result = swapchain_builder.set_desired_format(surface_format)
-		                                         .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
-		                                         .set_desired_extent(veekay::app.window_width, veekay::app.window_height)
-		                                         .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+		                                         .set_desired_present_mode(config.present_mode)
+		                                         .set_desired_extent(veekay::app->window_width, veekay::app->window_height)
+		                                         .add_image_usage_flags(swapchain_usage)
 		                                         .build();
 
 		if (!swapchain_result) {
@@ -176,11 +340,57 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		auto swapchain = swapchain_result.value();
 
 		vk_swapchain = swapchain.swapchain;
+		vk_swapchain_format = swapchain.image_format;
 		vk_swapchain_images = swapchain.get_images().value();
 		vk_swapchain_image_views = swapchain.get_image_views().value();
 
-		veekay::app.vk_device = vk_device;
-		veekay::app.vk_physical_device = vk_physical_device;
+		veekay::app->vk_device = vk_device;
+		veekay::app->vk_physical_device = vk_physical_device;
+		veekay::app->vk_graphics_queue = vk_graphics_queue;
+		veekay::app->vk_graphics_queue_family = vk_graphics_queue_family;
+		veekay::app->draw_indirect_count = vk_device_setup.draw_indirect_count;
+		veekay::app->mesh_shader = vk_device_setup.mesh_shader;
+		veekay::app->frames_in_flight = frames_in_flight;
+
+		memory_tracker.initialize(vk_physical_device, vk_device, vk_device_setup.memory_budget,
+		                          config.memory_budget, config.memory_budget_policy);
+		veekay::app->memory = &memory_tracker;
+
+		PFN_vkWaitForPresentKHR wait_for_present = nullptr;
+		if (vk_device_setup.present_wait) {
+			wait_for_present = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+				vkGetDeviceProcAddr(vk_device, "vkWaitForPresentKHR"));
+		}
+
+		frame_pacer.initialize(vk_device, vk_swapchain, config.frame_limit, wait_for_present);
+		veekay::app->frame_stats = &frame_pacer.stats();
+	}
+
+	{ // NOTE: Create pipeline registry
+		if (!pipeline_registry.initialize(vk_device)) {
+			return 1;
+		}
+
+		veekay::app->pipelines = &pipeline_registry;
+	}
+
+	{ // NOTE: Create descriptor allocator
+		if (!descriptor_allocator.initialize(vk_device, frames_in_flight)) {
+			return 1;
+		}
+
+		veekay::app->descriptors = &descriptor_allocator;
+	}
+
+	{ // NOTE: Create frame capture
+		veekay::app->capture = nullptr;
+
+		if (vk_swapchain_readable &&
+		    frame_capture.initialize(vk_swapchain_format, veekay::app->window_width,
+		                             veekay::app->window_height,
+		                             frames_in_flight + capture_extra_buffers)) {
+			veekay::app->capture = &frame_capture;
+		}
 	}
 
 	{ // NOTE: ImGui initialization
@@ -217,7 +427,7 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			}
 		}
 
-		{
+		if (overlay_mode == veekay::OverlayMode::separate_pass) {
 			VkAttachmentDescription attachment{
 				.format = vk_swapchain_format,
 				.samples = VK_SAMPLE_COUNT_1_BIT,
@@ -265,13 +475,13 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			}
 		}
 
-		{
+		if (overlay_mode == veekay::OverlayMode::separate_pass) {
 			VkFramebufferCreateInfo info{
 				.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
 				.renderPass = imgui_render_pass,
 				.attachmentCount = 1,
-				.width = veekay::app.window_width,
-				.height = veekay::app.window_height,
+				.width = veekay::app->window_width,
+				.height = veekay::app->window_height,
 				.layers = 1,
 			};
 
@@ -288,10 +498,11 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			}
 		}
 
-		{
+		if (overlay_mode == veekay::OverlayMode::separate_pass) {
 			size_t count = imgui_framebuffers.size();
 
 			imgui_command_buffers.resize(count);
+			imgui_recorded_generation.assign(count, 0);
 
 			{
 				VkCommandPoolCreateInfo info{
@@ -321,39 +532,11 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			}
 		}
 
-		ImGui_ImplVulkan_InitInfo info{
-			.Instance = vk_instance,
-			.PhysicalDevice = vk_physical_device,
-			.Device = vk_device,
-			.QueueFamily = vk_graphics_queue_family,
-			.Queue = vk_graphics_queue,
-			.DescriptorPool = imgui_descriptor_pool,
-			.MinImageCount = static_cast<uint32_t>(vk_swapchain_images.size()),
-			.ImageCount = static_cast<uint32_t>(vk_swapchain_images.size()),
-			.RenderPass = imgui_render_pass,
-		};
-
-		ImGui_ImplVulkan_Init(&info);
 	}
 
-	{
-		VkFormat candidates[] = {
-			VK_FORMAT_D32_SFLOAT,
-			VK_FORMAT_D32_SFLOAT_S8_UINT,
-			VK_FORMAT_D24_UNORM_S8_UINT,
-		};
-
-		vk_image_depth_format = VK_FORMAT_UNDEFINED;
-
-		for (const auto& f : candidates) {
-			VkFormatProperties properties;
-			vkGetPhysicalDeviceFormatProperties(vk_physical_device, f, &properties);
-
-			if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
-				vk_image_depth_format = f;
-				break;
-			}
-		}
+	vk_image_depth_format = veekay::pickDepthFormat(vk_physical_device, config, config.depth_sampled);
+	if (vk_image_depth_format == VK_FORMAT_UNDEFINED) {
+		return 1;
 	}
 
 	{ // NOTE: Create depth buffer
@@ -361,12 +544,16 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
 			.imageType = VK_IMAGE_TYPE_2D,
 			.format = vk_image_depth_format,
-			.extent = {veekay::app.window_width, veekay::app.window_height, 1},
+			.extent = {veekay::app->window_width, veekay::app->window_height, 1},
 			.mipLevels = 1,
 			.arrayLayers = 1,
 			.samples = VK_SAMPLE_COUNT_1_BIT,
 			.tiling = VK_IMAGE_TILING_OPTIMAL,
-			.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			// NOTE: Unless sampled, depth never leaves the render pass and
+			//       tilers may keep it on-chip
+			.usage = config.depth_sampled ?
+			         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT :
+			         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
 		};
 
 		if (vkCreateImage(vk_device, &info, nullptr, &vk_image_depth) != VK_SUCCESS) {
@@ -379,32 +566,16 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		VkMemoryRequirements requirements;
 		vkGetImageMemoryRequirements(vk_device, vk_image_depth, &requirements);
 
-		VkPhysicalDeviceMemoryProperties properties;
-		vkGetPhysicalDeviceMemoryProperties(vk_physical_device, &properties);
-
-		uint32_t index = UINT_MAX;
-		for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
-			const VkMemoryType& type = properties.memoryTypes[i];
-
-			if ((requirements.memoryTypeBits & (1 << i)) &&
-			    (type.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
-				index = i;
-				break;
-			}
-		}
-
-		if (index == UINT_MAX) {
-			std::cerr << "Failed to find required memory type for Vulkan depth image\n";
-			return 1;
-		}
-
-		VkMemoryAllocateInfo info = {
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = requirements.size,
-			.memoryTypeIndex = index,
-		};
+		// NOTE: Transient depth prefers lazily allocated memory, physical
+		//       backing for it may then never be committed
+		const VkMemoryPropertyFlags preferred = config.depth_sampled ?
+		                                        0 : VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
 
-		if (vkAllocateMemory(vk_device, &info, nullptr, &vk_image_depth_memory) != VK_SUCCESS) {
+		vk_image_depth_memory = veekay::allocateMemory(requirements,
+		                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                               veekay::MemoryCategory::image,
+		                                               preferred);
+		if (!vk_image_depth_memory) {
 			std::cerr << "Failed to allocate memory for Vulkan depth image\n";
 			return 1;
 		}
@@ -436,82 +607,46 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		}
 	}
 
-	{ // NOTE: Create render pass
-		VkAttachmentDescription color_attachment{
-			.format = vk_swapchain_format,
-
-			.samples = VK_SAMPLE_COUNT_1_BIT,
-
-			.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-
-			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-
-			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-		};
-
-		VkAttachmentDescription depth_attachment{
-			.format = vk_image_depth_format,
-			.samples = VK_SAMPLE_COUNT_1_BIT,
-			.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-		};
-
-		VkAttachmentReference color_ref{
-			.attachment = 0,
-			.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		};
-
-		VkAttachmentReference depth_ref{
-			.attachment = 1,
-			.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-		};
-
-		VkSubpassDescription subpass{
-			.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-			.colorAttachmentCount = 1,
-			.pColorAttachments = &color_ref,
-			.pDepthStencilAttachment = &depth_ref,
-		};
-
-		VkAttachmentDescription attachments[] = {color_attachment, depth_attachment};
-
-		VkSubpassDependency dependency{
-			.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-			                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-			.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-			                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-			.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-			.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-			                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-			.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
-		};
+	{ // NOTE: Create render pass, depth is kept for shaders when sampled
+		vk_render_pass = veekay::createRenderPass(vk_device, vk_swapchain_format,
+		                                          VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		                                          vk_image_depth_format, config.depth_sampled);
+		if (!vk_render_pass) {
+			return 1;
+		}
 
-		VkRenderPassCreateInfo info{
-			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+		veekay::app->vk_render_pass = vk_render_pass;
 
-			.attachmentCount = 2,
-			.pAttachments = attachments,
+		if (config.depth_sampled) { // NOTE: Same pass continuing earlier one
+			vk_render_pass_load = veekay::createRenderPass(vk_device, vk_swapchain_format,
+			                                               VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			                                               vk_image_depth_format, true, true);
+			if (!vk_render_pass_load) {
+				return 1;
+			}
+		}
 
-			.subpassCount = 1,
-			.pSubpasses = &subpass,
+		veekay::app->vk_depth_image = config.depth_sampled ? vk_image_depth : VK_NULL_HANDLE;
+		veekay::app->vk_depth_format = vk_image_depth_format;
+		veekay::app->vk_render_pass_load = vk_render_pass_load;
+	}
 
-			.dependencyCount = 1,
-			.pDependencies = &dependency,
+	{ // NOTE: Initialize ImGui Vulkan backend for the pass overlay is drawn in
+		ImGui_ImplVulkan_InitInfo info{
+			.Instance = vk_instance,
+			.PhysicalDevice = vk_physical_device,
+			.Device = vk_device,
+			.QueueFamily = vk_graphics_queue_family,
+			.Queue = vk_graphics_queue,
+			.DescriptorPool = imgui_descriptor_pool,
+			.MinImageCount = static_cast<uint32_t>(vk_swapchain_images.size()),
+			.ImageCount = static_cast<uint32_t>(vk_swapchain_images.size()),
 		};
 
-		if (vkCreateRenderPass(vk_device, &info, nullptr, &vk_render_pass) != VK_SUCCESS) {
-			std::cerr << "Failed to create render pass\n";
-			return 1;
-		}
+		info.RenderPass = (overlay_mode == veekay::OverlayMode::app_pass) ?
+		                  vk_render_pass : imgui_render_pass;
 
-		veekay::app.vk_render_pass = vk_render_pass;
+		ImGui_ImplVulkan_Init(&info);
 	}
 
 	{ // NOTE: Create framebuffer objects from swapchain images
@@ -525,8 +660,8 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			.attachmentCount = 2,
 			.pAttachments = attachments,
 
-			.width = veekay::app.window_width,
-			.height = veekay::app.window_height,
+			.width = veekay::app->window_width,
+			.height = veekay::app->window_height,
 			.layers = 1,
 		};
 
@@ -559,10 +694,10 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			vkCreateSemaphore(vk_device, &sem_info, nullptr, &vk_present_semaphores[i]);
 		}
 
-		vk_render_semaphores.resize(max_frames_in_flight);
-		vk_in_flight_fences.resize(max_frames_in_flight);
+		vk_render_semaphores.resize(frames_in_flight);
+		vk_in_flight_fences.resize(frames_in_flight);
 
-		for (uint32_t i = 0; i < max_frames_in_flight; ++i) {
+		for (uint32_t i = 0; i < frames_in_flight; ++i) {
 			vkCreateSemaphore(vk_device, &sem_info, nullptr, &vk_render_semaphores[i]);
 			vkCreateFence(vk_device, &fence_info, nullptr, &vk_in_flight_fences[i]);
 		}
@@ -597,77 +732,256 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		}
 	}
 
-	app_info.init();
+	if (!config.profile_output.empty()) {
+#if !defined(VEEKAY_PROFILER)
+		std::cerr << "Profiler zones are compiled out, configure with -DVEEKAY_PROFILER=ON\n";
+#endif
+		VEEKAY_PROFILE_THREAD("Main");
+		veekay::setProfilerEnabled(true);
+	}
+
+	if (!job_system.initialize(config.worker_threads)) {
+		return 1;
+	}
+	veekay::app->jobs = &job_system;
+
+	if (!resource_loader.initialize()) {
+		return 1;
+	}
+	veekay::app->loader = &resource_loader;
+
+	{
+		VEEKAY_PROFILE_SCOPE("Init");
+		app_info.init();
+	}
+
+	{ // NOTE: Start clock and input recording or playback
+		clock.reset(config.clock_mode, config.clock_step, glfwGetTime());
+		veekay::app->clock = &clock;
+
+		if (!config.playback_input.empty()) {
+			if (!input_replay.startPlayback(config.playback_input.c_str())) {
+				veekay::app->running = false;
+			}
+		} else if (!config.record_input.empty()) {
+			input_replay.startRecording(config.record_input.c_str());
+		}
+	}
+
+	if (veekay::app->simulation_threaded) {
+		if (!config.playback_input.empty() || !config.record_input.empty()) {
+			std::cerr << "Simulation thread runs on wall time, replay won't reproduce update() exactly\n";
+		}
+
+		simulation_clock.reset(config.clock_mode, config.clock_step, glfwGetTime());
+		simulation_running.store(true, std::memory_order_release);
+		simulation_thread = std::thread(simulationLoop, app_info.update, config.simulation_rate);
+	}
+
+	int exit_code = 0;
+
+	if (!config.tiled_output.empty() && veekay::app->running) {
+		VEEKAY_PROFILE_SCOPE("Tiled render");
+
+		if (!veekay::renderTiledFrames(app_info, config, vk_swapchain_format, vk_image_depth_format,
+		                               vk_render_pass, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, glfwGetTime)) {
+			exit_code = 1;
+		}
+
+		veekay::app->running = false;
+	}
+
+	// NOTE: Wait until the previous frame in this slot finishes
+	auto wait_for_frame = [&] {
+		VEEKAY_PROFILE_SCOPE("Wait for fence");
+		vkWaitForFences(vk_device, 1, &vk_in_flight_fences[vk_current_frame], true, UINT64_MAX);
+		vkResetFences(vk_device, 1, &vk_in_flight_fences[vk_current_frame]);
+
+		// NOTE: One more frame retired for buffers waiting to be destroyed
+		veekay::collectDeferredBuffers();
+
+		// NOTE: Transient descriptor sets of this slot are no longer in use
+		descriptor_allocator.reset(vk_current_frame);
+	};
+
+	while (veekay::app->running && !glfwWindowShouldClose(window)) {
+		VEEKAY_PROFILE_SCOPE("Frame");
+
+		if (config.low_latency) {
+			wait_for_frame();
+		}
+
+		frame_pacer.limit();
+
+		{
+			VEEKAY_PROFILE_SCOPE("Poll events");
+			glfwPollEvents();
+			frame_pacer.inputSampled();
+		}
+
+		clock.advance(glfwGetTime());
 
-	while (veekay::app.running && !glfwWindowShouldClose(window)) {
-		glfwPollEvents();
-		double time = glfwGetTime();
+		veekay::app->frame_index = vk_current_frame;
 
 		ImGui_ImplVulkan_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
+
+		// NOTE: ImGui animations and timers follow fixed frame clock too
+		if (clock.mode() == veekay::ClockMode::fixed_frame) {
+			ImGui::GetIO().DeltaTime = static_cast<float>(clock.delta());
+		}
+
+		if (!input_replay.frame(clock)) {
+			break;
+		}
+
+		// NOTE: Loads completing here are visible to ui() and render()
+		//       of this frame
+		resource_loader.poll();
+
 		ImGui::NewFrame();
 
-		app_info.update(time);
+		if (app_info.ui) {
+			VEEKAY_PROFILE_SCOPE("UI");
+			app_info.ui();
+		}
 
-		ImGui::Render();
+		if (!veekay::app->simulation_threaded) {
+			VEEKAY_PROFILE_SCOPE("Update");
+			app_info.update(clock.time());
+		}
 
-		// NOTE: Wait until the previous frame finishes
-		vkWaitForFences(vk_device, 1, &vk_in_flight_fences[vk_current_frame], true, UINT64_MAX);
-		vkResetFences(vk_device, 1, &vk_in_flight_fences[vk_current_frame]);
+		{
+			VEEKAY_PROFILE_SCOPE("ImGui render");
+			ImGui::Render();
+		}
+
+		if (!config.low_latency) {
+			wait_for_frame();
+		}
+
+		if (veekay::app->capture) {
+			frame_capture.retire(vk_current_frame);
+		}
 
 		// NOTE: Get current swapchain framebuffer index
 		uint32_t swapchain_image_index = 0;
-		vkAcquireNextImageKHR(vk_device, vk_swapchain, UINT64_MAX,
-		                      vk_render_semaphores[vk_current_frame],
-		                      nullptr, &swapchain_image_index);
+		{
+			VEEKAY_PROFILE_SCOPE("Acquire");
+			vkAcquireNextImageKHR(vk_device, vk_swapchain, UINT64_MAX,
+			                      vk_render_semaphores[vk_current_frame],
+			                      nullptr, &swapchain_image_index);
+		}
 
 		VkCommandBuffer cmd = vk_command_buffers[swapchain_image_index];
 
-		app_info.render(cmd, vk_framebuffers[swapchain_image_index]);
+		{
+			VEEKAY_PROFILE_SCOPE("Render");
+			app_info.render(cmd, vk_framebuffers[swapchain_image_index]);
+		}
+
+		VkCommandBuffer imgui_cmd = VK_NULL_HANDLE;
+		ImDrawData* draw_data = ImGui::GetDrawData();
+
+		// NOTE: Nothing to draw when UI is hidden
+		if (overlay_mode == veekay::OverlayMode::separate_pass &&
+		    (draw_data->TotalVtxCount != 0 || texturesPending(draw_data))) {
+			VEEKAY_PROFILE_SCOPE("Overlay");
+
+			imgui_cmd = imgui_command_buffers[swapchain_image_index];
+
+			const uint64_t hash = hashDrawData(draw_data);
+			if (hash != imgui_draw_hash || texturesPending(draw_data)) {
+				imgui_draw_hash = hash;
+				++imgui_generation;
+
+				// NOTE: Backend cycles its vertex buffers assuming each one was
+				//       last read a full cycle of frames ago. Reused command
+				//       buffers break that, so before rewriting let frames
+				//       submitted meanwhile finish. Happens once per change
+				//       that follows a static UI
+				if (imgui_reused) {
+					VEEKAY_PROFILE_SCOPE("Wait for overlay");
+
+					std::vector<VkFence> fences;
+					for (uint32_t i = 0; i < frames_in_flight; ++i) {
+						if (i != vk_current_frame) {
+							fences.push_back(vk_in_flight_fences[i]);
+						}
+					}
+
+					if (!fences.empty()) {
+						vkWaitForFences(vk_device, static_cast<uint32_t>(fences.size()),
+						                fences.data(), true, UINT64_MAX);
+					}
+
+					imgui_reused = false;
+				}
+			}
 
-		VkCommandBuffer imgui_cmd = imgui_command_buffers[swapchain_image_index];
-		{ // NOTE: Draw ImGui
-			vkResetCommandBuffer(imgui_cmd, 0);
+			if (imgui_recorded_generation[swapchain_image_index] == imgui_generation) {
+				imgui_reused = true;
+			} else {
+				imgui_recorded_generation[swapchain_image_index] = imgui_generation;
 
-			{
-				VkCommandBufferBeginInfo info{
-					.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-					.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-				};
+				vkResetCommandBuffer(imgui_cmd, 0);
 
-				vkBeginCommandBuffer(imgui_cmd, &info);
-			}
+				{
+					VkCommandBufferBeginInfo info{
+						.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+					};
 
-			{
-				VkRenderPassBeginInfo info{
-					.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-					.renderPass = imgui_render_pass,
-					.framebuffer = imgui_framebuffers[swapchain_image_index],
-					.renderArea = {
-						.extent = {veekay::app.window_width, veekay::app.window_height},
-					},
-				};
+					vkBeginCommandBuffer(imgui_cmd, &info);
+				}
 
-				vkCmdBeginRenderPass(imgui_cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
-			}
+				{
+					VkRenderPassBeginInfo info{
+						.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+						.renderPass = imgui_render_pass,
+						.framebuffer = imgui_framebuffers[swapchain_image_index],
+						.renderArea = {
+							.extent = {veekay::app->window_width, veekay::app->window_height},
+						},
+					};
+
+					vkCmdBeginRenderPass(imgui_cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
+				}
+
+				ImGui_ImplVulkan_RenderDrawData(draw_data, imgui_cmd);
 
-			ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), imgui_cmd);
+				vkCmdEndRenderPass(imgui_cmd);
+				vkEndCommandBuffer(imgui_cmd);
+			}
+		}
 
-			vkCmdEndRenderPass(imgui_cmd);
-			vkEndCommandBuffer(imgui_cmd);
+		VkCommandBuffer capture_cmd = VK_NULL_HANDLE;
+		if (veekay::app->capture) { // NOTE: Copy finished frame out for capture
+			capture_cmd = frame_capture.record(vk_current_frame,
+			                                   vk_swapchain_images[swapchain_image_index]);
 		}
 
 		{ // NOTE: Submit commands to graphics queue
+			VEEKAY_PROFILE_SCOPE("Submit");
+
 			VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
-			VkCommandBuffer buffers[] = { cmd, imgui_cmd };
+			VkCommandBuffer buffers[3] = { cmd };
+			uint32_t buffer_count = 1;
+
+			if (imgui_cmd != VK_NULL_HANDLE) {
+				buffers[buffer_count++] = imgui_cmd;
+			}
+
+			if (capture_cmd != VK_NULL_HANDLE) {
+				buffers[buffer_count++] = capture_cmd;
+			}
 
 			VkSubmitInfo info{
 				.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
 				.waitSemaphoreCount = 1,
 				.pWaitSemaphores = &vk_render_semaphores[vk_current_frame],
 				.pWaitDstStageMask = &wait_stage,
-				.commandBufferCount = 2,
+				.commandBufferCount = buffer_count,
 				.pCommandBuffers = buffers,
 				.signalSemaphoreCount = 1,
 				.pSignalSemaphores = &vk_present_semaphores[swapchain_image_index],
@@ -677,8 +991,19 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		}
 
 		{ // NOTE: Present renderer frame
+			VEEKAY_PROFILE_SCOPE("Present");
+
+			const uint64_t present_id = frame_pacer.presentSubmitted();
+
+			VkPresentIdKHR id_info{
+				.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+				.swapchainCount = 1,
+				.pPresentIds = &present_id,
+			};
+
 			VkPresentInfoKHR info{
 				.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+				.pNext = present_id ? &id_info : nullptr,
 				.waitSemaphoreCount = 1,
 				.pWaitSemaphores = &vk_present_semaphores[swapchain_image_index],
 				.swapchainCount = 1,
@@ -688,13 +1013,42 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 
 			vkQueuePresentKHR(vk_graphics_queue, &info);
 
-			vk_current_frame = (vk_current_frame + 1) % max_frames_in_flight;
+			vk_current_frame = (vk_current_frame + 1) % frames_in_flight;
 		}
 	}
 
+	if (veekay::app->simulation_threaded) {
+		simulation_running.store(false, std::memory_order_release);
+		simulation_thread.join();
+	}
+
 	vkDeviceWaitIdle(vk_device);
 
-	app_info.shutdown();
+	frame_pacer.destroy();
+
+	// NOTE: Loader thread must not touch app resources during shutdown()
+	resource_loader.destroy();
+
+	{
+		VEEKAY_PROFILE_SCOPE("Shutdown");
+		app_info.shutdown();
+	}
+
+	veekay::collectDeferredBuffers(true);
+
+	job_system.destroy();
+
+	if (!config.profile_output.empty()) {
+		veekay::setProfilerEnabled(false);
+		veekay::writeProfilerTrace(config.profile_output.c_str());
+	}
+
+	if (veekay::app->capture) {
+		frame_capture.destroy();
+	}
+
+	pipeline_registry.destroy();
+	descriptor_allocator.destroy();
 
 	vkDestroyCommandPool(vk_device, vk_command_pool, nullptr);
 
@@ -702,26 +1056,36 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		vkDestroySemaphore(vk_device, vk_present_semaphores[i], nullptr);
 	}
 
-	for (size_t i = 0; i < max_frames_in_flight; ++i) {
+	for (size_t i = 0; i < frames_in_flight; ++i) {
 		vkDestroySemaphore(vk_device, vk_render_semaphores[i], nullptr);
 		vkDestroyFence(vk_device, vk_in_flight_fences[i], nullptr);
 	}
 	
 	vkDestroyRenderPass(vk_device, vk_render_pass, nullptr);
+	if (vk_render_pass_load) {
+		vkDestroyRenderPass(vk_device, vk_render_pass_load, nullptr);
+	}
 
 	vkDestroyImageView(vk_device, vk_image_depth_view, nullptr);
-	vkFreeMemory(vk_device, vk_image_depth_memory, nullptr);
+	veekay::freeMemory(vk_image_depth_memory);
 	vkDestroyImage(vk_device, vk_image_depth, nullptr);
 
-	vkDestroyCommandPool(vk_device, imgui_command_pool, nullptr);
-	vkDestroyRenderPass(vk_device, imgui_render_pass, nullptr);
+	if (overlay_mode == veekay::OverlayMode::separate_pass) {
+		vkDestroyCommandPool(vk_device, imgui_command_pool, nullptr);
+		vkDestroyRenderPass(vk_device, imgui_render_pass, nullptr);
+
+		for (size_t i = 0, e = imgui_framebuffers.size(); i != e; ++i) {
+			vkDestroyFramebuffer(vk_device, imgui_framebuffers[i], nullptr);
+		}
+	}
 
 	for (size_t i = 0, e = vk_framebuffers.size(); i != e; ++i) {
 		vkDestroyFramebuffer(vk_device, vk_framebuffers[i], nullptr);
-		vkDestroyFramebuffer(vk_device, imgui_framebuffers[i], nullptr);
 		vkDestroyImageView(vk_device, vk_swapchain_image_views[i], nullptr);
 	}
 
+	input_replay.stop();
+
 	ImGui_ImplVulkan_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -729,13 +1093,10 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 	vkDestroyDescriptorPool(vk_device, imgui_descriptor_pool, nullptr);
 	
 	vkDestroySwapchainKHR(vk_device, vk_swapchain, nullptr);
-	vkDestroyDevice(vk_device, nullptr);
-	vkDestroySurfaceKHR(vk_instance, vk_surface, nullptr);
-	vkb::destroy_debug_utils_messenger(vk_instance, vk_debug_messenger);
-	vkDestroyInstance(vk_instance, nullptr);
+	veekay::destroyDevice(vk_device_setup);
 
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	
-	return 0;
+	return exit_code;
 }
@@ -0,0 +1,140 @@
+#include <cstdint>
+#include <vector>
+#include <iostream>
+#include <fstream>
+
+#include <veekay/veekay.hpp>
+#include <veekay/context.hpp>
+#include <veekay/gpu_cylinder.hpp>
+
+#include <vulkan/vulkan_core.h>
+
+namespace {
+
+// Сравнивает цилиндр из cylinder.comp с geometry::Cylinder без окна,
+// на своём контексте. Запускается из CTest (lavapipe), код возврата
+// ненулевой при любом расхождении
+
+struct ValidationCase {
+    float radius;
+    float height;
+    uint32_t segments;
+};
+
+// Минимум сегментов, обычный цилиндр, максимум и крупный масштаб,
+// где допуск на позиции растёт вместе с размером
+const ValidationCase validation_cases[] = {
+    {0.5f, 1.0f, 3},
+    {0.5f, 1.0f, 32},
+    {0.25f, 3.0f, 257},
+    {0.5f, 1.0f, 1024},
+    {40.0f, 120.0f, 64},
+};
+
+constexpr uint32_t max_segments = 1024;
+
+VkShaderModule cylinder_shader_module;
+veekay::GpuCylinder gpu_cylinder;
+bool gpu_cylinder_ready = false;
+bool validation_passed = false;
+
+// Загружает скомпилированный SPIR-V шейдер из файла
+VkShaderModule loadShaderModule(const char* path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return nullptr;
+    }
+
+    size_t size = file.tellg();
+    std::vector<uint32_t> buffer(size / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buffer.data()), size);
+    file.close();
+
+    VkShaderModuleCreateInfo info{
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = size,
+        .pCode = buffer.data(),
+    };
+
+    VkShaderModule result;
+    if (vkCreateShaderModule(veekay::app->vk_device, &info, nullptr, &result) != VK_SUCCESS) {
+        return nullptr;
+    }
+
+    return result;
+}
+
+void initialize() {
+    // Кадры не нужны: после проверки контекст сразу переходит к shutdown()
+    veekay::app->running = false;
+
+    cylinder_shader_module = loadShaderModule("./shaders/cylinder.comp.spv");
+    if (!cylinder_shader_module) {
+        std::cerr << "Failed to load Vulkan cylinder generation shader from file\n";
+        return;
+    }
+
+    if (!gpu_cylinder.initialize(cylinder_shader_module, max_segments)) {
+        return;
+    }
+    gpu_cylinder_ready = true;
+
+    validation_passed = true;
+    for (const ValidationCase& c : validation_cases) {
+        if (!gpu_cylinder.validate(c.radius, c.height, c.segments)) {
+            std::cerr << "GPU cylinder of radius " << c.radius << ", height " << c.height
+                      << " and " << c.segments << " segments differs from CPU one\n";
+            validation_passed = false;
+        }
+    }
+}
+
+void shutdown() {
+    if (gpu_cylinder_ready) {
+        gpu_cylinder.destroy();
+    }
+
+    if (cylinder_shader_module) {
+        vkDestroyShaderModule(veekay::app->vk_device, cylinder_shader_module, nullptr);
+    }
+}
+
+void update(double) {}
+
+void render(VkCommandBuffer, VkFramebuffer) {}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    veekay::ApplicationConfig config;
+
+    // Программный рендерер, если он есть: тот же, что и в CI
+    config.device_type = veekay::DeviceType::cpu;
+
+    if (!veekay::parseConfig(argc, argv, config)) {
+        return 1;
+    }
+
+    veekay::Context context;
+    if (!context.initialize(config)) {
+        context.destroy();
+        return 1;
+    }
+
+    const int exit_code = context.run({
+        .init = initialize,
+        .shutdown = shutdown,
+        .update = update,
+        .render = render,
+    }, config);
+
+    context.destroy();
+
+    if (exit_code != 0 || !validation_passed) {
+        return 1;
+    }
+
+    std::cout << "GPU cylinder matches CPU one in all " << std::size(validation_cases) << " cases\n";
+    return 0;
+}
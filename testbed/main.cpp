@@ -7,6 +7,25 @@
 
 #include <veekay/veekay.hpp>
 #include <veekay/Cylinder.hpp>
+#include <veekay/scene.hpp>
+#include <veekay/pipeline.hpp>
+#include <veekay/descriptors.hpp>
+#include <veekay/memory.hpp>
+#include <veekay/material.hpp>
+#include <veekay/geometry_pool.hpp>
+#include <veekay/MeshCache.hpp>
+#include <veekay/capture.hpp>
+#include <veekay/triple_buffer.hpp>
+#include <veekay/pacing.hpp>
+#include <veekay/occlusion.hpp>
+#include <veekay/gpu_cylinder.hpp>
+#include <veekay/dynamic_mesh.hpp>
+#include <veekay/meshlet_renderer.hpp>
+#include <veekay/loader.hpp>
+#include <veekay/tiled.hpp>
+#include <veekay/variants.hpp>
+#include <veekay/clustered.hpp>
+#include <veekay/gpu_timer.hpp>
 
 #include <imgui.h>
 #include <vulkan/vulkan_core.h>
@@ -30,19 +49,15 @@ using Vertex = geometry::Vertex;  // Вершина с позицией и но
 
 // Push-константы передаются в шейдеры напрямую без дескрипторов
 // Это быстрый способ передать небольшой объём данных (до 128 байт обычно)
+// Матрица модели и цвет объекта теперь приходят из буфера инстансов
 struct ShaderConstants {
     Matrix projection;  // Матрица проекции (perspective или orthographic)
     Matrix view;        // Матрица вида (положение и направление камеры)
-    Matrix transform;   // Матрица модели (положение и ориентация объекта)
-    Vector color;       // Цвет объекта (RGB)
 };
 
-// Структура для хранения Vulkan буфера и его памяти
-// Буфер - это область GPU памяти для хранения данных (вершин, индексов и т.д.)
-struct VulkanBuffer {
-    VkBuffer buffer;           // Хэндл буфера
-    VkDeviceMemory memory;     // Хэндл выделенной памяти
-};
+// Буфер GPU памяти из библиотеки veekay (хэндлы буфера, памяти
+// и постоянно отображённый в память CPU указатель)
+using VulkanBuffer = veekay::Buffer;
 
 // Шейдерные модули - скомпилированные SPIR-V программы для GPU
 VkShaderModule vertex_shader_module;    // Вершинный шейдер (обрабатывает каждую вершину)
@@ -53,15 +68,181 @@ VkPipelineLayout pipeline_layout;
 
 // Pipeline - полная конфигурация графического конвейера
 // Включает шейдеры, состояние растеризации, блендинга и т.д.
+// Принадлежит реестру пайплайнов veekay, уничтожается им же
 VkPipeline pipeline;
 
-// Буферы для геометрии цилиндра
-VulkanBuffer vertex_buffer;  // Буфер вершин (координаты и нормали)
-VulkanBuffer index_buffer;   // Буфер индексов (порядок соединения вершин)
+// Геометрия всех мешей лежит в общих буферах вершин и индексов пула,
+// все батчи рисуются одним вызовом vkCmdDrawIndexedIndirect
+veekay::GeometryPool geometry_pool;
+veekay::DrawList draw_list;
+
+// Батч - подряд идущие инстансы сцены с одним мешем
+struct Batch {
+    uint32_t mesh;
+    uint32_t first_instance;
+    uint32_t instance_count;
+};
+
+std::vector<Batch> batches;
+
+// Дисковый кэш мешей: сгенерированные цилиндры сохраняются в бинарные
+// файлы и при следующих запусках отображаются в память через mmap
+geometry::MeshCache mesh_cache("./cache");
+
+// === СЦЕНА ===
+// Трансформации объектов хранятся в veekay::Scene (SoA), матрицы моделей
+// пересчитываются только для изменившихся объектов
+constexpr uint32_t max_instances = 1024;
+
+veekay::Scene* scene = nullptr;
+uint32_t cylinder_object = 0;
+
+// Объекты с меш из пула идут первыми и проходят отсечение, объекты
+// с собственными буферами (основной цилиндр, цилиндр с GPU) - после них
+uint32_t culled_object_count = 0;
+
+// === ОСНОВНОЙ ЦИЛИНДР ===
+// Размеры и число сегментов меняются в GUI. Меш перегенерируется на CPU
+// в тот же geometry::Cylinder (векторы не перевыделяются), у каждого
+// кадра в полёте свои буферы: они переписываются на месте, если хватает
+// ёмкости, иначе растут вдвое, а старые освобождаются после того, как
+// использовавшие их кадры завершатся
+float cylinder_radius = 0.5f;
+float cylinder_height = 2.0f;
+int cylinder_segments = 50;
+geometry::Cylinder cylinder_geometry(0.5f, 2.0f, 50);
+veekay::DynamicMesh cylinder_mesh;
+
+// Буфер инстансов на каждый кадр в полёте, постоянно отображён в память CPU
+std::vector<VulkanBuffer> instance_buffers;
+
+// === ОТСЕЧЕНИЕ ПЕРЕКРЫТЫХ ОБЪЕКТОВ ===
+// Compute-шейдер проверяет сферы инстансов по пирамиде глубины (Hi-Z)
+// и пишет indirect-команды только для видимых. В двухфазном режиме
+// видимые в прошлом кадре рисуются сразу, остальные - после проверки
+// по глубине первой фазы, поэтому открывшиеся объекты не запаздывают
+VkShaderModule pyramid_shader_module;
+VkShaderModule cull_shader_module;
+veekay::OcclusionCuller culler;
+bool occlusion_culling = true;
+bool two_phase_culling = true;
+
+// === ЦИЛИНДР, ГЕНЕРИРУЕМЫЙ НА GPU ===
+// Вершины и индексы пишет compute-шейдер прямо в device-local буферы,
+// CPU данные меша не трогает, поэтому параметры можно менять каждый кадр.
+// Объект сцены создаётся последним и не участвует в отсечении
+VkShaderModule cylinder_shader_module;
+veekay::GpuCylinder gpu_cylinder;
+uint32_t gpu_cylinder_object = 0;
+float gpu_cylinder_radius = 0.4f;
+float gpu_cylinder_height = 1.2f;
+int gpu_cylinder_segments = 256;
+bool gpu_cylinder_pulse = true;     // Радиус пульсирует каждый кадр
+const char* gpu_cylinder_status = "";
+
+// === ОТСЕЧЕНИЕ КЛАСТЕРОВ ===
+// Детализированный цилиндр разбит на кластеры (meshlets) по 64 вершины
+// и 124 треугольника. Compute-шейдер отбрасывает кластеры вне пирамиды
+// видимости и повёрнутые от камеры (по конусу нормалей), остальные
+// рисует mesh-шейдер (VK_EXT_mesh_shader) или, если его нет, обычный
+// вершинный конвейер через indirect-команды на каждый кластер.
+// Меш, кластеры, шейдеры и пайплайны готовятся в потоке загрузчика veekay,
+// окно появляется сразу, а до конца загрузки на месте цилиндра рисуется
+// заглушка с 16 сегментами из общего пула
+VkShaderModule meshlet_cull_shader_module = VK_NULL_HANDLE;
+VkShaderModule meshlet_shader_module = VK_NULL_HANDLE;
+VkPipelineLayout meshlet_pipeline_layout = VK_NULL_HANDLE;
+VkPipeline meshlet_pipeline = VK_NULL_HANDLE;
+veekay::MeshletRenderer meshlets;
+VulkanBuffer meshlet_vertex_buffer{};
+VulkanBuffer meshlet_index_buffer{};
+uint32_t meshlet_index_count = 0;
+bool meshlets_created = false;  // Пишет поток загрузчика, читается после его остановки
+bool meshlets_ready = false;    // Загрузка завершена, копии на GPU выполнены
+uint32_t meshlet_placeholder_mesh = 0;
+uint32_t meshlet_object = 0;
+bool cluster_culling = true;
+
+// === МАТЕРИАЛЫ ===
+// Все параметры материалов лежат в одном storage-буфере, текстуры - в
+// bindless-массиве. Шейдер выбирает материал по ID из данных инстанса
+veekay::MaterialSystem materials;
+uint32_t cylinder_material = 0;
+uint32_t checker_texture = veekay::MaterialSystem::no_texture;
+bool use_texture = false;
+
+// === КЛАСТЕРНОЕ ОСВЕЩЕНИЕ ===
+// Точечные источники лежат в storage-буфере, compute-шейдер раскладывает
+// их по кластерам (16x9 тайлов экрана на 24 среза глубины), фрагментный
+// шейдер перебирает только источники своего кластера. Стресс-тест:
+// стена за сценой и до 4096 источников, летающих перед ней
+constexpr uint32_t max_point_lights = 4096;
+
+VkShaderModule light_cull_shader_module;
+veekay::ClusteredLighting clustered_lighting;
+std::vector<veekay::PointLight> point_lights;
+uint32_t wall_object = 0;
+bool stress_scene = false;
+bool point_lights_changed = true;  // Источники нужно передать заново
+int point_light_count = 1024;
+float point_light_radius = 1.5f;
+bool animate_lights = true;
+
+// Центры, цвета и фазы движения источников, одинаковые в каждом запуске
+struct LightSeed {
+    Vector center;
+    Vector color;
+    float phase;
+    float speed;
+};
+
+std::vector<LightSeed> light_seeds;
 
-// Объект цилиндра и количество его индексов
-geometry::Cylinder* cylinder = nullptr;
-uint32_t cylinder_index_count = 0;
+// Время проходов на GPU по timestamp-запросам
+veekay::GpuTimer gpu_timer;
+
+// === ВАРИАНТЫ ШЕЙДЕРА ===
+// Модель освещения, число источников и отключаемые возможности
+// фрагментного шейдера - специализационные константы. Каждое сочетание -
+// отдельный пайплайн, собранный при первом запросе, в нём нет кода
+// выключенных веток. Пока новый вариант собирается в потоке загрузчика,
+// рисуется прежний
+veekay::VariantCache shading_variants;
+veekay::VariantCache meshlet_variants;  // Заполняет поток загрузчика, до meshlets_ready не трогать
+int lighting_model = 1;                 // 0 - без освещения, 1 - Ламберт, 2 - half-Lambert
+int light_count = 1;                    // Число направленных источников, до 4
+bool shader_textures = true;            // Выборка текстур материалов
+bool hemisphere_ambient = false;        // Фоновое освещение "небо - земля"
+bool background_variants = true;        // Собирать варианты в фоне
+
+// Значения констант в порядке constant_id из shader.frag
+veekay::ShaderVariant shadingVariant() {
+    return {
+        .count = 5,
+        .constants = {
+            uint32_t(lighting_model),
+            uint32_t(light_count),
+            shader_textures ? 1u : 0u,
+            hemisphere_ambient ? 1u : 0u,
+            stress_scene ? 1u : 0u,
+        },
+    };
+}
+
+// Пайплайн текущего варианта или прежний, пока тот не готов. Тайлы
+// ждут сборки, чтобы все части изображения были в одном варианте
+VkPipeline selectVariant(veekay::VariantCache& variants, VkPipeline current) {
+    const veekay::ShaderVariant variant = shadingVariant();
+    const bool background = background_variants && !veekay::app->tile.active;
+    
+    VkPipeline result = background ? variants.requestAsync(variant) : variants.request(variant);
+    return result ? result : current;
+}
+
+// Кэшированные матрицы: пересчитываются только при изменении параметров
+Matrix trajectory_tilt;
+Matrix projection;
+Matrix view;
 
 // === ПАРАМЕТРЫ АНИМАЦИИ ===
 float trajectory_radius = 3.0f;   // Радиус траектории движения
@@ -69,6 +250,24 @@ float animation_speed = 1.0f;     // Скорость анимации
 float animation_time = 0.0f;      // Текущее время анимации
 bool animate = true;              // Флаг: включена ли анимация
 
+// === ОБМЕН СОСТОЯНИЕМ МЕЖДУ ПОТОКАМИ ===
+// update() может работать в отдельном потоке симуляции (--simulation-thread),
+// поэтому параметры из GUI и результат симуляции передаются через тройные
+// буферы без блокировок: каждая сторона видит последнее готовое значение
+struct Controls {
+    float trajectory_radius;
+    float animation_speed;
+    bool animate;
+};
+
+// Снимок состояния, нужного для отрисовки
+struct Snapshot {
+    Vector cylinder_position;
+};
+
+veekay::TripleBuffer<Controls> controls;
+veekay::TripleBuffer<Snapshot> snapshots;
+
 // === ПАРАМЕТРЫ РЕНДЕРИНГА ===
 Vector cylinder_color = {0.3f, 0.7f, 1.0f};  // Цвет цилиндра (голубой)
 bool use_perspective = false;                  // false = ортогональная проекция
@@ -204,321 +403,688 @@ VkShaderModule loadShaderModule(const char* path) {
     };
     
     VkShaderModule result;
-    if (vkCreateShaderModule(veekay::app.vk_device, &info, nullptr, &result) != VK_SUCCESS) {
+    if (vkCreateShaderModule(veekay::app->vk_device, &info, nullptr, &result) != VK_SUCCESS) {
         return nullptr;
     }
     
     return result;
 }
 
-// Создаёт буфер в GPU памяти и копирует в него данные
-// usage - для чего используется буфер (вершины, индексы и т.д.)
-VulkanBuffer createBuffer(size_t size, const void *data, VkBufferUsageFlags usage) {
-    VkDevice& device = veekay::app.vk_device;
-    VkPhysicalDevice& physical_device = veekay::app.vk_physical_device;
+// Пересчитывает матрицу проекции, вызывается только при смене её параметров
+// и для каждого тайла при тайловом рендеринге: соотношение сторон тогда
+// берётся от всего изображения, а проекция сужается до области тайла
+void updateProjection() {
+    const veekay::TileInfo& tile = veekay::app->tile;
+    float aspect = tile.active ? float(tile.image_width) / float(tile.image_height)
+                               : float(veekay::app->window_width) / float(veekay::app->window_height);
     
-    VulkanBuffer result{};
+    if (use_perspective) {
+        // Перспективная проекция: fov = 45°, near = 0.01, far = 100
+        projection = perspective(M_PI / 4.0f, aspect, camera_near_plane, camera_far_plane);
+    } else {
+        // Ортогональная проекция: видимая область 5x5 единиц с учётом aspect ratio
+        float ortho_half_width = 5.0f * aspect;
+        float ortho_half_height = 5.0f;
+        projection = orthographic(-ortho_half_width, ortho_half_width,
+                                  -ortho_half_height, ortho_half_height,
+                                  -10.0f, camera_far_plane);
+    }
     
-    // Шаг 1: Создаём буфер
-    {
-        VkBufferCreateInfo info{
-            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-            .size = size,
-            .usage = usage,
-            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,  // Используется только одной очередью
-        };
+    veekay::tileProjection(&projection.m[0][0]);
+}
+
+// Передаёт меш пула и его ограничивающую сферу (центр габаритного
+// прямоугольника и расстояние до самой дальней вершины) в culler
+void setCullingMesh(uint32_t mesh, const geometry::MappedMesh& data) {
+    const Vertex* vertices = static_cast<const Vertex*>(data.getVerticesData());
+    const uint32_t count = data.getVertexCount();
+    
+    Vector min = vertices[0].position;
+    Vector max = vertices[0].position;
+    for (uint32_t i = 1; i < count; ++i) {
+        const Vector& p = vertices[i].position;
+        min = {fminf(min.x, p.x), fminf(min.y, p.y), fminf(min.z, p.z)};
+        max = {fmaxf(max.x, p.x), fmaxf(max.y, p.y), fmaxf(max.z, p.z)};
+    }
+    
+    const float center[3] = {
+        (min.x + max.x) * 0.5f,
+        (min.y + max.y) * 0.5f,
+        (min.z + max.z) * 0.5f,
+    };
+    
+    float radius_squared = 0.0f;
+    for (uint32_t i = 0; i < count; ++i) {
+        const Vector& p = vertices[i].position;
+        const float dx = p.x - center[0];
+        const float dy = p.y - center[1];
+        const float dz = p.z - center[2];
+        radius_squared = fmaxf(radius_squared, dx * dx + dy * dy + dz * dz);
+    }
+    
+    culler.setMesh(mesh, geometry_pool.mesh(mesh), center, sqrtf(radius_squared));
+}
+
+// Псевдослучайное число в [0, 1) от линейного конгруэнтного генератора,
+// с фиксированным начальным состоянием сцена одинакова в каждом запуске
+float random01(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return float(state >> 8) / float(1u << 24);
+}
+
+// Центры источников - в слое перед стеной, цвета - по кругу оттенков
+void seedPointLights() {
+    uint32_t state = 12345u;
+    light_seeds.resize(max_point_lights);
+    
+    for (LightSeed& seed : light_seeds) {
+        seed.center = {-9.0f + 18.0f * random01(state),
+                       -5.0f + 10.0f * random01(state),
+                       -4.3f + 3.0f * random01(state)};
         
-        if (vkCreateBuffer(device, &info, nullptr, &result.buffer) != VK_SUCCESS) {
-            std::cerr << "Failed to create Vulkan buffer\n";
-            return {};
-        }
+        const float hue = 2.0f * float(M_PI) * random01(state);
+        seed.color = {0.5f + 0.5f * cosf(hue),
+                      0.5f + 0.5f * cosf(hue - 2.0f * float(M_PI) / 3.0f),
+                      0.5f + 0.5f * cosf(hue + 2.0f * float(M_PI) / 3.0f)};
+        
+        seed.phase = 2.0f * float(M_PI) * random01(state);
+        seed.speed = 0.5f + 1.5f * random01(state);
+    }
+}
+
+// Источники кадра: каждый кружит вокруг своего центра. Без стресс-теста
+// список пуст, но проход распределения всё равно идёт - его набор
+// дескрипторов нужен пайплайнам
+void updatePointLights(float time) {
+    const uint32_t count = stress_scene ? uint32_t(point_light_count) : 0;
+    point_lights.resize(count);
+    
+    for (uint32_t i = 0; i < count; ++i) {
+        const LightSeed& seed = light_seeds[i];
+        const float angle = seed.phase + (animate_lights ? time * seed.speed : 0.0f);
+        
+        point_lights[i] = {
+            .position = {seed.center.x + 0.8f * cosf(angle), seed.center.y + 0.8f * sinf(angle), seed.center.z},
+            .radius = point_light_radius,
+            .color = {seed.color.x, seed.color.y, seed.color.z},
+            .intensity = 1.5f,
+        };
     }
     
-    // Шаг 2: Выделяем память для буфера и копируем данные
+    clustered_lighting.setLights(point_lights.data(), count);
+}
+
+// Функция инициализации - вызывается один раз при старте
+void initialize() {
+    VkDevice& device = veekay::app->vk_device;
+    
+    // === МАТЕРИАЛЫ ===
     {
-        // Узнаём требования к памяти
-        VkMemoryRequirements requirements;
-        vkGetBufferMemoryRequirements(device, result.buffer, &requirements);
-        
-        // Получаем свойства физического устройства
-        VkPhysicalDeviceMemoryProperties properties;
-        vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
-        
-        // HOST_VISIBLE - CPU может писать напрямую
-        // HOST_COHERENT - не нужно делать flush/invalidate
-        const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-        
-        // Ищем подходящий тип памяти
-        uint32_t index = UINT_MAX;
-        for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
-            const VkMemoryType& type = properties.memoryTypes[i];
-            if ((requirements.memoryTypeBits & (1 << i)) &&
-                (type.propertyFlags & flags) == flags) {
-                index = i;
-                break;
-            }
+        if (!materials.initialize(256, 64)) {
+            veekay::app->running = false;
+            return;
         }
         
-        if (index == UINT_MAX) {
-            std::cerr << "Failed to find required memory type to allocate Vulkan buffer\n";
-            return {};
+        // Процедурная текстура "шахматная доска" 64x64
+        constexpr uint32_t size = 64;
+        std::vector<uint32_t> pixels(size * size);
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                bool white = ((x / 8) + (y / 8)) % 2 == 0;
+                pixels[y * size + x] = white ? 0xFFFFFFFFu : 0xFF404040u;
+            }
         }
         
-        // Выделяем память
-        VkMemoryAllocateInfo info{
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .allocationSize = requirements.size,
-            .memoryTypeIndex = index,
-        };
+        checker_texture = materials.createTexture(size, size, pixels.data());
         
-        if (vkAllocateMemory(device, &info, nullptr, &result.memory) != VK_SUCCESS) {
-            std::cerr << "Failed to allocate Vulkan buffer memory\n";
-            return {};
+        cylinder_material = materials.create({
+            .base_color = {cylinder_color.x, cylinder_color.y, cylinder_color.z, 1.0f},
+            .ambient = 0.3f,
+            .diffuse = 0.7f,
+            .texture_index = veekay::MaterialSystem::no_texture,
+        });
+    }
+    
+    // === КЛАСТЕРНОЕ ОСВЕЩЕНИЕ ===
+    // Набор дескрипторов источников нужен раньше layout пайплайна
+    {
+        light_cull_shader_module = loadShaderModule("./shaders/light_cull.comp.spv");
+        if (!light_cull_shader_module) {
+            std::cerr << "Failed to load Vulkan light binning shader from file\n";
+            veekay::app->running = false;
+            return;
         }
         
-        // Привязываем память к буферу
-        if (vkBindBufferMemory(device, result.buffer, result.memory, 0) != VK_SUCCESS) {
-            std::cerr << "Failed to bind Vulkan buffer memory\n";
-            return {};
+        if (!clustered_lighting.initialize(light_cull_shader_module, max_point_lights) ||
+            !gpu_timer.initialize()) {
+            veekay::app->running = false;
+            return;
         }
         
-        // Копируем данные в GPU память
-        void* device_data;
-        vkMapMemory(device, result.memory, 0, requirements.size, 0, &device_data);
-        memcpy(device_data, data, size);
-        vkUnmapMemory(device, result.memory);
+        seedPointLights();
     }
     
-    return result;
-}
-
-// Освобождает ресурсы буфера
-void destroyBuffer(const VulkanBuffer& buffer) {
-    VkDevice& device = veekay::app.vk_device;
-    vkFreeMemory(device, buffer.memory, nullptr);
-    vkDestroyBuffer(device, buffer.buffer, nullptr);
-}
-
-// Функция инициализации - вызывается один раз при старте
-void initialize() {
-    VkDevice& device = veekay::app.vk_device;
-    
     // === ПОСТРОЕНИЕ ГРАФИЧЕСКОГО ПАЙПЛАЙНА ===
     {
         // Загружаем шейдеры из скомпилированных SPIR-V файлов
         vertex_shader_module = loadShaderModule("./shaders/shader.vert.spv");
         if (!vertex_shader_module) {
             std::cerr << "Failed to load Vulkan vertex shader from file\n";
-            veekay::app.running = false;
+            veekay::app->running = false;
             return;
         }
         
         fragment_shader_module = loadShaderModule("./shaders/shader.frag.spv");
         if (!fragment_shader_module) {
             std::cerr << "Failed to load Vulkan fragment shader from file\n";
-            veekay::app.running = false;
+            veekay::app->running = false;
             return;
         }
         
-        // Настраиваем стадии шейдеров
-        VkPipelineShaderStageCreateInfo stage_infos[2];
-        
-        stage_infos[0] = VkPipelineShaderStageCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = vertex_shader_module,
-            .pName = "main",  // Точка входа в шейдер
+        // Push constants - быстрый способ передать данные в шейдер
+        VkPushConstantRange push_constants{
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .size = sizeof(ShaderConstants),
         };
         
-        stage_infos[1] = VkPipelineShaderStageCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = fragment_shader_module,
-            .pName = "main",
-        };
+        // Layout пайплайна - какие ресурсы доступны шейдерам:
+        // наборы дескрипторов материалов и источников света и push constants.
+        // Набор 1 пуст: его занимают кластеры у пайплайна с mesh-шейдером
+        VkDescriptorSetLayout empty_layout = veekay::app->descriptors->layout({.binding_count = 0});
+        if (!empty_layout) {
+            veekay::app->running = false;
+            return;
+        }
         
-        // Описываем формат входных вершин
-        VkVertexInputBindingDescription buffer_binding{
-            .binding = 0,
-            .stride = sizeof(Vertex),  // Размер одной вершины в байтах
-            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,  // Данные для каждой вершины
-        };
+        VkDescriptorSetLayout set_layouts[] = {materials.layout(), empty_layout, clustered_lighting.setLayout()};
         
-        // Атрибуты вершины: позиция и нормаль
-        VkVertexInputAttributeDescription attributes[] = {
-            {
-                .location = 0,  // layout(location = 0) в шейдере
-                .binding = 0,
-                .format = VK_FORMAT_R32G32B32_SFLOAT,  // vec3
-                .offset = offsetof(Vertex, position),
-            },
-            {
-                .location = 1,  // layout(location = 1) в шейдере
-                .binding = 0,
-                .format = VK_FORMAT_R32G32B32_SFLOAT,  // vec3
-                .offset = offsetof(Vertex, normal),
-            },
+        VkPipelineLayoutCreateInfo layout_info{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .setLayoutCount = 3,
+            .pSetLayouts = set_layouts,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &push_constants,
         };
         
-        VkPipelineVertexInputStateCreateInfo input_state_info{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-            .vertexBindingDescriptionCount = 1,
-            .pVertexBindingDescriptions = &buffer_binding,
-            .vertexAttributeDescriptionCount = sizeof(attributes) / sizeof(attributes[0]),
-            .pVertexAttributeDescriptions = attributes,
-        };
+        if (vkCreatePipelineLayout(device, &layout_info, nullptr, &pipeline_layout) != VK_SUCCESS) {
+            std::cerr << "Failed to create Vulkan pipeline layout\n";
+            veekay::app->running = false;
+            return;
+        }
         
-        // Как интерпретировать вершины: треугольники
-        VkPipelineInputAssemblyStateCreateInfo assembly_state_info{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        // Описываем состояние пайплайна: одинаковые описания дают
+        // один и тот же пайплайн из реестра. Viewport и scissor
+        // динамические и задаются при записи команд
+        veekay::PipelineDescription description{
+            .vertex_shader = vertex_shader_module,
+            .fragment_shader = fragment_shader_module,
+            
+            // Формат входных данных: вершины и инстансы
+            .binding_count = 2,
+            .bindings = {
+                {
+                    .binding = 0,
+                    .stride = sizeof(Vertex),  // Размер одной вершины в байтах
+                    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,  // Данные для каждой вершины
+                },
+                {
+                    .binding = 1,
+                    .stride = sizeof(veekay::InstanceData),
+                    .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,  // Данные для каждого инстанса
+                },
+            },
+            
+            // Атрибуты вершины: позиция, нормаль и текстурные координаты,
+            // атрибуты инстанса: матрица модели (4 столбца vec4) и ID материала
+            .attribute_count = 8,
+            .attributes = {
+                {
+                    .location = 0,  // layout(location = 0) в шейдере
+                    .binding = 0,
+                    .format = VK_FORMAT_R32G32B32_SFLOAT,  // vec3
+                    .offset = offsetof(Vertex, position),
+                },
+                {
+                    .location = 1,  // layout(location = 1) в шейдере
+                    .binding = 0,
+                    .format = VK_FORMAT_R32G32B32_SFLOAT,  // vec3
+                    .offset = offsetof(Vertex, normal),
+                },
+                {
+                    .location = 2,  // layout(location = 2) в шейдере
+                    .binding = 0,
+                    .format = VK_FORMAT_R32G32_SFLOAT,  // vec2
+                    .offset = offsetof(Vertex, uv),
+                },
+                {
+                    .location = 3,
+                    .binding = 1,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(veekay::InstanceData, model),
+                },
+                {
+                    .location = 4,
+                    .binding = 1,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(veekay::InstanceData, model) + 4 * sizeof(float),
+                },
+                {
+                    .location = 5,
+                    .binding = 1,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(veekay::InstanceData, model) + 8 * sizeof(float),
+                },
+                {
+                    .location = 6,
+                    .binding = 1,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(veekay::InstanceData, model) + 12 * sizeof(float),
+                },
+                {
+                    .location = 7,
+                    .binding = 1,
+                    .format = VK_FORMAT_R32_UINT,  // ID материала
+                    .offset = offsetof(veekay::InstanceData, material),
+                },
+            },
+            
+            // Треугольники, заполнение полигонов, без отсечения граней
             .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+            .polygon_mode = VK_POLYGON_MODE_FILL,
+            .cull_mode = VK_CULL_MODE_NONE,
+            .front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+            
+            // Тест глубины - ближние объекты перекрывают дальние
+            .depth_test = true,
+            .depth_write = true,
+            .depth_compare = VK_COMPARE_OP_LESS_OR_EQUAL,
+            
+            .layout = pipeline_layout,
+            .render_pass = veekay::app->vk_render_pass,
         };
         
-        // Растеризация: заполнение полигонов, без отсечения граней
-        VkPipelineRasterizationStateCreateInfo raster_info{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-            .polygonMode = VK_POLYGON_MODE_FILL,  // Заполняем треугольники
-            .cullMode = VK_CULL_MODE_NONE,        // Не отсекаем грани
-            .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
-            .lineWidth = 1.0f,
-        };
+        shading_variants.initialize(description);
+        pipeline = shading_variants.request(shadingVariant());
+        if (!pipeline) {
+            veekay::app->running = false;
+            return;
+        }
+    }
+    
+    // === ОТСЕЧЕНИЕ ПЕРЕКРЫТЫХ ОБЪЕКТОВ ===
+    {
+        pyramid_shader_module = loadShaderModule("./shaders/pyramid.comp.spv");
+        cull_shader_module = loadShaderModule("./shaders/cull.comp.spv");
+        if (!pyramid_shader_module || !cull_shader_module) {
+            std::cerr << "Failed to load Vulkan culling shaders from file\n";
+            veekay::app->running = false;
+            return;
+        }
         
-        // Мультисэмплинг выключен (антиалиасинг)
-        VkPipelineMultisampleStateCreateInfo sample_info{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-            .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-            .sampleShadingEnable = false,
-            .minSampleShading = 1.0f,
-        };
+        if (!culler.initialize(pyramid_shader_module, cull_shader_module, max_instances, 64)) {
+            veekay::app->running = false;
+            return;
+        }
+    }
+    
+    // === ГЕНЕРАЦИЯ ЦИЛИНДРА НА GPU ===
+    {
+        cylinder_shader_module = loadShaderModule("./shaders/cylinder.comp.spv");
+        if (!cylinder_shader_module) {
+            std::cerr << "Failed to load Vulkan cylinder generation shader from file\n";
+            veekay::app->running = false;
+            return;
+        }
         
-        // Viewport - область экрана для рендеринга
-        VkViewport viewport{
-            .x = 0.0f,
-            .y = 0.0f,
-            .width = static_cast<float>(veekay::app.window_width),
-            .height = static_cast<float>(veekay::app.window_height),
-            .minDepth = 0.0f,
-            .maxDepth = 1.0f,
-        };
+        if (!gpu_cylinder.initialize(cylinder_shader_module, 4096)) {
+            veekay::app->running = false;
+            return;
+        }
+    }
+    
+    // === СОЗДАНИЕ ГЕОМЕТРИИ ===
+    // Общий пул: до 64K вершин и 256K индексов на все меши
+    if (!geometry_pool.initialize(sizeof(Vertex), 64 * 1024, 256 * 1024) ||
+        !draw_list.initialize(64)) {
+        veekay::app->running = false;
+        return;
+    }
+    
+    // Основной цилиндр: радиус 0.5, высота 2.0, 50 сегментов по окружности
+    cylinder_mesh.initialize(sizeof(Vertex));
+    cylinder_mesh.update(cylinder_geometry.getVerticesData(), cylinder_geometry.getVertexCount(),
+                         static_cast<const uint32_t*>(cylinder_geometry.getIndicesData()),
+                         cylinder_geometry.getIndexCount());
+    
+    // === СОЗДАНИЕ СЦЕНЫ ===
+    // Буфер инстансов на каждый кадр в полёте: пока GPU читает один,
+    // CPU безопасно пишет изменения в другой. Шейдер отсечения читает
+    // его как storage-буфер
+    const uint32_t frames = veekay::app->frames_in_flight;
+    instance_buffers.resize(frames);
+    
+    for (uint32_t i = 0; i < frames; ++i) {
+        instance_buffers[i] = veekay::createBuffer(max_instances * sizeof(veekay::InstanceData),
+                                                   nullptr, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    }
+    
+    scene = new veekay::Scene(frames);
+    
+    // Ряд неподвижных объектов разной формы внизу экрана: разные меши
+    // из общего пула, у каждой формы свой материал
+    struct Shape {
+        float radius;
+        float height;
+        uint32_t segments;
+        Vector color;
+    };
+    
+    const Shape shapes[] = {
+        {0.2f, 1.5f, 16, {0.9f, 0.4f, 0.3f}},  // Тонкий и высокий
+        {0.5f, 0.4f, 32, {0.4f, 0.9f, 0.4f}},  // Широкий и низкий
+        {0.4f, 1.0f, 6,  {0.9f, 0.8f, 0.3f}},  // Шестигранная призма
+    };
+    
+    constexpr uint32_t instances_per_shape = 4;
+    
+    uint32_t column = 0;
+    for (const Shape& shape : shapes) {
+        geometry::MappedMesh mesh = mesh_cache.cylinder(shape.radius, shape.height, shape.segments);
+        if (!mesh.valid()) {
+            veekay::app->running = false;
+            return;
+        }
         
-        // Scissor - прямоугольник отсечения
-        VkRect2D scissor{
-            .offset = {0, 0},
-            .extent = {veekay::app.window_width, veekay::app.window_height},
+        Batch batch{
+            .mesh = geometry_pool.add(mesh.getVerticesData(), mesh.getVertexCount(),
+                                      mesh.getIndicesData(), mesh.getIndexCount()),
+            .first_instance = scene->size(),
+            .instance_count = instances_per_shape,
         };
+        if (batch.mesh == veekay::GeometryPool::invalid_mesh) {
+            veekay::app->running = false;
+            return;
+        }
+        setCullingMesh(batch.mesh, mesh);
         
-        VkPipelineViewportStateCreateInfo viewport_info{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-            .viewportCount = 1,
-            .pViewports = &viewport,
-            .scissorCount = 1,
-            .pScissors = &scissor,
-        };
+        const uint32_t material = materials.create({
+            .base_color = {shape.color.x, shape.color.y, shape.color.z, 1.0f},
+            .ambient = 0.3f,
+            .diffuse = 0.7f,
+            .texture_index = veekay::MaterialSystem::no_texture,
+        });
         
-        // Тест глубины - ближние объекты перекрывают дальние
-        VkPipelineDepthStencilStateCreateInfo depth_info{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-            .depthTestEnable = true,          // Включаем тест глубины
-            .depthWriteEnable = true,         // Записываем в буфер глубины
-            .depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL,  // Проходят ближние или равные
-        };
+        for (uint32_t i = 0; i < instances_per_shape; ++i, ++column) {
+            uint32_t object = scene->create();
+            scene->setPosition(object, -6.0f + 1.1f * column, -3.0f, -3.0f);
+            scene->setMaterial(object, material);
+            culler.setInstanceMesh(object, batch.mesh);
+        }
         
-        // Настройки блендинга цветов (смешивание полупрозрачных объектов)
-        VkPipelineColorBlendAttachmentState attachment_info{
-            .colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
-                              VK_COLOR_COMPONENT_G_BIT |
-                              VK_COLOR_COMPONENT_B_BIT |
-                              VK_COLOR_COMPONENT_A_BIT,
-        };
+        batches.push_back(batch);
+    }
+    
+    // Стена за сценой для стресс-теста освещения. Пока он выключен,
+    // масштаб нулевой и стены не видно
+    {
+        geometry::MappedMesh mesh = mesh_cache.cylinder(14.0f, 0.2f, 64);
+        if (!mesh.valid()) {
+            veekay::app->running = false;
+            return;
+        }
         
-        VkPipelineColorBlendStateCreateInfo blend_info{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-            .logicOpEnable = false,
-            .logicOp = VK_LOGIC_OP_COPY,
-            .attachmentCount = 1,
-            .pAttachments = &attachment_info
+        Batch batch{
+            .mesh = geometry_pool.add(mesh.getVerticesData(), mesh.getVertexCount(),
+                                      mesh.getIndicesData(), mesh.getIndexCount()),
+            .first_instance = scene->size(),
+            .instance_count = 1,
         };
+        if (batch.mesh == veekay::GeometryPool::invalid_mesh) {
+            veekay::app->running = false;
+            return;
+        }
+        setCullingMesh(batch.mesh, mesh);
         
-        // Push constants - быстрый способ передать данные в шейдер
-        VkPushConstantRange push_constants{
-            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-            .size = sizeof(ShaderConstants),
-        };
+        // Ось цилиндра направлена на камеру, к ней обращено основание
+        wall_object = scene->create();
+        scene->setPosition(wall_object, 0.0f, 0.0f, -4.6f);
+        scene->setRotation(wall_object, 1.0f, 0.0f, 0.0f, M_PI / 2.0f);
+        scene->setScale(wall_object, 0.0f, 0.0f, 0.0f);
+        scene->setMaterial(wall_object, materials.create({
+            .base_color = {0.8f, 0.8f, 0.8f, 1.0f},
+            .ambient = 0.05f,
+            .diffuse = 0.9f,
+            .texture_index = veekay::MaterialSystem::no_texture,
+        }));
+        culler.setInstanceMesh(wall_object, batch.mesh);
         
-        // Layout пайплайна - какие ресурсы доступны шейдерам
-        VkPipelineLayoutCreateInfo layout_info{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-            .pushConstantRangeCount = 1,
-            .pPushConstantRanges = &push_constants,
-        };
+        batches.push_back(batch);
+    }
+    
+    culled_object_count = scene->size();
+    
+    cylinder_object = scene->create();
+    scene->setRotation(cylinder_object, 1.0f, 0.0f, 0.0f, -M_PI / 5.0f);  // Наклон на -36°
+    scene->setMaterial(cylinder_object, cylinder_material);
+    
+    // Цилиндр с GPU справа от ряда фигур, рисуется отдельным вызовом
+    gpu_cylinder_object = scene->create();
+    scene->setPosition(gpu_cylinder_object, 4.5f, -3.0f, -3.0f);
+    scene->setMaterial(gpu_cylinder_object, materials.create({
+        .base_color = {0.7f, 0.4f, 0.9f, 1.0f},
+        .ambient = 0.3f,
+        .diffuse = 0.7f,
+        .texture_index = veekay::MaterialSystem::no_texture,
+    }));
+    
+    // === ОТСЕЧЕНИЕ КЛАСТЕРОВ ===
+    {
+        // Заглушка - тот же цилиндр с 16 сегментами, готова с первого кадра
+        geometry::MappedMesh placeholder = mesh_cache.cylinder(1.0f, 1.5f, 16);
+        if (!placeholder.valid()) {
+            veekay::app->running = false;
+            return;
+        }
         
-        if (vkCreatePipelineLayout(device, &layout_info, nullptr, &pipeline_layout) != VK_SUCCESS) {
-            std::cerr << "Failed to create Vulkan pipeline layout\n";
-            veekay::app.running = false;
+        meshlet_placeholder_mesh = geometry_pool.add(placeholder.getVerticesData(),
+                                                     placeholder.getVertexCount(),
+                                                     placeholder.getIndicesData(),
+                                                     placeholder.getIndexCount());
+        if (meshlet_placeholder_mesh == veekay::GeometryPool::invalid_mesh) {
+            veekay::app->running = false;
             return;
         }
         
-        // Создаём полный графический пайплайн
-        VkGraphicsPipelineCreateInfo info{
-            .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-            .stageCount = 2,
-            .pStages = stage_infos,
-            .pVertexInputState = &input_state_info,
-            .pInputAssemblyState = &assembly_state_info,
-            .pViewportState = &viewport_info,
-            .pRasterizationState = &raster_info,
-            .pMultisampleState = &sample_info,
-            .pDepthStencilState = &depth_info,
-            .pColorBlendState = &blend_info,
-            .layout = pipeline_layout,
-            .renderPass = veekay::app.vk_render_pass,
+        // Цилиндр с 4096 сегментами за рядом фигур
+        meshlet_object = scene->create();
+        scene->setPosition(meshlet_object, 0.0f, 1.5f, -8.0f);
+        scene->setRotation(meshlet_object, 1.0f, 0.0f, 0.0f, M_PI / 8.0f);
+        scene->setMaterial(meshlet_object, materials.create({
+            .base_color = {0.9f, 0.6f, 0.2f, 1.0f},
+            .ambient = 0.3f,
+            .diffuse = 0.7f,
+            .texture_index = veekay::MaterialSystem::no_texture,
+        }));
+        
+        // Выполняется в потоке загрузчика: вершины и индексы копируются
+        // в device-local буферы через staging-память, кластеры и пайплайны
+        // создаются там же. Кэш мешей здесь уже не используется главным
+        // потоком, поэтому делить его безопасно
+        // Вариант шейдера на момент загрузки, GUI может поменять его раньше
+        auto load = [variant = shadingVariant()](veekay::Upload& upload) {
+            geometry::MappedMesh mesh = mesh_cache.cylinder(1.0f, 1.5f, 4096);
+            if (!mesh.valid()) {
+                return false;
+            }
+            
+            const VkDeviceSize vertex_size = VkDeviceSize(mesh.getVertexCount()) * sizeof(Vertex);
+            const VkDeviceSize index_size = VkDeviceSize(mesh.getIndexCount()) * sizeof(uint32_t);
+            
+            meshlet_vertex_buffer = veekay::createDeviceBuffer(vertex_size,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+            meshlet_index_buffer = veekay::createDeviceBuffer(index_size,
+                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+            
+            if (!meshlet_vertex_buffer.buffer || !meshlet_index_buffer.buffer ||
+                !upload.copy(meshlet_vertex_buffer.buffer, 0, mesh.getVerticesData(), vertex_size) ||
+                !upload.copy(meshlet_index_buffer.buffer, 0, mesh.getIndicesData(), index_size)) {
+                return false;
+            }
+            
+            meshlet_index_count = mesh.getIndexCount();
+            
+            const geometry::MeshletData data = geometry::buildMeshlets(
+                static_cast<const Vertex*>(mesh.getVerticesData()), mesh.getVertexCount(),
+                mesh.getIndicesData(), mesh.getIndexCount());
+            
+            meshlet_cull_shader_module = loadShaderModule("./shaders/meshlet_cull.comp.spv");
+            if (!meshlet_cull_shader_module) {
+                std::cerr << "Failed to load Vulkan meshlet culling shader from file\n";
+                return false;
+            }
+            
+            const veekay::MeshRange range{
+                .first_index = 0,
+                .index_count = mesh.getIndexCount(),
+                .vertex_offset = 0,
+                .vertex_count = mesh.getVertexCount(),
+            };
+            
+            if (!meshlets.initialize(meshlet_cull_shader_module, data, range, meshlet_vertex_buffer.buffer)) {
+                return false;
+            }
+            meshlets_created = true;
+            
+            if (!veekay::app->mesh_shader) {
+                return true;
+            }
+            
+            // Пайплайн с mesh-шейдером: набор 0 - материалы, как у основного,
+            // набор 1 - буферы кластеров, вершин и инстансов, набор 2 - источники
+            meshlet_shader_module = loadShaderModule("./shaders/meshlet.mesh.spv");
+            if (!meshlet_shader_module) {
+                std::cerr << "Failed to load Vulkan mesh shader from file\n";
+                return false;
+            }
+            
+            VkPushConstantRange push_constants{
+                .stageFlags = VK_SHADER_STAGE_MESH_BIT_EXT,
+                .size = sizeof(veekay::MeshletConstants),
+            };
+            
+            VkDescriptorSetLayout set_layouts[] = {materials.layout(), meshlets.setLayout(),
+                                                   clustered_lighting.setLayout()};
+            
+            VkPipelineLayoutCreateInfo layout_info{
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                .setLayoutCount = 3,
+                .pSetLayouts = set_layouts,
+                .pushConstantRangeCount = 1,
+                .pPushConstantRanges = &push_constants,
+            };
+            
+            if (vkCreatePipelineLayout(veekay::app->vk_device, &layout_info, nullptr,
+                                       &meshlet_pipeline_layout) != VK_SUCCESS) {
+                std::cerr << "Failed to create Vulkan mesh shader pipeline layout\n";
+                return false;
+            }
+            
+            // Реестр пайплайнов потокобезопасен, а кэш вариантов до конца
+            // загрузки принадлежит этому потоку
+            meshlet_variants.initialize({
+                .fragment_shader = fragment_shader_module,
+                .mesh_shader = meshlet_shader_module,
+                .layout = meshlet_pipeline_layout,
+                .render_pass = veekay::app->vk_render_pass,
+            });
+            meshlet_pipeline = meshlet_variants.request(variant);
+            
+            return meshlet_pipeline != VK_NULL_HANDLE;
         };
         
-        if (vkCreateGraphicsPipelines(device, nullptr, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
-            std::cerr << "Failed to create Vulkan pipeline\n";
-            veekay::app.running = false;
-            return;
-        }
+        // Вызывается в главном потоке перед ui(), когда копии завершены
+        auto loaded = [](bool success) {
+            if (!success) {
+                std::cerr << "Failed to load detailed cylinder\n";
+                veekay::app->running = false;
+                return;
+            }
+            
+            meshlets_ready = true;
+        };
+        
+        veekay::app->loader->load(load, loaded);
     }
     
-    // === СОЗДАНИЕ ГЕОМЕТРИИ ЦИЛИНДРА ===
-    // Создаём цилиндр: радиус 0.5, высота 2.0, ~50 вершин (25 сегментов по окружности)
-    cylinder = new geometry::Cylinder(0.5f, 2.0f, 50);
-    cylinder_index_count = cylinder->getIndexCount();
+    // Наклон плоскости траектории на 30 градусов вокруг оси X. В исходной
+    // модели цилиндра поворот на -36° применялся после переноса, поэтому
+    // орбита поворачивалась вместе с ним: сцена же поворачивает объект
+    // вокруг его позиции, и этот поворот входит в наклон траектории.
+    // multiply(m, v) применяет транспонированную матрицу, отсюда +36°
+    trajectory_tilt = multiply(rotation({1.0f, 0.0f, 0.0f}, M_PI / 5.0f),
+                               rotation({1.0f, 0.0f, 0.0f}, M_PI / 6.0f));
     
-    // Создаём GPU буферы для вершин и индексов
-    vertex_buffer = createBuffer(
-        cylinder->getVerticesSizeInBytes(),
-        cylinder->getVerticesData(),
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT  // Буфер для вершин
-    );
+    // Камера находится в точке (0, 0, 5), смотрит в направлении (0, 0, -1)
+    view = translation({0.0f, 0.0f, -5.0f});
     
-    index_buffer = createBuffer(
-        cylinder->getIndicesSizeInBytes(),
-        cylinder->getIndicesData(),
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT  // Буфер для индексов
-    );
+    updateProjection();
+    
+    // Начальные параметры видны потоку симуляции ещё до первого кадра GUI
+    controls.back() = {trajectory_radius, animation_speed, animate};
+    controls.publish();
 }
 
 // Функция завершения - освобождаем все ресурсы
 void shutdown() {
-    VkDevice& device = veekay::app.vk_device;
+    VkDevice& device = veekay::app->vk_device;
+    
+    delete scene;
+    
+    for (const VulkanBuffer& buffer : instance_buffers) {
+        veekay::destroyBuffer(buffer);
+    }
+    
+    cylinder_mesh.destroy();
+    draw_list.destroy();
+    geometry_pool.destroy();
+    
+    gpu_cylinder.destroy();
+    vkDestroyShaderModule(device, cylinder_shader_module, nullptr);
     
-    delete cylinder;
+    // Поток загрузчика к этому моменту остановлен
+    if (meshlets_created) {
+        meshlets.destroy();
+    }
+    veekay::destroyBuffer(meshlet_index_buffer);
+    veekay::destroyBuffer(meshlet_vertex_buffer);
+    vkDestroyPipelineLayout(device, meshlet_pipeline_layout, nullptr);
+    vkDestroyShaderModule(device, meshlet_shader_module, nullptr);
+    vkDestroyShaderModule(device, meshlet_cull_shader_module, nullptr);
+    
+    culler.destroy();
+    vkDestroyShaderModule(device, cull_shader_module, nullptr);
+    vkDestroyShaderModule(device, pyramid_shader_module, nullptr);
+    
+    materials.destroy();
     
-    destroyBuffer(index_buffer);
-    destroyBuffer(vertex_buffer);
+    // Сами пайплайны принадлежат реестру veekay
+    meshlet_variants.destroy();
+    shading_variants.destroy();
+    
+    gpu_timer.destroy();
+    clustered_lighting.destroy();
+    vkDestroyShaderModule(device, light_cull_shader_module, nullptr);
     
-    vkDestroyPipeline(device, pipeline, nullptr);
     vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
     vkDestroyShaderModule(device, fragment_shader_module, nullptr);
     vkDestroyShaderModule(device, vertex_shader_module, nullptr);
 }
 
-// Функция обновления - вызывается каждый кадр
-// Здесь обрабатываем ввод и обновляем параметры анимации
-void update(double time) {
+// Интерфейс - вызывается каждый кадр в главном потоке
+// Здесь обрабатываем ввод и передаём параметры симуляции
+void ui() {
     // Создаём GUI панель управления с помощью ImGui
     ImGui::Begin("Cylinder Controls");
     ImGui::Text("Trajectory Settings:");
@@ -526,16 +1092,246 @@ void update(double time) {
     ImGui::SliderFloat("Animation Speed", &animation_speed, 0.1f, 5.0f);
     ImGui::Checkbox("Animate", &animate);
     ImGui::Separator();
+    // Перегенерация меша основного цилиндра без остановки GPU
+    ImGui::Text("Cylinder Shape:");
+    bool shape_changed = false;
+    shape_changed |= ImGui::SliderFloat("Radius", &cylinder_radius, 0.1f, 1.5f);
+    shape_changed |= ImGui::SliderFloat("Height", &cylinder_height, 0.1f, 4.0f);
+    shape_changed |= ImGui::SliderInt("Segments", &cylinder_segments, 3, 2048);
+    if (shape_changed) {
+        cylinder_geometry.generate(cylinder_radius, cylinder_height, uint32_t(cylinder_segments));
+        cylinder_mesh.update(cylinder_geometry.getVerticesData(), cylinder_geometry.getVertexCount(),
+                             static_cast<const uint32_t*>(cylinder_geometry.getIndicesData()),
+                             cylinder_geometry.getIndexCount());
+    }
+    ImGui::Separator();
     ImGui::Text("Rendering Settings:");
-    ImGui::Checkbox("Perspective Projection", &use_perspective);
+    if (ImGui::Checkbox("Perspective Projection", &use_perspective)) {
+        updateProjection();
+    }
+    // Пирамида и видимость после выключенного отсечения устарели
+    if (ImGui::Checkbox("Occlusion Culling", &occlusion_culling) && occlusion_culling) {
+        culler.reset();
+    }
+    ImGui::Checkbox("Two-Phase Culling", &two_phase_culling);
+    ImGui::Separator();
+    // Каждое сочетание - свой пайплайн, собирается при первом выборе
+    ImGui::Text("Shading:");
+    const char* lighting_models[] = {"Unlit", "Lambert", "Half-Lambert"};
+    ImGui::Combo("Lighting Model", &lighting_model, lighting_models, 3);
+    ImGui::SliderInt("Lights", &light_count, 0, 4);
+    ImGui::Checkbox("Textures", &shader_textures);
+    ImGui::Checkbox("Hemisphere Ambient", &hemisphere_ambient);
+    ImGui::Checkbox("Build Variants in Background", &background_variants);
+    size_t variants_built = shading_variants.size();
+    uint32_t variants_building = shading_variants.pendingCount();
+    if (meshlets_ready) {
+        variants_built += meshlet_variants.size();
+        variants_building += meshlet_variants.pendingCount();
+    }
+    ImGui::Text("Variants: %zu built, %u building", variants_built, variants_building);
+    ImGui::Separator();
+    // Стресс-тест кластерного освещения, включение меняет и вариант шейдера
+    ImGui::Text("Point Lights:");
+    if (ImGui::Checkbox("Stress Scene", &stress_scene)) {
+        const float scale = stress_scene ? 1.0f : 0.0f;
+        scene->setScale(wall_object, scale, scale, scale);
+        point_lights_changed = true;
+    }
+    point_lights_changed |= ImGui::SliderInt("Light Count", &point_light_count, 0, int(max_point_lights));
+    point_lights_changed |= ImGui::SliderFloat("Light Radius", &point_light_radius, 0.2f, 4.0f);
+    point_lights_changed |= ImGui::Checkbox("Animate Lights", &animate_lights);
+    // Время проходов отстаёт на frames_in_flight кадров
+    if (gpu_timer.supported()) {
+        double gpu_total = 0.0;
+        for (const veekay::GpuTiming& timing : gpu_timer.timings()) {
+            ImGui::Text("%s: %.3f ms", timing.name, timing.milliseconds);
+            gpu_total += timing.milliseconds;
+        }
+        ImGui::Text("GPU total: %.3f ms", gpu_total);
+    } else {
+        ImGui::Text("GPU timings: n/a");
+    }
+    ImGui::Separator();
+    // Меш генерируется compute-шейдером, проверка читает его обратно
+    // и сравнивает с geometry::Cylinder тех же параметров
+    ImGui::Text("GPU Cylinder:");
+    ImGui::SliderFloat("GPU Radius", &gpu_cylinder_radius, 0.1f, 1.0f);
+    ImGui::SliderFloat("GPU Height", &gpu_cylinder_height, 0.1f, 3.0f);
+    ImGui::SliderInt("GPU Segments", &gpu_cylinder_segments, 3, int(gpu_cylinder.maxSegments()));
+    ImGui::Checkbox("Pulse", &gpu_cylinder_pulse);
+    if (ImGui::Button("Validate Against CPU")) {
+        const bool valid = gpu_cylinder.validate(gpu_cylinder_radius, gpu_cylinder_height,
+                                                 uint32_t(gpu_cylinder_segments));
+        gpu_cylinder_status = valid ? "match" : "MISMATCH, see log";
+    }
+    ImGui::SameLine();
+    ImGui::Text("%s", gpu_cylinder_status);
+    ImGui::Separator();
+    // Без отсечения детализированный цилиндр рисуется целиком
+    if (meshlets_ready) {
+        ImGui::Text("Meshlets: %u, %s", meshlets.meshletCount(),
+                    meshlet_pipeline ? "mesh shader" : "vertex pipeline");
+    } else {
+        ImGui::Text("Meshlets: loading (%u pending)", veekay::app->loader->pendingCount());
+    }
+    ImGui::Checkbox("Cluster Culling", &cluster_culling);
     ImGui::Separator();
-    ImGui::ColorEdit3("Cylinder Color", reinterpret_cast<float*>(&cylinder_color));
+    // Цвет и текстура - параметры материала, меняется только буфер материалов
+    bool material_changed = false;
+    material_changed |= ImGui::ColorEdit3("Cylinder Color", reinterpret_cast<float*>(&cylinder_color));
+    material_changed |= ImGui::Checkbox("Checker Texture", &use_texture);
+    if (material_changed) {
+        veekay::Material material = materials.get(cylinder_material);
+        material.base_color[0] = cylinder_color.x;
+        material.base_color[1] = cylinder_color.y;
+        material.base_color[2] = cylinder_color.z;
+        material.texture_index = use_texture ? checker_texture : veekay::MaterialSystem::no_texture;
+        materials.update(cylinder_material, material);
+    }
+    // Запись кадров на диск: копия каждого кадра читается асинхронно,
+    // PNG кодируется в фоновом потоке
+    if (veekay::FrameCapture* capture = veekay::app->capture) {
+        ImGui::Separator();
+        if (!capture->active()) {
+            if (ImGui::Button("Start Capture")) {
+                capture->start("./capture");
+            }
+        } else if (ImGui::Button("Stop Capture")) {
+            capture->stop();
+        }
+        ImGui::Text("Captured: %u, dropped: %u", capture->capturedCount(), capture->droppedCount());
+    }
+    // Время кадра и задержка от опроса ввода до вывода на экран
+    // (--low-latency, --frame-limit), время до показа кадра известно
+    // только с VK_KHR_present_wait
+    const veekay::FrameStats& stats = *veekay::app->frame_stats;
+    ImGui::Separator();
+    ImGui::Text("Frame: %.2f ms, input to submit: %.2f ms", stats.frame_time, stats.input_to_submit);
+    if (stats.present_wait) {
+        ImGui::Text("Submit to present: %.2f ms", stats.submit_to_present);
+    } else {
+        ImGui::Text("Submit to present: n/a");
+    }
+    // Окно с расходом видеопамяти по категориям и кучам
+    static bool show_memory = false;
+    ImGui::Separator();
+    ImGui::Checkbox("GPU Memory", &show_memory);
     ImGui::End();
     
-    // Обновляем время анимации если включена
-    if (animate) {
-        animation_time = float(time) * animation_speed;
+    if (show_memory) {
+        veekay::showMemoryWindow(&show_memory);
     }
+    
+    controls.back() = {trajectory_radius, animation_speed, animate};
+    controls.publish();
+}
+
+// Функция обновления - вызывается каждый кадр перед рендерингом или
+// в потоке симуляции со своей частотой. Не трогает ImGui и сцену:
+// результат публикуется снимком, который применяет render()
+void update(double time) {
+    controls.fetch();
+    const Controls& current = controls.front();
+    
+    // Обновляем время анимации если включена. time идёт от часов veekay,
+    // в режиме fixed_frame и при воспроизведении записи он одинаков
+    // в каждом запуске, поэтому кадры повторяются точно
+    // Позиция меняется только когда анимация идёт или меняется радиус
+    static float last_radius = -1.0f;
+    if (current.animate || current.trajectory_radius != last_radius) {
+        if (current.animate) {
+            animation_time = float(time) * current.animation_speed;
+        }
+        last_radius = current.trajectory_radius;
+        
+        // === ВЫЧИСЛЕНИЕ ТРАЕКТОРИИ ДВИЖЕНИЯ ===
+        // Сложная траектория в форме восьмёрки (лемнискаты)
+        // phase - фаза анимации с вариацией скорости для более интересного движения
+        float phase = animation_time + 0.2f * sinf(2.0f * animation_time);
+        float x = current.trajectory_radius * sinf(phase);              // Движение по X
+        float z = current.trajectory_radius * 0.5f * sinf(2.0f * phase); // Движение по Z (удвоенная частота = восьмёрка)
+        Vector orbital_pos = {x, 0.0f, z - 1};
+        
+        // Наклоняем плоскость траектории
+        snapshots.back().cylinder_position = multiply(trajectory_tilt, orbital_pos);
+        snapshots.publish();
+    }
+}
+
+// Начинает render pass: основной очищает экран и буфер глубины,
+// vk_render_pass_load продолжает рисовать поверх уже нарисованного
+void beginRenderPass(VkCommandBuffer cmd, VkFramebuffer framebuffer, VkRenderPass render_pass) {
+    VkClearValue clear_color{.color = {{0.1f, 0.1f, 0.1f, 1.0f}}};  // Тёмно-серый фон
+    VkClearValue clear_depth{.depthStencil = {1.0f, 0}};             // Максимальная глубина
+    VkClearValue clear_values[] = {clear_color, clear_depth};
+    
+    VkRenderPassBeginInfo info{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .renderPass = render_pass,
+        .framebuffer = framebuffer,
+        .renderArea = {
+            .extent = {veekay::app->window_width, veekay::app->window_height},
+        },
+        .clearValueCount = 2,
+        .pClearValues = clear_values,
+    };
+    
+    vkCmdBeginRenderPass(cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+// Привязывает пайплайн, динамическое состояние, дескрипторы, буферы
+// и константы. Между проходами отсечения работают compute-шейдеры,
+// поэтому состояние привязывается заново в каждом render pass
+void bindSceneState(VkCommandBuffer cmd, uint32_t frame) {
+    // Привязываем наш графический пайплайн
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    
+    // Viewport и scissor - динамическое состояние пайплайна
+    VkViewport viewport{
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = static_cast<float>(veekay::app->window_width),
+        .height = static_cast<float>(veekay::app->window_height),
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    
+    VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = {veekay::app->window_width, veekay::app->window_height},
+    };
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+    
+    // Наборы дескрипторов материалов и источников привязываются
+    // один раз на проход
+    VkDescriptorSet material_set = materials.set(frame);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,
+                            0, 1, &material_set, 0, nullptr);
+    
+    VkDescriptorSet light_set = clustered_lighting.set();
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,
+                            2, 1, &light_set, 0, nullptr);
+    
+    // Привязываем общие буферы вершин и индексов пула и буфер инстансов
+    geometry_pool.bind(cmd);
+    
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 1, 1, &instance_buffers[frame].buffer, &offset);
+    
+    // Заполняем структуру констант для шейдеров
+    ShaderConstants constants{
+        .projection = projection,
+        .view = view,
+    };
+    
+    // Передаём константы в шейдеры через push constants
+    vkCmdPushConstants(
+        cmd, pipeline_layout,
+        VK_SHADER_STAGE_VERTEX_BIT,
+        0, sizeof(ShaderConstants), &constants
+    );
 }
 
 // Функция рендеринга - формируем команды отрисовки для GPU
@@ -552,112 +1348,210 @@ void render(VkCommandBuffer cmd, VkFramebuffer framebuffer) {
         vkBeginCommandBuffer(cmd, &info);
     }
     
-    // Начинаем render pass - очищаем экран и буфер глубины
-    {
-        VkClearValue clear_color{.color = {{0.1f, 0.1f, 0.1f, 1.0f}}};  // Тёмно-серый фон
-        VkClearValue clear_depth{.depthStencil = {1.0f, 0}};             // Максимальная глубина
-        VkClearValue clear_values[] = {clear_color, clear_depth};
-        
-        VkRenderPassBeginInfo info{
-            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-            .renderPass = veekay::app.vk_render_pass,
-            .framebuffer = framebuffer,
-            .renderArea = {
-                .extent = {veekay::app.window_width, veekay::app.window_height},
-            },
-            .clearValueCount = 2,
-            .pClearValues = clear_values,
-        };
-        
-        vkCmdBeginRenderPass(cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
+    gpu_timer.beginFrame(cmd);
+    
+    // Применяем последний готовый снимок симуляции, если появился новый
+    if (snapshots.fetch()) {
+        const Vector& position = snapshots.front().cylinder_position;
+        scene->setPosition(cylinder_object, position.x, position.y, position.z);
     }
     
-    // Записываем команды отрисовки цилиндра
-    {
-        // Привязываем наш графический пайплайн
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-        
-        // Привязываем буферы вершин и индексов
-        VkDeviceSize offset = 0;
-        vkCmdBindVertexBuffers(cmd, 0, 1, &vertex_buffer.buffer, &offset);
-        vkCmdBindIndexBuffer(cmd, index_buffer.buffer, offset, VK_INDEX_TYPE_UINT32);
-        
-        // Центрируем цилиндр вокруг начала координат по оси Y
-        float height = 2.0f;
-        Vector center_offset = {0.0f, -height / 2.0f, 0.0f};
-        
-        // === ВЫЧИСЛЕНИЕ ТРАЕКТОРИИ ДВИЖЕНИЯ ===
-        // Сложная траектория в форме восьмёрки (лемнискаты)
-        // phase - фаза анимации с вариацией скорости для более интересного движения
-        float phase = animation_time + 0.2f * sinf(2.0f * animation_time);
-        float x = trajectory_radius * sinf(phase);              // Движение по X
-        float z = trajectory_radius * 0.5f * sinf(2.0f * phase); // Движение по Z (удвоенная частота = восьмёрка)
-        Vector orbital_pos = {x, 0.0f, z - 1};
-        
-        // Наклоняем плоскость траектории на 30 градусов вокруг оси X
-        Matrix tilt = rotation({1.0f, 0.0f, 0.0f}, M_PI / 6.0f);
-        Vector tilted_pos = multiply(tilt, orbital_pos);
-        
-        // === МАТРИЦА ПРОЕКЦИИ ===
-        float aspect = float(veekay::app.window_width) / float(veekay::app.window_height);
-        Matrix proj;
-        
-        if (use_perspective) {
-            // Перспективная проекция: fov = 45°, near = 0.01, far = 100
-            proj = perspective(M_PI / 4.0f, aspect, camera_near_plane, camera_far_plane);
-        } else {
-            // Ортогональная проекция: видимая область 5x5 единиц с учётом aspect ratio
-            float ortho_half_width = 5.0f * aspect;
-            float ortho_half_height = 5.0f;
-            proj = orthographic(-ortho_half_width, ortho_half_width, 
-                              -ortho_half_height, ortho_half_height, 
-                              -10.0f, camera_far_plane);
+    // Обновляем данные инстансов этого кадра: только изменившиеся объекты,
+    // большие изменения считаются параллельно на потоках job system
+    const uint32_t frame = veekay::app->frame_index;
+    if (veekay::app->tile.active) {
+        updateProjection();
+    }
+    
+    // Варианты шейдера по настройкам GUI, у mesh-шейдера - свой набор
+    pipeline = selectVariant(shading_variants, pipeline);
+    if (meshlets_ready && meshlet_pipeline) {
+        meshlet_pipeline = selectVariant(meshlet_variants, meshlet_pipeline);
+    }
+    scene->flush(frame, static_cast<veekay::InstanceData*>(instance_buffers[frame].mapped),
+                 *veekay::app->jobs);
+    materials.flush(frame);
+    
+    // Без прохода с загрузкой вложений двухфазное отсечение невозможно,
+    // но однофазное работает и так. Тайлы рисуются в свои буферы глубины,
+    // а пирамида строится по глубине окна, поэтому для них отсечения нет
+    const bool culling = occlusion_culling && !veekay::app->tile.active;
+    const bool two_phase = culling && two_phase_culling && veekay::app->vk_render_pass_load;
+    const veekay::CullPhase first_phase = two_phase ? veekay::CullPhase::early : veekay::CullPhase::single;
+    
+    // Отсечение записывается до начала render pass: compute-шейдер пишет
+    // indirect-команды для видимых инстансов. Матрицы передаются
+    // в шейдер как есть, поэтому multiply(view, projection) - это
+    // projection * view в GLSL
+    const Matrix view_projection = multiply(view, projection);
+    
+    if (culling) {
+        gpu_timer.begin(cmd, "Occlusion Culling");
+        culler.cull(cmd, first_phase, instance_buffers[frame].buffer, culled_object_count,
+                    &view_projection.m[0][0]);
+        gpu_timer.end(cmd);
+    } else {
+        // Одна indirect-команда на каждый батч (меш + диапазон инстансов)
+        draw_list.reset(frame);
+        for (const Batch& batch : batches) {
+            draw_list.add(geometry_pool.mesh(batch.mesh), batch.first_instance, batch.instance_count);
         }
-
-        // === МАТРИЦА ВИДА ===
-        // Камера находится в точке (0, 0, 5), смотрит в направлении (0, 0, -1)
-        Matrix view = translation({0.0f, 0.0f, -5.0f});
-        
-        // === МАТРИЦА МОДЕЛИ ===
-        // Перемещаем цилиндр на позицию траектории и немного наклоняем
-        Matrix model = multiply(
-            translation(tilted_pos), 
-            rotation({1.0f, 0.0f, 0.0f}, -M_PI / 5.0f)  // Наклон на -36°
-        );
-        
-        // Заполняем структуру констант для шейдеров
-        ShaderConstants constants{
-            .projection = proj,
-            .view = view,
-            .transform = model,
-            .color = cylinder_color,
-        };
+    }
+    
+    // Цилиндр с GPU перегенерируется только при изменении параметров,
+    // с пульсацией - каждый кадр
+    float gpu_radius = gpu_cylinder_radius;
+    if (gpu_cylinder_pulse) {
+        gpu_radius *= 1.0f + 0.3f * sinf(float(veekay::app->clock->time()) * 3.0f);
+    }
+    gpu_cylinder.generate(cmd, gpu_radius, gpu_cylinder_height, uint32_t(gpu_cylinder_segments));
+    
+    // Кластеры отсекаются по той же матрице. Для теста конусов нужна
+    // позиция камеры (-R^T * t из матрицы вида), а в ортогональной
+    // проекции - направление взгляда, одинаковое для всех кластеров
+    bool meshlets_culled = false;
+    if (meshlets_ready && cluster_culling) {
+        float camera[4];
+        for (int i = 0; i < 3; ++i) {
+            if (use_perspective) {
+                camera[i] = -(view.m[i][0] * view.m[3][0] + view.m[i][1] * view.m[3][1] +
+                              view.m[i][2] * view.m[3][2]);
+            } else {
+                camera[i] = -view.m[i][2];
+            }
+        }
+        camera[3] = use_perspective ? 1.0f : 0.0f;
         
-        // Передаём константы в шейдеры через push constants
-        vkCmdPushConstants(
-            cmd, pipeline_layout,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-            0, sizeof(ShaderConstants), &constants
-        );
+        meshlets_culled = meshlets.cull(cmd, instance_buffers[frame].buffer, meshlet_object,
+                                        &view_projection.m[0][0], camera);
+    }
+    
+    // Источники меняются каждый кадр, пока летают. Распределение по
+    // кластерам - по тем же матрицам, срезы от near до far камеры
+    if (point_lights_changed || (stress_scene && animate_lights)) {
+        updatePointLights(float(veekay::app->clock->time()));
+        point_lights_changed = false;
+    }
+    
+    gpu_timer.begin(cmd, "Light Binning");
+    const bool lights_binned = clustered_lighting.cull(cmd, &view.m[0][0], &projection.m[0][0]);
+    gpu_timer.end(cmd);
+    
+    // Без набора источников шейдеры сцены не привязать: кадр остаётся
+    // пустым, приложение завершается
+    if (!lights_binned) {
+        veekay::app->running = false;
+        beginRenderPass(cmd, framebuffer, veekay::app->vk_render_pass);
+        veekay::renderOverlay(cmd);
+        vkCmdEndRenderPass(cmd);
+        vkEndCommandBuffer(cmd);
+        return;
+    }
+    
+    gpu_timer.begin(cmd, "Main Pass");
+    beginRenderPass(cmd, framebuffer, veekay::app->vk_render_pass);
+    bindSceneState(cmd, frame);
+    
+    // Команда отрисовки: все меши и инстансы сцены одним вызовом
+    if (culling) {
+        culler.draw(cmd, first_phase);
+    } else {
+        draw_list.draw(cmd);
+    }
+    
+    // Цилиндр с GPU: свои буферы вершин и индексов, данные инстанса
+    // берутся из общего буфера по номеру объекта
+    gpu_cylinder.bind(cmd);
+    vkCmdDrawIndexed(cmd, gpu_cylinder.mesh().index_count, 1, 0, 0, gpu_cylinder_object);
+    
+    // Основной цилиндр: буферы этого кадра обновляются перед привязкой
+    if (cylinder_mesh.bind(cmd, frame)) {
+        vkCmdDrawIndexed(cmd, cylinder_mesh.mesh().index_count, 1, 0, 0, cylinder_object);
+    }
+    
+    // Детализированный цилиндр: видимые кластеры mesh-шейдером или
+    // indirect-командами по индексам в порядке кластеров, пока он
+    // загружается - заглушка из пула
+    VkDeviceSize meshlet_offset = 0;
+    if (!meshlets_ready) {
+        const veekay::MeshRange& range = geometry_pool.mesh(meshlet_placeholder_mesh);
+        geometry_pool.bind(cmd);
+        vkCmdDrawIndexed(cmd, range.index_count, 1, range.first_index, range.vertex_offset, meshlet_object);
+    } else if (!meshlets_culled) {
+        // Отсечение выключено или не записано в этом кадре: рисуем все кластеры
+        vkCmdBindVertexBuffers(cmd, 0, 1, &meshlet_vertex_buffer.buffer, &meshlet_offset);
+        vkCmdBindIndexBuffer(cmd, meshlet_index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexed(cmd, meshlet_index_count, 1, 0, 0, meshlet_object);
+    } else if (meshlet_pipeline) {
+        VkDescriptorSet material_set = materials.set(frame);
+        VkDescriptorSet light_set = clustered_lighting.set();
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, meshlet_pipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, meshlet_pipeline_layout,
+                                0, 1, &material_set, 0, nullptr);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, meshlet_pipeline_layout,
+                                2, 1, &light_set, 0, nullptr);
+        meshlets.drawMeshTasks(cmd, meshlet_pipeline_layout);
+    } else {
+        vkCmdBindVertexBuffers(cmd, 0, 1, &meshlet_vertex_buffer.buffer, &meshlet_offset);
+        meshlets.draw(cmd);
+    }
+    
+    gpu_timer.end(cmd);
+    
+    // Вторая фаза: пирамида строится по глубине первой, объекты, не
+    // видимые в прошлом кадре, проверяются по ней и дорисовываются
+    if (two_phase) {
+        gpu_timer.begin(cmd, "Late Pass");
+        vkCmdEndRenderPass(cmd);
         
-        // Команда отрисовки: рисуем цилиндр используя индексы
-        vkCmdDrawIndexed(cmd, cylinder_index_count, 1, 0, 0, 0);
+        culler.buildPyramid(cmd);
+        culler.cull(cmd, veekay::CullPhase::late, instance_buffers[frame].buffer, culled_object_count,
+                    &view_projection.m[0][0]);
+        
+        beginRenderPass(cmd, framebuffer, veekay::app->vk_render_pass_load);
+        bindSceneState(cmd, frame);
+        culler.draw(cmd, veekay::CullPhase::late);
+        gpu_timer.end(cmd);
     }
     
-    // Завершаем render pass и запись команд
+    // Рисуем ImGui в конце нашего render pass (без отдельного прохода)
+    veekay::renderOverlay(cmd);
+    
+    // Завершаем render pass
     vkCmdEndRenderPass(cmd);
+    
+    // В однофазном режиме пирамида строится по глубине этого кадра
+    // и используется для отсечения в следующем
+    if (culling && !two_phase) {
+        culler.buildPyramid(cmd);
+    }
+    
     vkEndCommandBuffer(cmd);
 }
 
 } // namespace
 
 // Точка входа в программу
-int main() {
+int main(int argc, char** argv) {
+    // Разрешение, число кадров в полёте, режим презентации, валидация,
+    // GPU, формат глубины и часы задаются флагами --option=value или
+    // переменными окружения VEEKAY_*, без перекомпиляции
+    veekay::ApplicationConfig config;
+    
+    // Отсечение перекрытых объектов читает буфер глубины из шейдера
+    config.depth_sampled = true;
+    
+    if (!veekay::parseConfig(argc, argv, config)) {
+        return 1;
+    }
+    
     // Запускаем приложение с нашими callback функциями
     return veekay::run({
         .init = initialize,     // Вызывается один раз при старте
         .shutdown = shutdown,   // Вызывается при завершении
         .update = update,       // Вызывается каждый кадр перед рендерингом
         .render = render,       // Вызывается каждый кадр для отрисовки
-    });
+        .ui = ui,               // GUI, всегда в главном потоке
+        .overlay_mode = veekay::OverlayMode::app_pass,  // ImGui рисуется внутри нашего прохода
+    }, config);
 }
@@ -0,0 +1,165 @@
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <iostream>
+
+#include <veekay/Cylinder.hpp>
+#include <veekay/Meshlet.hpp>
+
+namespace {
+
+// Проверяет geometry::buildMeshlets на CPU: кластеры не выходят за
+// пределы вершин и треугольников, а каждый треугольник меша попадает
+// ровно в один кластер с теми же индексами и в том же порядке вершин
+
+using Triangle = std::array<uint32_t, 3>;
+
+struct Mesh {
+    std::vector<geometry::Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+Mesh cylinderMesh(uint32_t segments) {
+    geometry::Cylinder cylinder(0.5f, 1.0f, segments);
+    return {cylinder.vertices_, cylinder.indices_};
+}
+
+// Сетка, треугольники которой перемешаны: соседние по буферу индексов
+// треугольники не делят вершин, кластеры упираются в предел вершин.
+// Плюс вырожденные треугольники с повторяющимися индексами
+Mesh scatteredGridMesh(uint32_t size) {
+    Mesh mesh;
+    mesh.vertices.resize((size + 1) * (size + 1));
+    for (uint32_t y = 0; y <= size; ++y) {
+        for (uint32_t x = 0; x <= size; ++x) {
+            mesh.vertices[y * (size + 1) + x].position = {float(x), float(y), 0.0f};
+        }
+    }
+
+    std::vector<Triangle> triangles;
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            const uint32_t i = y * (size + 1) + x;
+            triangles.push_back({i, i + 1, i + size + 1});
+            triangles.push_back({i + 1, i + size + 2, i + size + 1});
+        }
+    }
+
+    triangles.push_back({0, 0, 1});
+    triangles.push_back({2, 3, 2});
+    triangles.push_back({4, 4, 4});
+
+    // Детерминированная перестановка, одинаковая на всех машинах
+    uint32_t state = 12345;
+    for (size_t i = triangles.size() - 1; i > 0; --i) {
+        state = state * 1664525u + 1013904223u;
+        std::swap(triangles[i], triangles[state % (i + 1)]);
+    }
+
+    for (const Triangle& t : triangles) {
+        mesh.indices.insert(mesh.indices.end(), t.begin(), t.end());
+    }
+
+    return mesh;
+}
+
+bool check(const char* name, const Mesh& mesh, uint32_t max_vertices, uint32_t max_triangles) {
+    const geometry::MeshletData data = geometry::buildMeshlets(
+        mesh.vertices.data(), uint32_t(mesh.vertices.size()),
+        mesh.indices.data(), uint32_t(mesh.indices.size()),
+        max_vertices, max_triangles);
+
+    std::vector<Triangle> emitted;
+
+    for (size_t m = 0; m < data.meshlets.size(); ++m) {
+        const geometry::Meshlet& meshlet = data.meshlets[m];
+
+        if (meshlet.vertex_count == 0 || meshlet.vertex_count > max_vertices ||
+            meshlet.triangle_count == 0 || meshlet.triangle_count > max_triangles) {
+            std::cerr << name << ": meshlet " << m << " has " << meshlet.vertex_count
+                      << " vertices and " << meshlet.triangle_count << " triangles, limits are "
+                      << max_vertices << " and " << max_triangles << '\n';
+            return false;
+        }
+
+        if (meshlet.vertex_offset + meshlet.vertex_count > data.vertices.size() ||
+            meshlet.triangle_offset + meshlet.triangle_count * 3 > data.triangles.size()) {
+            std::cerr << name << ": meshlet " << m << " points past its arrays\n";
+            return false;
+        }
+
+        for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+            Triangle triangle;
+            for (uint32_t k = 0; k < 3; ++k) {
+                const uint8_t local = data.triangles[meshlet.triangle_offset + t * 3 + k];
+                if (local >= meshlet.vertex_count) {
+                    std::cerr << name << ": meshlet " << m << " triangle " << t
+                              << " uses local vertex " << uint32_t(local) << " of "
+                              << meshlet.vertex_count << '\n';
+                    return false;
+                }
+
+                triangle[k] = data.vertices[meshlet.vertex_offset + local];
+            }
+
+            emitted.push_back(triangle);
+        }
+    }
+
+    if (data.triangles.size() % 4 != 0) {
+        std::cerr << name << ": triangle array isn't padded to whole words\n";
+        return false;
+    }
+
+    // Порядок треугольников сохраняется, поэтому сравнение прямое
+    std::vector<Triangle> expected;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        expected.push_back({mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]});
+    }
+
+    if (emitted != expected) {
+        std::cerr << name << ": meshlets hold " << emitted.size() << " triangles, mesh has "
+                  << expected.size() << ", or they differ\n";
+        return false;
+    }
+
+    const std::vector<uint32_t> indices = geometry::meshletIndices(data);
+    if (!std::equal(mesh.indices.begin(), mesh.indices.end(), indices.begin()) ||
+        std::any_of(indices.begin() + mesh.indices.size(), indices.end(),
+                    [](uint32_t index) { return index != 0; })) {
+        std::cerr << name << ": meshletIndices() differs from mesh indices\n";
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main() {
+    bool passed = true;
+
+    passed &= check("cylinder of 3 segments", cylinderMesh(3),
+                    geometry::meshlet_max_vertices, geometry::meshlet_max_triangles);
+    passed &= check("cylinder of 64 segments", cylinderMesh(64),
+                    geometry::meshlet_max_vertices, geometry::meshlet_max_triangles);
+    passed &= check("cylinder of 1000 segments", cylinderMesh(1000),
+                    geometry::meshlet_max_vertices, geometry::meshlet_max_triangles);
+    passed &= check("scattered grid", scatteredGridMesh(40),
+                    geometry::meshlet_max_vertices, geometry::meshlet_max_triangles);
+
+    // Маленькие пределы, кластеры закрываются на каждом шаге
+    passed &= check("scattered grid, small limits", scatteredGridMesh(12), 4, 2);
+    passed &= check("cylinder, one triangle per meshlet", cylinderMesh(16), 3, 1);
+
+    // Предел вершин не достигается, кластеры режет только предел треугольников
+    passed &= check("cylinder, triangle limit only", cylinderMesh(64), 255, 7);
+
+    if (!passed) {
+        return 1;
+    }
+
+    std::cout << "Meshlets stay within limits and hold every triangle once\n";
+    return 0;
+}